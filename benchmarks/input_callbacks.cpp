@@ -0,0 +1,79 @@
+#include <cstddef>
+#include <cstdio>
+#include <functional>
+#include <set>
+#include <vector>
+
+#include <input_state.hpp>
+#include <scene_registry.hpp>
+
+#include <timing.hpp>
+
+// 10k objects with a movement callback each: the frame callback path from before InputState, which copied the
+// pressed keys and every callback per call, against the const InputState& one
+const size_t OBJECT_COUNT = 10000;
+const size_t FRAMES = 200;
+
+namespace {
+    using namespace volchara;
+
+    using SetCallback = std::function<void(Object*, float, std::set<int>)>;
+
+    struct SetCallbackObject {
+        std::vector<SetCallback> frameCallbacks;
+        float x = 0.0f;
+
+        // as Object::runFrameCallbacks was
+        void runFrameCallbacks(float passedSeconds, std::set<int> pressedKeys) {
+            for (auto callback : frameCallbacks) {
+                callback(nullptr, passedSeconds, pressedKeys);
+            }
+        }
+    };
+
+    struct InputStateObject {
+        std::vector<FrameCallback> frameCallbacks;
+        float x = 0.0f;
+
+        void runFrameCallbacks(float passedSeconds, const InputState& input) {
+            for (auto& callback : frameCallbacks) {
+                callback(nullptr, passedSeconds, input);
+            }
+        }
+    };
+}
+
+int main() {
+    // a few keys held, as while steering
+    std::set<int> pressedKeys{GLFW_KEY_UP, GLFW_KEY_LEFT, GLFW_KEY_SPACE};
+    InputState input;
+    for (int key : pressedKeys) input.press(key);
+    float passedSeconds = 1.0f / 60.0f;
+
+    std::vector<SetCallbackObject> setObjects(OBJECT_COUNT);
+    for (SetCallbackObject& object : setObjects) {
+        float* x = &object.x;
+        object.frameCallbacks.push_back([x](Object*, float passedSeconds, std::set<int> pressedKeys) {
+            if (pressedKeys.contains(GLFW_KEY_UP)) *x += passedSeconds;
+            if (pressedKeys.contains(GLFW_KEY_DOWN)) *x -= passedSeconds;
+        });
+    }
+    std::vector<InputStateObject> inputObjects(OBJECT_COUNT);
+    for (InputStateObject& object : inputObjects) {
+        float* x = &object.x;
+        object.frameCallbacks.push_back([x](Object*, float passedSeconds, const InputState& input) {
+            if (input.isDown(GLFW_KEY_UP)) *x += passedSeconds;
+            if (input.isDown(GLFW_KEY_DOWN)) *x -= passedSeconds;
+        });
+    }
+
+    double setMilliseconds = medianMilliseconds(FRAMES, [&] {
+        for (SetCallbackObject& object : setObjects) object.runFrameCallbacks(passedSeconds, pressedKeys);
+    });
+    double inputMilliseconds = medianMilliseconds(FRAMES, [&] {
+        for (InputStateObject& object : inputObjects) object.runFrameCallbacks(passedSeconds, input);
+    });
+    std::printf("%zu objects, median of %zu frames\n", OBJECT_COUNT, FRAMES);
+    std::printf("std::set<int> by value   %8.3f ms/frame\n", setMilliseconds);
+    std::printf("const InputState&        %8.3f ms/frame  (%.1fx)\n", inputMilliseconds, setMilliseconds / inputMilliseconds);
+}
@@ -0,0 +1,57 @@
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <renderer.hpp>
+#include <job_system.hpp>
+#include <scene_registry.hpp>
+
+#include <timing.hpp>
+
+// 100k objects with a parallel frame callback each, run the way Renderer::runParallelFrameCallbacks runs them,
+// once per thread count from 1 to every hardware thread, or to the count given as the first argument
+const size_t OBJECT_COUNT = 100000;
+const size_t FRAMES = 50;
+
+int main(int argc, char** argv) {
+    using namespace volchara;
+    SceneRegistry scene;
+    std::vector<glm::vec3> positions(OBJECT_COUNT);
+    for (size_t i = 0; i < OBJECT_COUNT; i++) {
+        Entity entity = scene.create(COMPONENT_CALLBACKS | COMPONENT_ACTIVE);
+        glm::vec3* position = &positions[i];
+        float phase = static_cast<float>(i) * 0.001f;
+        // an orbit plus a key check, about what the samples' movement callbacks cost
+        scene.callbacks(entity).parallelCallbacks.push_back([position, phase](Object*, float passedSeconds, const InputState& input) {
+            float angle = phase + passedSeconds * (input.isDown(GLFW_KEY_UP) ? 2.0f : 1.0f);
+            *position = glm::vec3(std::cos(angle), std::sin(angle), position->z + passedSeconds);
+        });
+    }
+    InputState input;
+    float passedSeconds = 1.0f / SIMULATION_TICK_RATE;
+
+    size_t maxThreads = argc > 1 ? std::stoul(argv[1]) : std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    double singleThreaded = 0.0;
+    std::printf("%zu callback objects, median of %zu frames\n", OBJECT_COUNT, FRAMES);
+    std::printf("threads  ms/frame  speedup\n");
+    for (size_t threads = 1; threads <= maxThreads; threads++) {
+        JobSystem jobSystem(threads - 1);
+        double milliseconds = medianMilliseconds(FRAMES, [&] {
+            scene.forEach(COMPONENT_CALLBACKS | COMPONENT_ACTIVE, [&](Archetype& archetype, size_t) {
+                jobSystem.parallelForRange(archetype.size(), MIN_OBJECTS_PER_CALLBACK_JOB, [&](size_t begin, size_t end) {
+                    for (size_t row = begin; row < end; row++) {
+                        FrameCallbacks& entry = archetype.callbacks[row];
+                        for (auto& callback : entry.parallelCallbacks) {
+                            callback(entry.owner, passedSeconds, input);
+                        }
+                    }
+                });
+            });
+        });
+        if (threads == 1) singleThreaded = milliseconds;
+        std::printf("%7zu  %8.3f  %6.2fx\n", threads, milliseconds, singleThreaded / milliseconds);
+    }
+}
@@ -0,0 +1,134 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <input_state.hpp>
+#include <scene_registry.hpp>
+
+#include <timing.hpp>
+
+// the per-frame walk over 1M drawn entities that fills draw commands and object data: the archetype columns
+// against a vector of heap objects laid out like Object before the registry, in creation order and shuffled
+// the way a long session's additions and removals leave them
+const size_t ENTITY_COUNT = 1000000;
+const size_t FRAMES = 20;
+
+namespace {
+    using namespace volchara;
+
+    struct DrawCommand {
+        uint32_t indexCount;
+        uint32_t instanceCount;
+        uint32_t firstIndex;
+        int32_t vertexOffset;
+        uint32_t firstInstance;
+    };
+
+    struct ObjectRecord {
+        glm::vec4 color;
+        uint32_t textureIndex;
+        uint32_t transform;
+    };
+
+    struct LegacyVertex {
+        glm::vec3 pos;
+        glm::vec3 normal;
+        glm::vec2 texCoord;
+    };
+
+    // the fields Object kept inline, each object with its own geometry and callbacks
+    class LegacyObject {
+        public:
+        std::vector<LegacyVertex> vertices;
+        std::vector<uint32_t> indices;
+        std::vector<std::function<void(Object*, float, const InputState&)>> frameCallbacks;
+        // Transform's position, scaling, rotation and cached matrix
+        float transform[26] = {};
+        uint32_t transformSlot = 0;
+        glm::vec3 color{0.0f, 0.0f, 0.0f};
+        uint32_t textureIndex = 0;
+        uint32_t firstIndex = 0;
+        int32_t vertexOffset = 0;
+
+        virtual ~LegacyObject() = default;
+    };
+
+    std::vector<std::unique_ptr<LegacyObject>> makeLegacyObjects() {
+        std::vector<std::unique_ptr<LegacyObject>> objects;
+        for (size_t i = 0; i < ENTITY_COUNT; i++) {
+            auto object = std::make_unique<LegacyObject>();
+            // a box, as objBoxFromWorldCoordinates makes
+            object->vertices.resize(24);
+            object->indices.resize(36);
+            object->transformSlot = static_cast<uint32_t>(i);
+            object->textureIndex = static_cast<uint32_t>(i % 7);
+            object->firstIndex = static_cast<uint32_t>(i * 36);
+            object->vertexOffset = static_cast<int32_t>(i * 24);
+            objects.push_back(std::move(object));
+        }
+        return objects;
+    }
+
+    void walkLegacy(const std::vector<LegacyObject*>& objects, std::vector<DrawCommand>& draws, std::vector<ObjectRecord>& records) {
+        for (size_t i = 0; i < objects.size(); i++) {
+            const LegacyObject& object = *objects[i];
+            draws[i] = {
+                .indexCount = static_cast<uint32_t>(object.indices.size()),
+                .instanceCount = 1,
+                .firstIndex = object.firstIndex,
+                .vertexOffset = object.vertexOffset,
+                .firstInstance = static_cast<uint32_t>(i),
+            };
+            records[i] = {.color = glm::vec4(object.color, 0.0f), .textureIndex = object.textureIndex, .transform = object.transformSlot};
+        }
+    }
+}
+
+int main() {
+    std::vector<DrawCommand> draws(ENTITY_COUNT);
+    std::vector<ObjectRecord> records(ENTITY_COUNT);
+
+    SceneRegistry scene;
+    for (size_t i = 0; i < ENTITY_COUNT; i++) {
+        Entity entity = scene.create(DRAWABLE_COMPONENTS | COMPONENT_ACTIVE);
+        scene.transform(entity) = static_cast<uint32_t>(i);
+        scene.mesh(entity) = {.firstIndex = static_cast<uint32_t>(i * 36), .indexCount = 36, .vertexOffset = static_cast<int32_t>(i * 24)};
+        scene.material(entity).textureIndex = static_cast<uint32_t>(i % 7);
+    }
+    double registryMilliseconds = medianMilliseconds(FRAMES, [&] {
+        scene.forEach(DRAWABLE_COMPONENTS, [&](Archetype& archetype, size_t first) {
+            for (size_t row = 0; row < archetype.size(); row++) {
+                const MeshRef& mesh = archetype.meshes[row];
+                draws[first + row] = {
+                    .indexCount = mesh.indexCount,
+                    .instanceCount = 1,
+                    .firstIndex = mesh.firstIndex,
+                    .vertexOffset = mesh.vertexOffset,
+                    .firstInstance = static_cast<uint32_t>(first + row),
+                };
+                records[first + row] = {
+                    .color = glm::vec4(archetype.materials[row].color, 0.0f),
+                    .textureIndex = archetype.materials[row].textureIndex,
+                    .transform = archetype.transforms[row],
+                };
+            }
+        });
+    });
+
+    std::vector<std::unique_ptr<LegacyObject>> legacyObjects = makeLegacyObjects();
+    std::vector<LegacyObject*> objects;
+    for (auto& object : legacyObjects) objects.push_back(object.get());
+    double createdMilliseconds = medianMilliseconds(FRAMES, [&] { walkLegacy(objects, draws, records); });
+    std::shuffle(objects.begin(), objects.end(), std::mt19937(1));
+    double shuffledMilliseconds = medianMilliseconds(FRAMES, [&] { walkLegacy(objects, draws, records); });
+
+    std::printf("%zu entities, median of %zu frames\n", ENTITY_COUNT, FRAMES);
+    std::printf("archetype columns          %8.3f ms/frame\n", registryMilliseconds);
+    std::printf("Object*, creation order    %8.3f ms/frame  (%.1fx)\n", createdMilliseconds, createdMilliseconds / registryMilliseconds);
+    std::printf("Object*, shuffled          %8.3f ms/frame  (%.1fx)\n", shuffledMilliseconds, shuffledMilliseconds / registryMilliseconds);
+}
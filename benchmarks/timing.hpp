@@ -0,0 +1,22 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+namespace volchara {
+    // the median of `runs` timed calls, after one untimed call to warm caches and allocators up
+    template<class Fn>
+    double medianMilliseconds(size_t runs, Fn&& fn) {
+        fn();
+        std::vector<double> times;
+        for (size_t run = 0; run < runs; run++) {
+            auto start = std::chrono::steady_clock::now();
+            fn();
+            times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        }
+        std::nth_element(times.begin(), times.begin() + times.size() / 2, times.end());
+        return times[times.size() / 2];
+    }
+}
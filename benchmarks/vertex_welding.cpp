@@ -0,0 +1,146 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <tiny_gltf.h>
+
+#include <gltf_accessor.hpp>
+#include <job_system.hpp>
+#include <vertex_layout.hpp>
+#include <vertex_weld.hpp>
+
+#include <timing.hpp>
+
+// welding the fisch model's triangles and a shuffled 10M-vertex grid: the std::unordered_map generateIndices used
+// before, weldVertices on one thread and on the job system, and the packed stream welder the importer runs.
+// the model path can be given as the first argument
+const size_t SYNTHETIC_GRID_SIDE = 1291;  // 6 vertices a quad, 10M in all
+
+namespace {
+    using namespace volchara;
+
+    template<class T>
+    void hashCombine(size_t& seed, const T& v) {
+        seed ^= std::hash<T>{}(v) + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2);
+    }
+
+    // as generateIndices hashed vertices before the flat table
+    struct VertexHash {
+        size_t operator()(const Vertex& v) const {
+            size_t seed = 0;
+            for (float component : {v.pos.x, v.pos.y, v.pos.z, v.normal.x, v.normal.y, v.normal.z, v.texCoord.x, v.texCoord.y}) {
+                hashCombine(seed, component);
+            }
+            return seed;
+        }
+    };
+
+    WeldedMesh weldWithMap(const std::vector<Vertex>& vertices) {
+        WeldedMesh welded;
+        std::unordered_map<Vertex, int32_t, VertexHash> indexMap;
+        for (const Vertex& v : vertices) {
+            auto pos = indexMap.find(v);
+            if (pos == indexMap.end()) {
+                welded.indices.push_back(static_cast<uint32_t>(welded.vertices.size()));
+                indexMap.insert({v, static_cast<int32_t>(welded.vertices.size())});
+                welded.vertices.push_back(v);
+            } else {
+                welded.indices.push_back(pos->second);
+            }
+        }
+        return welded;
+    }
+
+    // every primitive's triangles with their vertices written out, as objects hand them to generateIndices
+    std::vector<Vertex> readTriangles(const std::filesystem::path& modelPath) {
+        tinygltf::TinyGLTF loader;
+        tinygltf::Model model;
+        std::string err;
+        std::string warn;
+        if (!loader.LoadASCIIFromFile(&model, &err, &warn, modelPath.string())) {
+            throw std::runtime_error("failed to load " + modelPath.string() + ": " + err);
+        }
+        std::vector<Vertex> vertices;
+        for (const tinygltf::Mesh& mesh : model.meshes) {
+            for (const tinygltf::Primitive& prim : mesh.primitives) {
+                auto position = prim.attributes.find("POSITION");
+                auto normal = prim.attributes.find("NORMAL");
+                auto texCoord = prim.attributes.find("TEXCOORD_0");
+                if (position == prim.attributes.end() || normal == prim.attributes.end() || texCoord == prim.attributes.end() || prim.indices < 0) continue;
+                AccessorView positions(model, position->second);
+                AccessorView normals(model, normal->second);
+                AccessorView texCoords(model, texCoord->second);
+                AccessorView indices(model, prim.indices);
+                for (size_t i = 0; i < indices.count(); i++) {
+                    uint32_t index = indices.readIndex(i);
+                    Vertex& v = vertices.emplace_back();
+                    positions.readFloats(index, &v.pos.x, 3);
+                    normals.readFloats(index, &v.normal.x, 3);
+                    texCoords.readFloats(index, &v.texCoord.x, 2);
+                }
+            }
+        }
+        return vertices;
+    }
+
+    std::vector<Vertex> makeGrid(size_t side) {
+        std::vector<Vertex> vertices;
+        vertices.reserve(side * side * 6);
+        auto at = [&](size_t x, size_t y) {
+            glm::vec2 uv(static_cast<float>(x) / side, static_cast<float>(y) / side);
+            return Vertex{.pos = glm::vec3(uv.x, uv.y, 0.0f), .normal = glm::vec3(0.0f, 0.0f, 1.0f), .texCoord = uv};
+        };
+        for (size_t y = 0; y < side; y++) {
+            for (size_t x = 0; x < side; x++) {
+                for (Vertex v : {at(x, y), at(x + 1, y), at(x + 1, y + 1), at(x, y), at(x + 1, y + 1), at(x, y + 1)}) {
+                    vertices.push_back(v);
+                }
+            }
+        }
+        // whole triangles in random order, so repeated vertices are far apart
+        std::vector<size_t> triangles(vertices.size() / 3);
+        for (size_t i = 0; i < triangles.size(); i++) triangles[i] = i;
+        std::shuffle(triangles.begin(), triangles.end(), std::mt19937(1));
+        std::vector<Vertex> shuffled;
+        shuffled.reserve(vertices.size());
+        for (size_t triangle : triangles) {
+            shuffled.insert(shuffled.end(), vertices.begin() + triangle * 3, vertices.begin() + triangle * 3 + 3);
+        }
+        return shuffled;
+    }
+
+    void run(const char* name, const std::vector<Vertex>& vertices, size_t runs, JobSystem& jobs) {
+        std::vector<PositionStream> positions;
+        std::vector<AttributeStream> attributes;
+        for (const Vertex& v : vertices) {
+            positions.push_back(packPosition(v.pos));
+            attributes.push_back(packAttributes(v.normal, v.texCoord));
+        }
+        size_t unique = weldVertices(vertices).vertices.size();
+        std::printf("%s: %zu vertices, %zu unique, median of %zu runs\n", name, vertices.size(), unique, runs);
+        double mapMilliseconds = medianMilliseconds(runs, [&] { weldWithMap(vertices); });
+        auto report = [&](const std::string& label, double milliseconds) {
+            std::printf("  %-28s %10.2f ms  (%.1fx)\n", label.c_str(), milliseconds, mapMilliseconds / milliseconds);
+        };
+        std::string threads = std::to_string(jobs.concurrency()) + " threads";
+        report("std::unordered_map", mapMilliseconds);
+        report("weldVertices, 1 thread", medianMilliseconds(runs, [&] { weldVertices(vertices); }));
+        report("weldVertices, " + threads, medianMilliseconds(runs, [&] { weldVertices(vertices, 0.0f, &jobs); }));
+        report("packed streams, " + threads, medianMilliseconds(runs, [&] { weldVertices(positions, attributes, &jobs); }));
+    }
+}
+
+int main(int argc, char** argv) {
+    std::filesystem::path modelPath = argc > 1 ? argv[1] : FISCH_MODEL_PATH;
+    JobSystem jobs;
+    run("fisch", readTriangles(modelPath), 10, jobs);
+    run("synthetic grid", makeGrid(SYNTHETIC_GRID_SIDE), 3, jobs);
+}
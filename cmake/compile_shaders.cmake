@@ -37,6 +37,7 @@ function(define_shader_set)
 
   add_custom_target(${A_NAME} DEPENDS ${_compiled_shaders})
   target_sources(${A_NAME} PRIVATE ${_raw_shaders})
+  set_target_properties(${A_NAME} PROPERTIES RESOURCE_OUTPUTS "${_compiled_shaders}")
 endfunction()
 
 function(use_shader_set)
@@ -52,6 +52,7 @@ function(define_resource_set)
 
   add_custom_target(${A_NAME} DEPENDS ${_copied_files})
   target_sources(${A_NAME} PRIVATE ${_resource_files})
+  set_target_properties(${A_NAME} PROPERTIES RESOURCE_OUTPUTS "${_copied_files}")
 endfunction()
 
 function(use_resource_set)
@@ -67,3 +68,42 @@ function(use_resource_set)
     add_dependencies(${U_TARGET} ${_resource_set})
   endforeach()
 endfunction()
+
+# packs what resource and shader sets put in the resources directory into one archive, under the same relative paths
+function(define_resource_pack)
+  cmake_parse_arguments(PARSE_ARGV 0 A LZ4 "NAME;OUTPUT" "SETS")
+  if(NOT A_NAME OR NOT A_OUTPUT OR NOT A_SETS)
+    message(FATAL_ERROR "define_resource_pack: you must NAME the pack and give its OUTPUT and SETS!")
+  endif()
+
+  if (TARGET ${A_NAME})
+    message(FATAL_ERROR "define_resource_pack: pack ${A_NAME} is already defined!")
+  endif()
+
+  if(NOT TARGET vpak)
+    message(FATAL_ERROR "define_resource_pack: the vpak packer has to be defined first!")
+  endif()
+
+  set(_packed_files)
+  foreach(_resource_set IN LISTS A_SETS)
+    if(NOT TARGET ${_resource_set})
+      message(FATAL_ERROR "define_resource_pack: can't found ${_resource_set} set!")
+    endif()
+    get_target_property(_set_files ${_resource_set} RESOURCE_OUTPUTS)
+    list(APPEND _packed_files ${_set_files})
+  endforeach()
+
+  set(_compression)
+  if(A_LZ4)
+    set(_compression --lz4)
+  endif()
+  add_custom_command(
+    OUTPUT "${A_OUTPUT}"
+    COMMAND vpak ${_compression} "${A_OUTPUT}" "${CMAKE_BINARY_DIR}/resources" ${_packed_files}
+    COMMENT "Packing resources ${A_SETS} -> ${A_OUTPUT}"
+    DEPENDS vpak ${_packed_files}
+  )
+
+  add_custom_target(${A_NAME} DEPENDS "${A_OUTPUT}")
+  add_dependencies(${A_NAME} ${A_SETS})
+endfunction()
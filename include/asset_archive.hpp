@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <asset_source.hpp>
+#include <mapped_file.hpp>
+
+namespace volchara {
+    // bumped whenever the layout below changes; the build packs the archive again anyway
+    const uint32_t ASSET_ARCHIVE_VERSION = 1;
+    // stored entries start this aligned in the file, so a mapped entry can be handed to a shader module or
+    // copied to the GPU as it is
+    const uint64_t ASSET_ARCHIVE_ALIGNMENT = 256;
+
+    enum class AssetCompression : uint32_t {
+        None,
+        LZ4,
+    };
+
+    struct ArchiveEntry {
+        // points into the mapping
+        std::string_view name;
+        uint64_t offset = 0;
+        uint64_t storedSize = 0;
+        uint64_t size = 0;
+        AssetCompression compression = AssetCompression::None;
+    };
+
+    // a .vpak file: a header, a table of contents sorted by name, then every entry on its own alignment.
+    // mapped once; uncompressed entries are served straight from the mapping
+    class AssetArchive : public AssetSource {
+        private:
+        std::shared_ptr<const MappedFile> file;
+        std::vector<ArchiveEntry> entries;
+        // asked for what the archive doesn't have, e.g. resources added since it was packed
+        std::unique_ptr<AssetSource> fallback;
+
+        const ArchiveEntry* find(std::string_view name) const;
+
+        public:
+        explicit AssetArchive(const std::filesystem::path& archivePath, std::unique_ptr<AssetSource> fallback = nullptr);
+        std::span<const ArchiveEntry> contents() const;
+        bool contains(std::string_view name) const override;
+        Asset open(std::string_view name) const override;
+    };
+
+    struct ArchiveInput {
+        std::string name;
+        std::filesystem::path file;
+    };
+
+    // entries are stored with `compression` where that saves at least an eighth of them, uncompressed otherwise;
+    // written to a temporary file first like a mesh cache
+    void writeAssetArchive(const std::filesystem::path& archivePath, std::vector<ArchiveInput> inputs, AssetCompression compression = AssetCompression::None);
+}
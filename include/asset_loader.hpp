@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace volchara {
+    // the result of a load on an AssetLoader, polled rather than waited for so nothing blocks on it
+    template<typename T>
+    class AssetLoad {
+        friend class AssetLoader;
+        private:
+        std::atomic<bool> finished{false};
+        T value{};
+        std::exception_ptr error = nullptr;
+
+        public:
+        bool ready() const {
+            return finished.load(std::memory_order_acquire);
+        }
+        // only once ready; rethrows what the load threw
+        T& result() {
+            if (error) std::rethrow_exception(error);
+            return value;
+        }
+    };
+
+    // runs loads one after another on a thread of its own, so a long import never lands on a thread waiting for frame jobs
+    class AssetLoader {
+        private:
+        std::thread thread;
+        std::mutex mutex;
+        std::condition_variable wakeCondition;
+        std::deque<std::function<void()>> tasks;
+        bool stopping = false;
+
+        void submit(std::function<void()> task);
+        void loop();
+
+        public:
+        // without a thread, loads run as they are submitted, as in the job system's deterministic mode
+        explicit AssetLoader(bool threaded = true);
+        // loads not started yet are dropped and never become ready
+        ~AssetLoader();
+        AssetLoader(AssetLoader&) = delete;
+        AssetLoader& operator=(AssetLoader&) = delete;
+
+        template<typename T>
+        std::shared_ptr<AssetLoad<T>> load(std::function<T()> task) {
+            auto result = std::make_shared<AssetLoad<T>>();
+            submit([result, task = std::move(task)] {
+                try {
+                    result->value = task();
+                } catch (...) {
+                    result->error = std::current_exception();
+                }
+                result->finished.store(true, std::memory_order_release);
+            });
+            return result;
+        }
+    };
+}
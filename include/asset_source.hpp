@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <utility>
+
+namespace volchara {
+    // an asset's bytes, kept alive by whatever they point into: a mapping, or a buffer they were decompressed to
+    class Asset {
+        private:
+        std::shared_ptr<const void> owner;
+        std::span<const std::byte> bytes;
+
+        public:
+        Asset() = default;
+        Asset(std::shared_ptr<const void> owner, std::span<const std::byte> bytes) : owner(std::move(owner)), bytes(bytes) {}
+
+        const std::byte* data() const { return bytes.data(); }
+        size_t size() const { return bytes.size(); }
+        std::span<const std::byte> span() const { return bytes; }
+    };
+
+    // serves assets by their path relative to the resource directory, with '/' separators, e.g. "shaders/base.vert.spv"
+    class AssetSource {
+        public:
+        virtual ~AssetSource() = default;
+        virtual bool contains(std::string_view name) const = 0;
+        // throws if there is no such asset
+        virtual Asset open(std::string_view name) const = 0;
+    };
+
+    // the resource directory as the build copies it, mapping each file on open
+    class LooseFileSource : public AssetSource {
+        private:
+        std::filesystem::path root;
+
+        public:
+        explicit LooseFileSource(std::filesystem::path root);
+        bool contains(std::string_view name) const override;
+        Asset open(std::string_view name) const override;
+    };
+}
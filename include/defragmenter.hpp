@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <vulkan/vulkan_raii.hpp>
+#include <vk_mem_alloc.hpp>
+
+#include <memory_stats.hpp>
+#include <raii_wrappers.hpp>
+
+namespace volchara {
+    // incremental defragmentation of the allocator's default pools through VMA: every step is one bounded pass that
+    // copies the resources it moves on the GPU and waits for the copies, or submits nothing when none of them move
+    class Defragmenter {
+        private:
+        vk::raii::Device* device = nullptr;
+        vma::Allocator allocator;
+        vk::raii::Queue queue = nullptr;
+        vk::raii::CommandPool commandPool = nullptr;
+        vk::raii::CommandBuffer commands = nullptr;
+        vk::raii::Fence fence = nullptr;
+        VmaDefragmentationContext context = nullptr;
+        uint32_t maxMoves = 0;
+        vk::DeviceSize maxBytes = 0;
+        FragmentationStats moved;
+
+        // ends the defragmentation once a pass found nothing more to move
+        bool finishStep(VkResult result);
+
+        public:
+        Defragmenter(vk::raii::Device& dev, RAIIAllocator& allocator, uint32_t queueFamilyIndex, uint32_t maxMovesPerPass, vk::DeviceSize maxBytesPerPass);
+        Defragmenter(nullptr_t) {}
+        ~Defragmenter();
+        Defragmenter(Defragmenter&) = delete;
+        Defragmenter& operator=(Defragmenter&) = delete;
+        Defragmenter(Defragmenter&& other);
+        const Defragmenter& operator=(Defragmenter&& other);
+
+        bool active() const;
+        void begin();
+        // moves what it can of the given buffers and sampled images in shader read layout, leaving everything else
+        // where it is; movedTextures gets the indices of the textures that moved, whose views are new.
+        // the pass goes to the queue the resources are read on, and nothing may be submitted to it until the step returns.
+        // false once there is nothing left to move
+        bool step(std::span<RAIIvmaBuffer* const> buffers, std::span<RAIIvmaImage> textures, bool& buffersMoved, std::vector<uint32_t>& movedTextures);
+        // passes, moves and bytes moved since the allocator was created
+        FragmentationStats stats() const;
+        static void swap(Defragmenter& lhs, Defragmenter& rhs);
+    };
+}
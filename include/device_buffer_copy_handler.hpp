@@ -11,7 +11,7 @@ namespace volchara {
 
         public:
             DeviceBufferCopyHandler(vk::raii::Device& dev, uint32_t queueFamilyIndex);
-            void submit(vk::Buffer& from, vk::Buffer& to, uint32_t size);
+            void submit(vk::Buffer& from, vk::Buffer& to, uint32_t size, vk::DeviceSize dstOffset = 0);
             void submit(vk::Buffer& from, vk::Image& to, vk::Extent3D extent);
             DeviceBufferCopyHandler(nullptr_t) {}
             ~DeviceBufferCopyHandler() {}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+
+namespace volchara {
+    // a bump allocator for one frame's CPU temporaries; deallocating does nothing, reset() frees everything at once.
+    // what doesn't fit in the block comes from upstream, and the next reset grows the block to the frame's
+    // high-water mark, so a frame like the previous ones never reaches upstream. not thread safe
+    class FrameArena : public std::pmr::memory_resource {
+        private:
+        // heads an allocation from upstream, with what it takes to free it
+        struct Overflow {
+            size_t size;
+            size_t alignment;
+            Overflow* next;
+        };
+
+        std::pmr::memory_resource* upstream;
+        std::byte* block = nullptr;
+        size_t blockSize = 0;
+        size_t used = 0;
+        Overflow* overflow = nullptr;
+        size_t overflowBytes = 0;
+
+        void releaseOverflow();
+
+        protected:
+        void* do_allocate(size_t bytes, size_t alignment) override;
+        void do_deallocate(void* data, size_t bytes, size_t alignment) override;
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+        public:
+        explicit FrameArena(size_t capacity = 64 * 1024, std::pmr::memory_resource* upstream = std::pmr::new_delete_resource());
+        ~FrameArena();
+        FrameArena(FrameArena&) = delete;
+        FrameArena& operator=(FrameArena&) = delete;
+
+        // everything allocated since the last reset must be dead by now
+        void reset();
+        size_t capacity() const;
+        // since the last reset, overflow included
+        size_t bytesUsed() const;
+    };
+}
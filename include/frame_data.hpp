@@ -0,0 +1,86 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory_resource>
+#include <span>
+#include <vector>
+
+#include <vulkan/vulkan_raii.hpp>
+
+#include <glm/glm.hpp>
+
+#include <job_system.hpp>
+#include <meshlet.hpp>
+#include <scene_registry.hpp>
+#include <transform_store.hpp>
+
+namespace volchara {
+    // below this, spreading work over more jobs costs more than it saves
+    const size_t MIN_OBJECTS_PER_UPDATE_JOB = 1024;
+    // a coarser LOD is only picked once its error is this far below the limit, so objects near a switch don't flicker
+    const float LOD_HYSTERESIS = 0.8f;
+    // per frame in flight; instances beyond these are drawn whole
+    const uint32_t MESHLET_CULL_JOB_CAPACITY = 1 << 18;
+    const uint32_t CULLED_INDEX_CAPACITY = 1 << 22;
+    const uint32_t NO_MESHLET_DRAW = std::numeric_limits<uint32_t>::max();
+
+    // per-draw data read by instance index, so moving objects doesn't invalidate recorded commands;
+    // model matrices are kept in a separate buffer indexed the same way
+    struct alignas(16) ObjectData {
+        glm::vec4 color{0.0f, 0.0f, 0.0f, 0.0f};
+        uint32_t textureIndex = 0;
+        float brightness = 0.0f;
+    };
+
+    // scene state at the end of a simulation tick
+    struct SimulationSnapshot {
+        uint64_t tick = 0;
+        std::chrono::steady_clock::time_point time;
+        TransformState camera;
+        // indexed by TransformStore slot
+        std::vector<TransformState> transforms;
+        std::vector<uint8_t> moved;
+        uint64_t hierarchyGeneration = 0;
+        std::vector<uint32_t> parents;
+        // the transform slot of every ObjectData record: drawn entities, then lights
+        std::vector<uint32_t> instanceSlots;
+    };
+
+    // the transforms of the last frame drawn, between two snapshots
+    struct RenderTransforms {
+        TransformStore store;
+        uint64_t tick = 0;
+        uint64_t hierarchyGeneration = 0;
+
+        // only slots that moved in either snapshot are interpolated again, unless a tick went unseen
+        void interpolate(const SimulationSnapshot& from, const SimulationSnapshot& to, float alpha, JobSystem& jobs);
+    };
+
+    // where the meshlet culling pass puts its jobs and draws
+    struct MeshletCullLayout {
+        uint32_t jobCount = 0;
+        uint32_t drawCount = 0;
+        // set when an instance moved between the culled and the whole draws
+        bool slotsChanged = false;
+    };
+
+    // a model matrix per instance, written in instance order
+    void writeModelMatrices(glm::mat4* models, const TransformStore& transforms, std::span<const uint32_t> instanceSlots, JobSystem& jobs);
+    // the drawn entities' records; lights follow them
+    void writeObjectData(ObjectData* data, SceneRegistry& scene);
+    // copies each LOD instance's level for its projected size into its MeshRef; true if any changed
+    bool selectLodLevels(SceneRegistry& scene, const TransformStore& transforms, glm::vec3 cameraPosition, float pixelsPerUnit,
+        float pixelError, JobSystem& jobs);
+    // a job per meshlet and a draw template per culled instance; drawSlots gets the template of every instance,
+    // or NO_MESHLET_DRAW for those drawn whole
+    MeshletCullLayout writeMeshletCullJobs(SceneRegistry& scene, MeshletCullJob* jobs, vk::DrawIndexedIndirectCommand* draws,
+        std::vector<uint32_t>& drawSlots);
+    MeshletCullDispatch meshletCullDispatch(uint32_t jobCount);
+    // a draw per instance, with no instances for those the culling pass draws
+    void writeDrawCommands(vk::DrawIndexedIndirectCommand* commands, SceneRegistry& scene, std::span<const uint32_t> drawSlots);
+    // the handles executeCommands takes, from the frame's memory
+    std::pmr::vector<vk::CommandBuffer> gatherCommandBuffers(std::span<const vk::raii::CommandBuffer> buffers, std::pmr::memory_resource* memory);
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace tinygltf {
+    class Model;
+}
+
+namespace volchara {
+    // reads a glTF accessor where it lies, through its buffer view's stride, and decodes any component type;
+    // only sparse accessors are copied, to apply their substitutions once
+    class AccessorView {
+        private:
+        const unsigned char* begin = nullptr;
+        size_t stride = 0;
+        size_t elementCount = 0;
+        int componentType = 0;
+        uint32_t components = 0;
+        bool normalized = false;
+        // the dense elements of a sparse accessor, or of one without a buffer view
+        std::vector<unsigned char> dense;
+
+        public:
+        AccessorView(const tinygltf::Model& model, int accessor);
+        // begin may point into dense
+        AccessorView(const AccessorView&) = delete;
+        AccessorView& operator=(const AccessorView&) = delete;
+
+        size_t count() const;
+        uint32_t componentCount() const;
+        // scalar unsigned byte, short or int elements, e.g. indices
+        uint32_t readIndex(size_t element) const;
+        // up to outCount components, leaving the rest of out as it is; normalized integers decode to [0, 1] or [-1, 1],
+        // others convert as they are
+        void readFloats(size_t element, float* out, uint32_t outCount) const;
+    };
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+
+#include <vulkan/vulkan_raii.hpp>
+#include <vk_mem_alloc.hpp>
+
+#include <memory_stats.hpp>
+#include <raii_wrappers.hpp>
+#include <staging_ring.hpp>
+
+namespace volchara {
+    // a device local buffer of fixed-size elements that is replaced by a larger copy of itself when it fills up
+    class GrowableBuffer {
+        private:
+        RAIIAllocator* allocator = nullptr;
+        RAIIvmaBuffer buffer = nullptr;
+        vk::DeviceSize elementSize = 0;
+        uint32_t elementCapacity = 0;
+        vk::BufferUsageFlags usage;
+        MemoryCategory category = MemoryCategory::Other;
+        std::span<const uint32_t> queueFamilies;
+
+        public:
+        // shared between queueFamilies if there are several, which have to outlive the buffer
+        GrowableBuffer(RAIIAllocator& allocator, vk::DeviceSize elementSize, uint32_t capacity, vk::BufferUsageFlags usage, MemoryCategory category,
+            std::span<const uint32_t> queueFamilies = {});
+        GrowableBuffer(nullptr_t) {}
+        uint32_t capacity() const;
+        operator vk::Buffer() const;
+        // for defragmentation to move
+        RAIIvmaBuffer& deviceBuffer();
+        // copies the first `used` elements over on the GPU through the ring and returns the buffer it replaced,
+        // which frames already recorded may still read
+        RAIIvmaBuffer grow(uint32_t newCapacity, uint32_t used, StagingRing& ring);
+    };
+}
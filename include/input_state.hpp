@@ -0,0 +1,54 @@
+#pragma once
+
+#include <bitset>
+
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+
+namespace volchara {
+    // keyboard and mouse state for one simulation tick, indexed by GLFW key codes
+    class InputState {
+        private:
+        std::bitset<GLFW_KEY_LAST + 1> down;
+        std::bitset<GLFW_KEY_LAST + 1> pressed;
+        std::bitset<GLFW_KEY_LAST + 1> released;
+        glm::vec2 mouseDelta{0.0f};
+
+        static bool isValidKey(int key) {
+            return key >= 0 && key <= GLFW_KEY_LAST;
+        }
+        public:
+        bool isDown(int key) const {
+            return isValidKey(key) && down.test(key);
+        }
+        // edges are kept for one tick, a tap shorter than a tick shows up as both
+        bool wasPressed(int key) const {
+            return isValidKey(key) && pressed.test(key);
+        }
+        bool wasReleased(int key) const {
+            return isValidKey(key) && released.test(key);
+        }
+        glm::vec2 cursorDelta() const {
+            return mouseDelta;
+        }
+
+        void beginTick() {
+            pressed.reset();
+            released.reset();
+            mouseDelta = glm::vec2(0.0f);
+        }
+        void press(int key) {
+            if (!isValidKey(key)) return;
+            down.set(key);
+            pressed.set(key);
+        }
+        void release(int key) {
+            if (!isValidKey(key)) return;
+            down.reset(key);
+            released.set(key);
+        }
+        void moveCursor(glm::vec2 delta) {
+            mouseDelta += delta;
+        }
+    };
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace volchara {
+    // counts unfinished jobs; a job waiting on a counter of its own children runs other work meanwhile
+    class JobCounter {
+        friend class JobSystem;
+        private:
+        std::atomic<size_t> pending{0};
+        std::mutex errorMutex;
+        std::exception_ptr error = nullptr;
+        public:
+        JobCounter() = default;
+        JobCounter(JobCounter&) = delete;
+        JobCounter& operator=(JobCounter&) = delete;
+        bool done() const;
+    };
+
+    // a callable that isn't owned or copied, so passing a capturing lambda allocates nothing; it must outlive every call
+    template<typename Signature>
+    class FunctionRef;
+    template<typename Result, typename... Args>
+    class FunctionRef<Result(Args...)> {
+        private:
+        void* callable;
+        Result (*invoke)(void*, Args...);
+
+        public:
+        template<typename Fn> requires (!std::is_same_v<std::remove_cvref_t<Fn>, FunctionRef> && std::is_invocable_r_v<Result, Fn&, Args...>)
+        FunctionRef(Fn&& fn)
+                : callable(const_cast<void*>(static_cast<const void*>(std::addressof(fn)))),
+                invoke([](void* callable, Args... args) -> Result {
+                    return (*static_cast<std::remove_reference_t<Fn>*>(callable))(std::forward<Args>(args)...);
+                }) {}
+        Result operator()(Args... args) const {
+            return invoke(callable, std::forward<Args>(args)...);
+        }
+    };
+
+    class JobSystem {
+        private:
+        struct Job {
+            std::function<void()> task;
+            JobCounter* counter;
+        };
+        struct JobQueue {
+            std::mutex mutex;
+            // keeps the deque's freed chunks, so a queue that has held this many jobs before doesn't allocate
+            std::pmr::unsynchronized_pool_resource pool;
+            std::pmr::deque<Job> jobs{&pool};
+
+            JobQueue();
+        };
+        // every queue has held this many jobs once, so fan-outs up to it don't allocate the first time they run deep
+        static constexpr size_t RESERVED_QUEUE_JOBS = 1024;
+
+        std::vector<std::thread> threads;
+        // [0] takes jobs from threads that aren't workers, [1..] belong to the workers
+        std::vector<std::unique_ptr<JobQueue>> queues;
+        std::atomic<size_t> queuedJobs{0};
+        std::mutex sleepMutex;
+        std::condition_variable wakeCondition;
+        bool stopping = false;
+
+        size_t currentQueue() const;
+        bool popJob(size_t queueIndex, bool newest, Job& job);
+        bool tryRunJob();
+        void execute(Job& job);
+        void workerLoop(size_t queueIndex);
+        public:
+        static size_t defaultThreadCount();
+        // zero threads is the deterministic mode: jobs run in submission order on the waiting thread
+        explicit JobSystem(size_t threadCount = defaultThreadCount());
+        ~JobSystem();
+        JobSystem(JobSystem&) = delete;
+        JobSystem& operator=(JobSystem&) = delete;
+        // worker threads + the waiting thread
+        size_t concurrency() const;
+        bool isSingleThreaded() const;
+        void run(JobCounter& counter, std::function<void()> task);
+        // runs queued jobs until the counter drops to zero, rethrows the first job exception
+        void wait(JobCounter& counter);
+        // runs task(0) .. task(count - 1) as separate jobs and waits for them
+        void parallelFor(size_t count, FunctionRef<void(size_t)> task);
+        // splits [0, count) into grainSize-sized ranges and waits for them
+        void parallelForRange(size_t count, size_t grainSize, FunctionRef<void(size_t, size_t)> task);
+    };
+}
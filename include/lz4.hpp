@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace volchara {
+    // the LZ4 block format without a frame around it; whoever stores a block stores its decompressed size too
+    std::vector<std::byte> lz4Compress(std::span<const std::byte> input);
+    // throws unless the block decompresses to exactly output.size() bytes
+    void lz4Decompress(std::span<const std::byte> input, std::span<std::byte> output);
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+
+namespace volchara {
+    // a whole file mapped read-only, unmapped with the last owner
+    class MappedFile {
+        private:
+        const std::byte* begin = nullptr;
+        size_t length = 0;
+        #if defined(_WIN32)
+        void* mapping = nullptr;
+        #endif
+
+        public:
+        explicit MappedFile(const std::filesystem::path& path);
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        ~MappedFile();
+
+        const std::byte* data() const;
+        size_t size() const;
+    };
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace volchara {
+    // what a buffer or image is for, so the allocator can tell how much each part of the renderer holds
+    enum class MemoryCategory : uint32_t {
+        Geometry,
+        Textures,
+        Attachments,
+        Staging,
+        // uniforms and the other buffers written per frame in flight: object data, matrices, draw commands
+        Uniforms,
+        Other,
+    };
+    const size_t MEMORY_CATEGORY_COUNT = 6;
+    const char* memoryCategoryName(MemoryCategory category);
+
+    // a heap is reported near its budget past this share of it, and again only after dropping below the second
+    const float MEMORY_BUDGET_WARNING = 0.9f;
+    const float MEMORY_BUDGET_WARNING_RESET = 0.8f;
+
+    struct HeapUsage {
+        bool deviceLocal = false;
+        uint64_t size = 0;
+        // what the whole process uses and may use, from VK_EXT_memory_budget when the device has it
+        uint64_t usage = 0;
+        uint64_t budget = 0;
+        // VMA's own blocks, and the part of them its allocations use
+        uint64_t blockBytes = 0;
+        uint64_t allocationBytes = 0;
+        uint32_t allocationCount = 0;
+    };
+
+    struct FragmentationStats {
+        // free space inside VMA's blocks, and how it is split up
+        uint64_t unusedBytes = 0;
+        uint64_t largestUnusedRange = 0;
+        uint32_t unusedRangeCount = 0;
+        // what defragmentation has moved so far
+        uint32_t passes = 0;
+        uint32_t allocationsMoved = 0;
+        uint64_t bytesMoved = 0;
+        // the share of the free space outside its largest range: 0 when it is all in one piece
+        float fragmentation() const;
+    };
+
+    struct CategoryUsage {
+        uint64_t bytes = 0;
+        uint32_t allocationCount = 0;
+    };
+
+    struct MemoryReport {
+        std::vector<HeapUsage> heaps;
+        std::array<CategoryUsage, MEMORY_CATEGORY_COUNT> categories;
+        FragmentationStats fragmentation;
+        // without it, VMA estimates budgets from the heap sizes and usage from its own allocations
+        bool driverBudget = false;
+    };
+
+    // one line per heap and category
+    std::string describeMemoryReport(const MemoryReport& report);
+
+    // the bytes live allocations of each category hold; updated from whichever thread allocates
+    class MemoryAccounting {
+        private:
+        std::array<std::atomic<uint64_t>, MEMORY_CATEGORY_COUNT> bytes{};
+        std::array<std::atomic<uint32_t>, MEMORY_CATEGORY_COUNT> counts{};
+
+        public:
+        void add(MemoryCategory category, uint64_t size);
+        void remove(MemoryCategory category, uint64_t size);
+        std::array<CategoryUsage, MEMORY_CATEGORY_COUNT> usage() const;
+    };
+}
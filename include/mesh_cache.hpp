@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <mapped_file.hpp>
+#include <mesh_simplifier.hpp>
+#include <meshlet.hpp>
+#include <objects.hpp>
+#include <scene_registry.hpp>
+#include <vertex_layout.hpp>
+
+namespace volchara {
+    // bumped whenever a cached struct or the preprocessing changes, so stale caches are rebuilt
+    const uint32_t MESH_CACHE_VERSION = 5;
+
+    // glTF node transform and parent; plain floats, so the layout doesn't depend on glm's alignment
+    struct CachedNode {
+        float translation[3];
+        float scaling[3];
+        float rotation[4];  // x, y, z, w
+        int32_t parent;
+    };
+
+    struct CachedLodChain {
+        LodLevel levels[MAX_LOD_LEVELS];
+        uint32_t levelCount;
+        float center[3];
+        float radius;
+    };
+
+    // a glTF material's base color: an image of the model, or a solid color without one
+    struct CachedMaterial {
+        int32_t image = -1;
+        float color[3] = {1.0f, 1.0f, 1.0f};
+    };
+
+    // an image of the model: its encoded bytes when embedded, otherwise its path relative to the model's directory
+    struct CachedTexture {
+        int32_t image = 0;
+        std::string uri;
+        // empty if the image is only referred to by uri; points into the model or the cache mapping
+        std::span<const std::byte> encoded;
+    };
+
+    // a preprocessed model: welded, optimized, with LODs and meshlets, and vertices already in the GPU streams
+    struct MeshCacheData {
+        std::span<const PositionStream> positions;
+        std::span<const AttributeStream> attributes;
+        std::span<const uint32_t> indices;
+        std::span<const Meshlet> meshlets;
+        std::span<const CachedNode> nodes;
+        std::span<const Submesh> submeshes;
+        std::span<const CachedLodChain> lods;
+        std::span<const CachedMaterial> materials;
+        std::vector<CachedTexture> textures;
+    };
+
+    // a cache file mapped into memory; data points into the mapping
+    class MeshCache {
+        private:
+        MappedFile file;
+
+        public:
+        MeshCacheData data;
+
+        explicit MeshCache(const std::filesystem::path& cachePath);
+        // nullptr if the cache is missing, unreadable, from another version, or wasn't built from the model file and its
+        // external buffers as they are now, with these LOD settings and the current meshlet and vertex cache limits
+        static std::shared_ptr<const MeshCache> open(const std::filesystem::path& cachePath, const std::filesystem::path& modelPath,
+            const LodSettings& lodSettings);
+    };
+
+    // kept next to the model
+    std::filesystem::path meshCachePath(const std::filesystem::path& modelPath);
+    // written to a temporary file first, so an interrupted write never leaves a cache behind; bufferUris are the model's
+    // external buffer files relative to its directory, whose sizes and modification times are recorded with the model's
+    void writeMeshCache(const std::filesystem::path& cachePath, const std::filesystem::path& modelPath, std::span<const std::string> bufferUris,
+        const LodSettings& lodSettings, const MeshCacheData& data);
+}
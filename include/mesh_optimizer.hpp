@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace volchara {
+    // the post-transform cache modelled by the statistics, a FIFO the size of a typical GPU's
+    const uint32_t VERTEX_CACHE_SIZE = 16;
+
+    struct VertexCacheStats {
+        float acmr = 0.0f;  // transformed vertices per triangle, 0.5 at best
+        float atvr = 0.0f;  // transformed vertices per referenced vertex, 1 at best
+    };
+
+    struct MeshOptimizationReport {
+        VertexCacheStats before;
+        VertexCacheStats after;
+    };
+
+    // triangles are [first, first + count) of an index buffer, optimized and drawn on their own
+    struct IndexRange {
+        uint32_t first = 0;
+        uint32_t count = 0;
+    };
+
+    VertexCacheStats analyzeVertexCache(std::span<const uint32_t> indices, uint32_t cacheSize = VERTEX_CACHE_SIZE);
+
+    // reorders each range's triangles with Tipsify, then sorts the resulting clusters so outward facing ones come first;
+    // positions are read as three floats every positionStride bytes
+    MeshOptimizationReport optimizeIndexRanges(std::vector<uint32_t>& indices, std::span<const IndexRange> ranges,
+        const float* positions, size_t positionStride, size_t vertexCount);
+
+    // renumbers vertices in order of first use and returns the old index of every new vertex;
+    // vertices no index refers to are dropped
+    std::vector<uint32_t> optimizeVertexFetch(std::vector<uint32_t>& indices, size_t vertexCount);
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace volchara {
+    struct LodSettings {
+        // levels generated below the full mesh
+        uint32_t maxLevels = 4;
+        // every level aims for this fraction of the previous level's triangles
+        float reduction = 0.5f;
+        // no level deviates from the full mesh by more than this fraction of its bounding radius
+        float maxError = 0.05f;
+    };
+
+    // quadric error metric edge collapse; a vertex only ever collapses onto one of its neighbours,
+    // so the result indexes the same vertices. vertices on open borders or sharing their position with another one
+    // (attribute seams) stay in place. stops at targetIndexCount indices or before a collapse would cost more than maxError,
+    // with resultError set to the largest error accepted, as a distance
+    std::vector<uint32_t> simplifyMesh(std::span<const uint32_t> indices, const float* positions, size_t positionStride, size_t vertexCount,
+        size_t targetIndexCount, float maxError, float* resultError = nullptr);
+}
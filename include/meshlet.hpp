@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <mesh_optimizer.hpp>
+
+namespace volchara {
+    const uint32_t MAX_MESHLET_VERTICES = 64;
+    const uint32_t MAX_MESHLET_TRIANGLES = 124;
+
+    // a contiguous run of a mesh's indices with bounds for culling, laid out as the culling shader reads it (std430);
+    // plain floats, as aligned glm types would pad the vectors
+    struct Meshlet {
+        float center[3] = {0.0f, 0.0f, 0.0f};
+        float radius = 0.0f;
+        // every triangle faces away from a viewer at p when dot(center - p, coneAxis) >= coneCutoff * |center - p| + radius
+        float coneAxis[3] = {0.0f, 0.0f, 0.0f};
+        float coneCutoff = 1.0f;
+        uint32_t firstIndex = 0;
+        uint32_t indexCount = 0;
+        uint32_t padding[2] = {0, 0};
+    };
+    static_assert(sizeof(Meshlet) == 48);
+
+    // one meshlet of one drawn instance, appended to its draw's culled indices when visible
+    struct MeshletCullJob {
+        uint32_t meshlet = 0;
+        uint32_t instance = 0;
+        uint32_t draw = 0;
+    };
+
+    // the culling pass's indirect dispatch, a workgroup per job in rows, and the job count the rows round up
+    struct MeshletCullDispatch {
+        uint32_t groupCountX = 0;
+        uint32_t groupCountY = 0;
+        uint32_t groupCountZ = 1;
+        uint32_t jobCount = 0;
+    };
+    static_assert(sizeof(MeshletCullDispatch) == 16);
+
+    // splits the range's triangles in their current order, so a vertex cache optimized range gives compact meshlets;
+    // firstIndex of the results points into `indices`
+    std::vector<Meshlet> buildMeshlets(const std::vector<uint32_t>& indices, const IndexRange& range,
+        const float* positions, size_t positionStride, size_t vertexCount);
+}
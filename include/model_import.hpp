@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include <job_system.hpp>
+#include <mesh_cache.hpp>
+#include <meshlet.hpp>
+#include <objects.hpp>
+#include <scene_registry.hpp>
+#include <transform_store.hpp>
+#include <vertex_layout.hpp>
+
+namespace volchara {
+    // tightly packed RGBA pixels, decoded away from the thread that uploads them
+    struct DecodedImage {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        // freed by stb_image
+        std::shared_ptr<unsigned char> pixels;
+    };
+
+    // a glTF model read, preprocessed and with its images decoded, without touching the renderer, so any thread can import one
+    struct ImportedModel {
+        std::vector<PositionStream> positions;
+        std::vector<AttributeStream> attributes;
+        std::vector<uint32_t> indices;
+        std::vector<Meshlet> meshlets;
+        // uploaded instead of the vertex data above when the model came from its cache
+        std::shared_ptr<const MeshCache> meshCache;
+        std::vector<TransformState> nodes;
+        std::vector<int> nodeParents;
+        std::vector<Submesh> submeshes;
+        std::vector<LodChain> lods;
+        std::vector<CachedMaterial> materials;
+        // by glTF image, only those a material samples
+        std::map<int32_t, DecodedImage> images;
+    };
+
+    // an imported model whose geometry and images are already on the GPU, so adopting it never waits for an upload
+    struct LoadedModel {
+        ImportedModel model;
+        std::shared_ptr<GeometryAllocation> geometry;
+        // the renderer's texture for each of model.images, whose pixels are freed
+        std::map<int32_t, uint32_t> textures;
+    };
+
+    // any format stb_image reads
+    DecodedImage decodeImage(std::span<const std::byte> encoded);
+    DecodedImage decodeImageFile(const std::filesystem::path& path);
+    // parses the model and caches the result next to it, or maps that cache when it is up to date;
+    // jobs, if given, share out welding and image decoding
+    ImportedModel importGLTFModel(const std::filesystem::path& modelPath, JobSystem* jobs = nullptr);
+    // writes the model's cache even when it is up to date, without decoding images; for converting models ahead of time
+    void convertGLTFModel(const std::filesystem::path& modelPath, JobSystem* jobs = nullptr);
+}
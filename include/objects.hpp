@@ -2,17 +2,29 @@
 
 #include <array>
 #include <filesystem>
-#include <functional>
+#include <map>
+#include <memory>
 #include <vector>
-#include <set>
 
 #include <vulkan/vulkan_raii.hpp>
 #include <glm/glm.hpp>
 #include <glm/gtx/transform.hpp>
 #include <glm/gtx/quaternion.hpp>
 
+#include <asset_loader.hpp>
+#include <input_state.hpp>
+#include <mesh_simplifier.hpp>
+#include <meshlet.hpp>
+#include <scene_registry.hpp>
+#include <transform_store.hpp>
+#include <vertex_layout.hpp>
+
 namespace volchara {
     class Renderer;
+    class MeshCache;
+    struct DecodedImage;
+    struct ImportedModel;
+    struct LoadedModel;
 
     struct InitDataPlane {
         std::array<float, 3> topLeft;
@@ -53,23 +65,13 @@ namespace volchara {
         float brightness = 0.0f;
     };
 
-    struct Vertex {
-        glm::vec3 pos;
-        glm::vec3 normal;
-        glm::vec3 color{0, 0, 0};
-        glm::vec2 texCoord;
-
-        bool operator==(const Vertex& other) const;
-        static vk::VertexInputBindingDescription getBindingDescription();
-        static std::vector<vk::VertexInputAttributeDescription> getAttributeDescriptions();
-    };
-
+    // a handle to a slot in a TransformStore; copies get their own slot
     class Transform {
-        public:
-        glm::vec3 translation{0,0,0};
-        glm::vec3 scaling{1,1,1};
-        glm::quat rotationQuat{1,0,0,0};
+        private:
+        TransformStore* store = nullptr;
+        uint32_t slot = 0;
 
+        public:
         class Position {
             private:
             Transform* parent;
@@ -98,12 +100,68 @@ namespace volchara {
         };
         Rotation rotation = nullptr;
 
-        Transform() {
-            position = Position(this);
-            rotation = Rotation(this);
-        }
+        explicit Transform(TransformStore& store, const TransformState& state = {});
+        Transform(const Transform& other);
+        Transform(Transform&& other) noexcept;
+        Transform& operator=(const Transform& other);
+        Transform& operator=(Transform&& other) noexcept;
+        ~Transform();
+
+        glm::vec3 translation() const;
+        void setTranslation(glm::vec3 translation);
+        glm::vec3 scaling() const;
+        void setScaling(glm::vec3 scaling);
+        glm::quat rotationQuat() const;
+        void setRotationQuat(glm::quat rotation);
+        // set by every mutator, cleared once the renderer has taken the new state
+        bool isDirty() const;
+        void clearDirty();
+        // both transforms have to live in the same store
+        void setParent(const Transform& parent);
+        void clearParent();
+        uint32_t slotIndex() const;
 
-        glm::mat4 modelMatrix();
+        // relative to the parent
+        glm::mat4 modelMatrix() const;
+        TransformState state() const;
+    };
+
+    // a range of an object's indices drawn with one of its node transforms and one of its materials
+    struct Submesh {
+        uint32_t firstIndex = 0;
+        uint32_t indexCount = 0;
+        uint32_t node = 0;
+        // an index into the object's materials
+        uint32_t material = 0;
+        // a range of the object's meshlets, empty unless they were generated
+        uint32_t firstMeshlet = 0;
+        uint32_t meshletCount = 0;
+    };
+
+    // reorders each range's triangles for the vertex cache and overdraw, then the vertices in order of first use
+    void optimizeGeometry(std::vector<PositionStream>& positions, std::vector<AttributeStream>& attributes, std::vector<uint32_t>& indices,
+        const std::vector<IndexRange>& ranges);
+    // a chain per submesh, or one for the whole mesh without submeshes; the levels are appended to indices
+    std::vector<LodChain> buildSubmeshLods(const std::vector<PositionStream>& positions, std::vector<uint32_t>& indices,
+        const std::vector<Submesh>& submeshes, const LodSettings& settings = {});
+    // the meshlets of every submesh, or of the whole mesh without submeshes; sets the submeshes' meshlet ranges
+    std::vector<Meshlet> buildSubmeshMeshlets(const std::vector<PositionStream>& positions, const std::vector<uint32_t>& indices,
+        std::vector<Submesh>& submeshes);
+
+    // a mesh uploaded to the renderer's vertex and index buffers, released with the last object using it
+    struct GeometryAllocation {
+        Renderer* renderer = nullptr;
+        uint32_t firstVertex = 0;
+        uint32_t vertexCount = 0;
+        uint32_t firstIndex = 0;
+        uint32_t indexCount = 0;
+        uint32_t firstMeshlet = 0;
+        uint32_t meshletCount = 0;
+
+        GeometryAllocation() = default;
+        GeometryAllocation(const GeometryAllocation&) = delete;
+        GeometryAllocation& operator=(const GeometryAllocation&) = delete;
+        ~GeometryAllocation();
     };
 
     class CameraTransform : public Transform {
@@ -111,41 +169,102 @@ namespace volchara {
             glm::mat4 modelMatrix();
     };
 
+    // a facade over an entity in the renderer's SceneRegistry, which the per-frame loops iterate instead
     class Object {
     public:
-        std::vector<Vertex> vertices;
+        // moved to the renderer when the object is first added, then freed unless keepGeometry is set;
+        // vertices are kept packed the way the GPU reads them
+        std::vector<PositionStream> positions;
+        std::vector<AttributeStream> attributes;
         std::vector<uint32_t> indices;
-        std::vector<std::function<void(Object*, float, std::set<int>)>> frameCallbacks{};
+        bool keepGeometry = false;
+        // shared by copies, so they draw the same uploaded mesh
+        std::shared_ptr<GeometryAllocation> geometry;
         Transform transform;
+        Entity entity;
+        // the entities drawn for the object while it is added to the renderer
+        std::vector<Entity> instances;
+        // transforms below `transform`, e.g. glTF nodes; a negative parent is `transform` itself
+        std::vector<Transform> nodes;
+        std::vector<int> nodeParents;
+        // drawn instead of the whole index range when not empty
+        std::vector<Submesh> submeshes;
+        // picked by Submesh::material; instances without one use textureIndex and color
+        std::vector<Material> materials;
+        // one chain per submesh, or for the whole mesh, with ranges of `indices`; empty without LODs
+        std::vector<LodChain> lods;
+        // clusters of the full mesh's submeshes, or all of it without submeshes; uploaded and freed with the geometry
+        std::vector<Meshlet> meshlets;
+        // uploaded instead of positions, attributes, indices and meshlets when set; released like them
+        std::shared_ptr<const MeshCache> meshCache;
+        // loads on the renderer's asset loader, which uploads them too; swapped in by the simulation thread once they finish
+        // while the object is added. until then it draws what it drew before, e.g. the placeholder cube and uv.png
+        std::shared_ptr<AssetLoad<LoadedModel>> pendingModel;
+        // the texture's index
+        std::shared_ptr<AssetLoad<uint32_t>> pendingTexture;
         Renderer* renderer;
         uint32_t textureIndex = 0;
-        uint32_t maxVertexIndex = 0;
+        // a solid color drawn instead of the texture unless black
+        glm::vec3 color{0.0f, 0.0f, 0.0f};
 
         Object(Renderer &renderer, std::vector<Vertex> initVertices, std::vector<uint32_t> initIndices = {}, glm::vec3 translation = {0, 0, 0}, glm::vec3 scaling = {1, 1, 1}, glm::quat rotation = {1,0,0,0});
-        virtual ~Object() = default;  // for RTTI and callback polymorphism
-        void runFrameCallbacks(float passedSeconds, std::set<int> pressedKeys);
+        // copies get their own node transforms, linked the same way as the original's
+        Object(const Object& other);
+        Object(Object&& other) noexcept;
+        Object& operator=(const Object& other);
+        Object& operator=(Object&& other) noexcept;
+        virtual ~Object();  // for RTTI and callback polymorphism
+        // called once per simulation tick while the object is added; serial unless it only changes this object,
+        // see CallbackExecution
+        void addFrameCallback(FrameCallback callback, CallbackExecution execution = CallbackExecution::Serial);
+        // all of them, parallel ones first, on the calling thread
+        void runFrameCallbacks(float passedSeconds, const InputState& input);
         void setColor(std::array<float, 3> color);
         void loadTexture(const std::filesystem::path path);
-        void generateIndices(std::vector<Vertex> fromVertices);
+        // returns at once; the image is decoded and uploaded in the background and swapped in once the object is added
+        void loadTextureAsync(const std::filesystem::path path);
+        bool isLoading() const;
+        // takes over a model's nodes, geometry and materials, uploading its images; not while the object is added
+        void adoptModel(ImportedModel&& model);
+        // the same for a model already uploaded, keeping its streams only if keepGeometry is set
+        void adoptModel(LoadedModel&& model);
+        // welds equal vertices, or ones within weldEpsilon of a common grid point, then optimizes the mesh
+        void generateIndices(const std::vector<Vertex>& fromVertices, float weldEpsilon = 0.0f);
+        // appends simplified index ranges of every submesh to `indices`; has to run before the object is first added
+        void generateLods(const LodSettings& settings = {});
+        // splits every submesh into meshlets the renderer culls one by one; has to run before the object is first added
+        void generateMeshlets();
+        void setParent(Object& parent);
+
+    protected:
+        // everything but the geometry and textures, with textures by glTF image
+        void adoptModelData(ImportedModel&& model, const std::map<int32_t, uint32_t>& textures);
+        void linkNodes();
+        void copyFrameCallbacks(const Object& other);
+        void adoptFrameCallbacks();
+        void releaseEntities();
     };
 
     class Camera : public Object {
         public:
             Camera(Renderer& renderer) : Object(renderer, {}) {
-                transform.rotationQuat = glm::toQuat(glm::lookAt(glm::vec3{0, 0, 1}, {0, 0, 0}, {0, 1, 0}));
+                transform.setRotationQuat(glm::toQuat(glm::lookAt(glm::vec3{0, 0, 1}, {0, 0, 0}, {0, 1, 0})));
             }
     };
 
     class Plane : public Object {
         public:
             static Plane fromWorldCoordinates(Renderer& renderer, InitDataPlane initVertices, bool wIndices = true);
-            Plane(Renderer& renderer, std::vector<Vertex> vertices, std::vector<uint32_t> indices = {}, glm::vec3 translation = {0, 0, 0}, glm::vec3 scaling = {1, 1, 1}, glm::quat rotation = {1,0,0,0}) : Object(renderer, vertices, indices, translation, scaling, rotation) {};
+            Plane(Renderer& renderer, std::vector<Vertex> vertices, std::vector<uint32_t> indices = {}, glm::vec3 translation = {0, 0, 0}, glm::vec3 scaling = {1, 1, 1}, glm::quat rotation = {1,0,0,0}) : Object(renderer, std::move(vertices), std::move(indices), translation, scaling, rotation) {};
     };
 
     class GLTFModel : public Object {
         public:
+            // parses the model and caches the result next to it, or maps that cache when it is up to date
             static GLTFModel fromFile(Renderer& renderer, std::filesystem::path modelPath);
-            GLTFModel(Renderer& renderer, std::vector<Vertex> vertices, std::vector<uint32_t> indices = {}, glm::vec3 translation = {0, 0, 0}, glm::vec3 scaling = {1, 1, 1}, glm::quat rotation = {1,0,0,0}) : Object(renderer, vertices, indices, translation, scaling, rotation) {};
+            // returns at once with a placeholder cube, which the model replaces once it is imported and uploaded
+            static GLTFModel fromFileAsync(Renderer& renderer, std::filesystem::path modelPath);
+            GLTFModel(Renderer& renderer, std::vector<Vertex> vertices, std::vector<uint32_t> indices = {}, glm::vec3 translation = {0, 0, 0}, glm::vec3 scaling = {1, 1, 1}, glm::quat rotation = {1,0,0,0}) : Object(renderer, std::move(vertices), std::move(indices), translation, scaling, rotation) {};
     };
 
     class Box : public Object {
@@ -153,7 +272,7 @@ namespace volchara {
             static std::array<glm::vec3, 3> calcOrientation(InitDataPlane frontOrientationPlane);
         public:
             static Box fromWorldCoordinates(Renderer& renderer, InitDataBox initVertices, bool wIndices = true);
-            Box(Renderer& renderer, std::vector<Vertex> vertices, std::vector<uint32_t> indices = {}, glm::vec3 translation = {0, 0, 0}, glm::vec3 scaling = {1, 1, 1}, glm::quat rotation = {1,0,0,0}) : Object(renderer, vertices, indices, translation, scaling, rotation) {};
+            Box(Renderer& renderer, std::vector<Vertex> vertices, std::vector<uint32_t> indices = {}, glm::vec3 translation = {0, 0, 0}, glm::vec3 scaling = {1, 1, 1}, glm::quat rotation = {1,0,0,0}) : Object(renderer, std::move(vertices), std::move(indices), translation, scaling, rotation) {};
     };
 
     class AmbientLight : public Object {
@@ -1,9 +1,13 @@
 #pragma once
 
+#include <memory>
+#include <string>
+
 #include <vulkan/vulkan_raii.hpp>
 #include <vk_mem_alloc.hpp>
 
 #include <device_buffer_copy_handler.hpp>
+#include <memory_stats.hpp>
 
 namespace volchara {
     class RAIIvmaBuffer {
@@ -14,8 +18,14 @@ namespace volchara {
         vma::Allocation alloc = nullptr;
         bool mappable = false;
         DeviceBufferCopyHandler* copyHandler = nullptr;
+        MemoryAccounting* accounting = nullptr;
+        MemoryCategory category = MemoryCategory::Other;
+        vk::DeviceSize allocationSize = 0;
+        // kept to create the buffer again where defragmentation moves it
+        vk::BufferCreateInfo bufferInfo;
+        vk::Buffer movedBuf = nullptr;
         public:
-        RAIIvmaBuffer(vk::raii::Device& dev, vma::Allocator& fromAllocator, vk::BufferCreateInfo bufferInfo, vma::AllocationCreateInfo allocInfo, DeviceBufferCopyHandler& handler);
+        RAIIvmaBuffer(vk::raii::Device& dev, vma::Allocator& fromAllocator, vk::BufferCreateInfo bufferInfo, vma::AllocationCreateInfo allocInfo, DeviceBufferCopyHandler& handler, MemoryAccounting* accounting = nullptr, MemoryCategory category = MemoryCategory::Other);
         RAIIvmaBuffer(nullptr_t) {}
         ~RAIIvmaBuffer();
         RAIIvmaBuffer(RAIIvmaBuffer&) = delete;
@@ -24,8 +34,14 @@ namespace volchara {
         const RAIIvmaBuffer& operator=(RAIIvmaBuffer&& other);
         operator vk::Buffer() const;
         operator vma::Allocation() const;
-        void copyFrom(void* buffer, uint32_t size);
+        void copyFrom(const void* buffer, uint32_t size, vk::DeviceSize offset = 0);
+        void flush(vk::DeviceSize offset, vk::DeviceSize size);
         vma::AllocationInfo allocInfo();
+        vk::DeviceSize size() const;
+        // defragmentation: a buffer bound to destination that the contents are copied to, and that replaces this
+        // one in finishMove once they have been
+        vk::Buffer beginMove(vma::Allocation destination);
+        void finishMove();
         static void swap(RAIIvmaBuffer& lhs, RAIIvmaBuffer& rhs);
     };
 
@@ -39,8 +55,14 @@ namespace volchara {
         bool mappable = false;
         DeviceBufferCopyHandler* copyHandler = nullptr;
         vk::Extent3D imageExtent;
+        MemoryAccounting* accounting = nullptr;
+        MemoryCategory category = MemoryCategory::Other;
+        vk::DeviceSize allocationSize = 0;
+        vk::ImageCreateInfo imageInfo;
+        vk::ImageAspectFlags aspectFlags;
+        vk::Image movedImg = nullptr;
         public:
-        RAIIvmaImage(vk::raii::Device& dev, vma::Allocator& fromAllocator, vk::ImageCreateInfo imageInfo, vma::AllocationCreateInfo allocInfo, DeviceBufferCopyHandler& handler, vk::ImageAspectFlags aspectFlags);
+        RAIIvmaImage(vk::raii::Device& dev, vma::Allocator& fromAllocator, vk::ImageCreateInfo imageInfo, vma::AllocationCreateInfo allocInfo, DeviceBufferCopyHandler& handler, vk::ImageAspectFlags aspectFlags, MemoryAccounting* accounting = nullptr, MemoryCategory category = MemoryCategory::Other);
         RAIIvmaImage(nullptr_t) {}
         ~RAIIvmaImage();
         RAIIvmaImage(RAIIvmaImage&) = delete;
@@ -49,8 +71,12 @@ namespace volchara {
         const RAIIvmaImage& operator=(RAIIvmaImage&& other);
         operator vk::Image() const;
         operator vma::Allocation() const;
-        void copyFrom(void* buffer, uint32_t size);
+        void copyFrom(const void* buffer, uint32_t size);
         const vk::ImageView imageView();
+        vk::Extent3D extent() const;
+        // like RAIIvmaBuffer's; the view is created again for the moved image
+        vk::Image beginMove(vma::Allocation destination);
+        void finishMove();
         static void swap(RAIIvmaImage& lhs, RAIIvmaImage& rhs);
     };
 
@@ -59,16 +85,27 @@ namespace volchara {
         vma::Allocator vmaAlloc;
         vk::raii::Device* dev = nullptr;
         DeviceBufferCopyHandler* copyHandler = nullptr;
+        // behind a pointer so the buffers and images pointing at it survive the allocator being moved
+        std::unique_ptr<MemoryAccounting> accounting;
+        bool driverBudget = false;
         public:
-        RAIIAllocator(vk::raii::Instance& inst, vk::raii::PhysicalDevice& physDev, vk::raii::Device& dev, DeviceBufferCopyHandler& handler);
+        // memoryBudget: VK_EXT_memory_budget is enabled on the device, so VMA can ask the driver for heap budgets
+        RAIIAllocator(vk::raii::Instance& inst, vk::raii::PhysicalDevice& physDev, vk::raii::Device& dev, DeviceBufferCopyHandler& handler, bool memoryBudget = false);
         RAIIAllocator( nullptr_t ) {}
         ~RAIIAllocator();
         RAIIAllocator(RAIIAllocator&) = delete;
         RAIIAllocator& operator=(RAIIAllocator&) = delete;
         RAIIAllocator(RAIIAllocator&& other);
         const RAIIAllocator& operator=(RAIIAllocator&& other);
+        operator vma::Allocator() const;
+
+        RAIIvmaBuffer createBuffer(vk::BufferCreateInfo bufferInfo, vma::AllocationCreateInfo allocInfo, MemoryCategory category = MemoryCategory::Other);
+        RAIIvmaImage createImage(vk::ImageCreateInfo imageInfo, vma::AllocationCreateInfo allocInfo, vk::ImageAspectFlags aspectFlags, MemoryCategory category = MemoryCategory::Other);
 
-        RAIIvmaBuffer createBuffer(vk::BufferCreateInfo bufferInfo, vma::AllocationCreateInfo allocInfo);
-        RAIIvmaImage createImage(vk::ImageCreateInfo imageInfo, vma::AllocationCreateInfo allocInfo, vk::ImageAspectFlags aspectFlags);
+        // VMA refreshes the driver's budgets once per frame index
+        void setFrameIndex(uint32_t frameIndex);
+        MemoryReport report() const;
+        // vmaBuildStatsString's JSON; detailed lists every block and allocation
+        std::string statsJson(bool detailed = true) const;
     };
 }
\ No newline at end of file
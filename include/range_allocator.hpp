@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace volchara {
+    // first-fit suballocation of [0, capacity); released ranges merge with free neighbours
+    class RangeAllocator {
+        private:
+        struct Range {
+            uint32_t offset;
+            uint32_t size;
+        };
+        // sorted by offset
+        std::vector<Range> freeRanges;
+        uint32_t totalSize = 0;
+
+        public:
+        RangeAllocator() = default;
+        explicit RangeAllocator(uint32_t capacity);
+        std::optional<uint32_t> allocate(uint32_t size);
+        void release(uint32_t offset, uint32_t size);
+        uint32_t capacity() const;
+        // one past the last allocated element
+        uint32_t end() const;
+        // frees [capacity, newCapacity), merging it with a free range at the end
+        void grow(uint32_t newCapacity);
+    };
+}
@@ -1,11 +1,21 @@
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <chrono>
+#include <deque>
+#include <exception>
 #include <filesystem>
 #include <fstream>
+#include <initializer_list>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
 #include <optional>
-#include <set>
+#include <span>
+#include <string>
+#include <thread>
 #include <vector>
 
 #include <vulkan/vulkan.h>
@@ -16,8 +26,20 @@
 
 #include <glm/glm.hpp>
 
+#include <asset_loader.hpp>
+#include <asset_source.hpp>
+#include <defragmenter.hpp>
+#include <frame_arena.hpp>
+#include <frame_data.hpp>
+#include <growable_buffer.hpp>
 #include <objects.hpp>
 #include <raii_wrappers.hpp>
+#include <range_allocator.hpp>
+#include <scene_registry.hpp>
+#include <job_system.hpp>
+#include <memory_stats.hpp>
+#include <spsc_queue.hpp>
+#include <staging_ring.hpp>
 
 
 namespace volchara {
@@ -26,10 +48,33 @@ namespace volchara {
 
     const int MAX_FRAMES_IN_FLIGHT = 2;
     const int MAX_FRAMERATE = 60;
+    const int SIMULATION_TICK_RATE = 60;
+    // a simulation further behind than this drops ticks instead of catching up
+    const int MAX_SIMULATION_CATCHUP_TICKS = 5;
+    // below these, spreading work over more jobs costs more than it saves
+    const size_t MIN_OBJECTS_PER_RECORDING_JOB = 256;
+    const size_t MIN_OBJECTS_PER_CALLBACK_JOB = 64;
+    const float VERTICAL_FOV_DEGREES = 45.0f;
+    // the vertex streams and the index buffer are suballocated per uploaded mesh; they start this large and
+    // double whenever a mesh doesn't fit
+    const uint32_t INITIAL_GEOMETRY_VERTEX_CAPACITY = 1 << 16;
+    const uint32_t INITIAL_GEOMETRY_INDEX_CAPACITY = 1 << 18;
+    const uint32_t INITIAL_GEOMETRY_MESHLET_CAPACITY = 1 << 12;
+    // defragmentation starts once this share of the free device memory is outside its largest range, and there is
+    // enough of it to matter; it runs a bounded pass whenever a frame is ahead of MAX_FRAMERATE
+    const float DEFRAGMENTATION_THRESHOLD = 0.5f;
+    const uint64_t DEFRAGMENTATION_MIN_UNUSED_BYTES = 32 << 20;
+    const uint32_t DEFRAGMENTATION_MAX_MOVES_PER_PASS = 16;
+    const uint64_t DEFRAGMENTATION_MAX_BYTES_PER_PASS = 16 << 20;
+    // a pass waits for the frame in flight, so more of them would only delay the next frame
+    const uint32_t DEFRAGMENTATION_MAX_PASSES_PER_FRAME = 1;
 
     struct QueueFamilyIndices {
         std::optional<uint32_t> graphicsFamily;
         std::optional<uint32_t> presentFamily;
+        // a family of its own where the device has one, else the graphics family's second queue, or its only one
+        std::optional<uint32_t> transferFamily;
+        uint32_t transferQueueIndex = 0;
 
         bool isComplete() {
             return graphicsFamily.has_value() && presentFamily.has_value();
@@ -42,25 +87,50 @@ namespace volchara {
         std::vector<vk::PresentModeKHR> presentModes;
     };
 
+    // produced by GLFW callbacks on the main thread, consumed by the simulation thread
+    struct InputEvent {
+        enum class Type { Key, CursorMove };
+        Type type;
+        int key = 0;
+        int action = 0;
+        glm::vec2 cursorDelta{0.0f};
+    };
+
     class Renderer {
         friend class volchara::Object;
         friend class volchara::GLTFModel;
+        friend struct volchara::GeometryAllocation;
 
         uint32_t maxTextures = 64;
+        uint32_t maxObjectData = 65536;
+        // geometry uploads stream through this many slots of this size
+        vk::DeviceSize stagingSlotSize = 4 << 20;
+        uint32_t stagingSlotCount = 3;
 
         public:
             Renderer();
             void init();
             void run();
             const std::filesystem::path& getResourceDir();
+            // the resource directory's files by relative path, from the packed archive where the build made one
+            const AssetSource& getAssets();
+            JobSystem& jobs();
             void addObject(volchara::Object* obj);
             void delObject(volchara::Object* obj);
             void addLight(volchara::DirectionalLight* obj);
             Plane objPlaneFromWorldCoordinates(InitDataPlane vertices);
             GLTFModel objGLTFModelFromFile(std::filesystem::path modelPath);
+            // draws a placeholder cube until the model is imported in the background
+            GLTFModel objGLTFModelFromFileAsync(std::filesystem::path modelPath);
             Box objBoxFromWorldCoordinates(InitDataBox vertices);
             void setAmbientLight(InitDataLight data);
             DirectionalLight objDirectionalLightFromWorldCoordinates(InitDataLight data);
+            // the screen-space error in pixels an object's LOD may introduce
+            void setLodPixelError(float pixels);
+            // heap budgets and what each category of buffers and images holds
+            MemoryReport memoryReport();
+            // VMA's JSON statistics, down to every block and allocation
+            std::string memoryStatsJson();
 
             static std::vector<char *> readFile(const std::filesystem::path filename, bool asText = false) {
                 std::ifstream file(filename, std::ios::ate | (asText ? 0 : std::ios::binary));
@@ -109,12 +179,13 @@ namespace volchara {
             const bool enableValidationLayers = true;
             #endif
             static bool hasRequiredPhysicalDeviceFeatures(vk::PhysicalDeviceFeatures2 deviceFeatures) {
-                return deviceFeatures.features.samplerAnisotropy;
+                return deviceFeatures.features.samplerAnisotropy && deviceFeatures.features.multiDrawIndirect && deviceFeatures.features.drawIndirectFirstInstance;
             }
             static bool hasRequiredPhysicalDeviceDescriptorFeatures(vk::PhysicalDeviceDescriptorIndexingFeaturesEXT deviceFeatures) {
                 return deviceFeatures.descriptorBindingPartiallyBound && deviceFeatures.descriptorBindingSampledImageUpdateAfterBind && deviceFeatures.descriptorBindingVariableDescriptorCount && deviceFeatures.runtimeDescriptorArray;
             }
             GLFWwindow* window;
+            std::unique_ptr<AssetSource> assets;
         
             vk::raii::Context context;
             vk::raii::Instance instance = nullptr;
@@ -127,9 +198,29 @@ namespace volchara {
 
             DeviceBufferCopyHandler deviceBufferCopyHandler = nullptr;
             RAIIAllocator allocator = nullptr;
+            // geometry and texture uploads and geometry buffer growth, on the transfer queue; used under uploadMutex
+            StagingRing stagingRing = nullptr;
+            // the graphics and transfer families when they differ, so geometry buffers and textures are shared between them
+            std::vector<uint32_t> uploadQueueFamilies;
+            // moves geometry buffers and textures only
+            Defragmenter defragmenter = nullptr;
+            std::vector<uint32_t> movedTextures;
+            // since the last frame was drawn
+            uint32_t defragmentationPassesThisFrame = 0;
+            // VK_EXT_memory_budget is enabled, so heap budgets come from the driver
+            bool memoryBudgetSupported = false;
+            uint32_t allocatorFrameIndex = 0;
+            std::chrono::steady_clock::time_point lastMemoryBudgetCheck;
+            // per heap; warned about until usage drops back below MEMORY_BUDGET_WARNING_RESET
+            std::vector<bool> heapsNearBudget;
         
             vk::raii::Queue graphicsQueue = nullptr;
             vk::raii::Queue presentQueue = nullptr;
+            // the render thread submits frames while the simulation thread and the asset loader upload; taken after sceneMutex and uploadMutex
+            std::mutex queueMutex;
+            // held while stagingRing streams into the geometry buffers or a texture, and while the buffers grow or move;
+            // taken after sceneMutex
+            std::mutex uploadMutex;
         
             vk::raii::SwapchainKHR swapChain = nullptr;
             std::vector<vk::Image> swapChainImages;
@@ -145,13 +236,29 @@ namespace volchara {
             vk::raii::DescriptorSetLayout descriptorSetLayoutAmbientLightUBO = nullptr;
             vk::raii::DescriptorSetLayout descriptorSetLayoutDirectionalLightUBO = nullptr;
             vk::raii::DescriptorSetLayout descriptorSetLayoutLightSubpass = nullptr;
+            vk::raii::DescriptorSetLayout descriptorSetLayoutMeshletCull = nullptr;
             vk::raii::PipelineLayout colorPipelineLayout = nullptr;
             vk::raii::PipelineLayout lightPipelineLayout = nullptr;
             vk::raii::Pipeline colorGraphicsPipeline = nullptr;
             vk::raii::Pipeline lightGraphicsPipeline = nullptr;
+            vk::raii::PipelineLayout meshletCullPipelineLayout = nullptr;
+            vk::raii::Pipeline meshletCullPipeline = nullptr;
         
             vk::raii::CommandPool commandPool = nullptr;
-            std::vector<vk::raii::CommandBuffer> commandBuffers;
+            std::vector<std::vector<vk::raii::CommandBuffer>> commandBuffers;  // [frame][swapchain image]
+            JobSystem jobSystem;
+            std::vector<std::vector<vk::raii::CommandPool>> secondaryCommandPools;  // [frame][worker]
+            std::vector<std::vector<vk::raii::CommandBuffer>> secondaryCommandBuffers;  // [frame][worker]
+            // recorded buffers are reused until the scene structure changes
+            uint64_t sceneGeneration = 1;
+            // bumped with sceneGeneration and when only drawn ranges change, e.g. on a LOD switch;
+            // the draw commands and cull jobs follow it, the recorded buffers read them indirectly
+            uint64_t drawGeneration = 1;
+            std::vector<std::vector<uint64_t>> commandBufferGenerations;
+            std::vector<uint64_t> secondaryCommandBufferGenerations;
+            std::vector<size_t> secondaryCommandBufferCounts;
+            // CPU temporaries of a frame in flight, reset when its fence is waited for
+            std::array<FrameArena, MAX_FRAMES_IN_FLIGHT> frameArenas;
         
             std::vector<vk::raii::Semaphore> imageAvailableSemaphores;
             std::vector<vk::raii::Semaphore> renderFinishedSemaphores;
@@ -159,10 +266,58 @@ namespace volchara {
             uint32_t currentFrame = 0;
             std::chrono::time_point<std::chrono::steady_clock> lastFrameTime = std::chrono::steady_clock::now();
         
-            RAIIvmaBuffer stagingBuffer = nullptr;
-            RAIIvmaBuffer vertexBuffer = nullptr;
-            RAIIvmaBuffer indexBuffer = nullptr;
-            RAIIvmaBuffer ssboBuffer = nullptr;
+            // one buffer per stream in VERTEX_STREAMS
+            GrowableBuffer positionBuffer = nullptr;
+            GrowableBuffer attributeBuffer = nullptr;
+            GrowableBuffer indexBuffer = nullptr;
+            // in vertices and indices
+            RangeAllocator vertexRanges;
+            RangeAllocator indexRanges;
+            // meshlets with absolute first indices, suballocated like the geometry
+            GrowableBuffer meshletBuffer = nullptr;
+            RangeAllocator meshletRanges;
+            // bumped when a geometry buffer is replaced by a larger one
+            uint64_t geometryBufferGeneration = 0;
+            // replaced buffers live until the frames that may have been recorded with them have retired
+            struct RetiredBuffer {
+                RAIIvmaBuffer buffer = nullptr;
+                uint64_t frame = 0;
+            };
+            std::deque<RetiredBuffer> retiredBuffers;
+            // freed geometry ranges, held back the same way
+            struct RetiredRanges {
+                uint32_t firstVertex = 0;
+                uint32_t vertexCount = 0;
+                uint32_t firstIndex = 0;
+                uint32_t indexCount = 0;
+                uint32_t firstMeshlet = 0;
+                uint32_t meshletCount = 0;
+                uint64_t frame = 0;
+            };
+            std::deque<RetiredRanges> retiredRanges;
+            uint64_t submittedFrames = 0;
+            // drawn by models still loading; released with the geometry buffers. set once by initVulkan, then only read
+            std::shared_ptr<GeometryAllocation> placeholder;
+            // per frame in flight: a compute pass culls the jobs' meshlets and appends the visible ones' indices
+            // to their draw's range of culledIndexBuffers, counting them in meshletDrawBuffers for an indirect draw.
+            // jobs, draw templates and the dispatch are rewritten when drawGeneration changes
+            std::vector<RAIIvmaBuffer> meshletCullJobBuffers;
+            std::vector<RAIIvmaBuffer> meshletDrawTemplateBuffers;
+            std::vector<RAIIvmaBuffer> meshletDrawBuffers;
+            std::vector<RAIIvmaBuffer> culledIndexBuffers;
+            std::vector<RAIIvmaBuffer> meshletCullDispatchBuffers;
+            std::vector<uint64_t> meshletCullGenerations;
+            // the geometryBufferGeneration each frame's culling descriptors point at
+            std::vector<uint64_t> meshletCullDescriptorGenerations;
+            std::vector<uint32_t> meshletDrawCounts;
+            // the indirect draw of every drawn instance, or NO_MESHLET_DRAW
+            std::vector<std::vector<uint32_t>> meshletDrawSlots;
+            std::vector<RAIIvmaBuffer> objectDataBuffers;
+            std::vector<uint64_t> objectDataGenerations;
+            // per frame in flight: an indexed draw for every drawn instance, so a secondary buffer draws its range with one call
+            std::vector<RAIIvmaBuffer> drawCommandBuffers;
+            std::vector<uint64_t> drawCommandGenerations;
+            std::vector<RAIIvmaBuffer> modelMatrixBuffers;
             std::vector<RAIIvmaBuffer> uniformBuffers;
             RAIIvmaBuffer ambientLightBuffer = nullptr;
             RAIIvmaBuffer directionalLightBuffer = nullptr;
@@ -177,42 +332,67 @@ namespace volchara {
             std::vector<vk::raii::DescriptorSet> descriptorSetsAmbientLightUBO;
             std::vector<vk::raii::DescriptorSet> descriptorSetsDirectionalLightUBO;
             std::vector<vk::raii::DescriptorSet> descriptorSetsLightSubpass;
+            std::vector<vk::raii::DescriptorSet> descriptorSetsMeshletCull;
 
             vk::raii::Sampler textureSampler = nullptr;
             std::vector<RAIIvmaImage> textures;
         
-            std::set<int> pressedKeys;
-            glm::vec2 cursorOffset;
-            glm::vec2 prevOffset;
+            // owned by the simulation thread once run() starts
+            InputState input;
+            // owned by the main thread
+            glm::vec2 prevOffset{0.0f};
+            bool hasPrevOffset = false;
+            SpscQueue<InputEvent, 1024> inputEvents;
             float cameraSpeed = 1.0f;
             float mouseSensitivity = 1.0f;
         
+            // referenced by every Object, so both are declared before the camera
+            TransformStore transforms;
+            SceneRegistry scene;
             volchara::Camera camera;
             volchara::AmbientLight ambientLight;
             std::vector<volchara::Object*> objects {};
             std::vector<volchara::DirectionalLight*> lights {};
         
+            // the simulation thread runs frame callbacks and camera movement at a fixed rate,
+            // the render thread interpolates between the last two snapshots it published
+            std::thread simulationThread;
+            std::atomic<bool> simulationRunning = false;
+            std::exception_ptr simulationError = nullptr;
+            // held by the simulation thread while it changes the scene's structure and publishes the matching snapshot,
+            // and by the render thread while it reads the scene and records from commandPool
+            std::mutex sceneMutex;
+            // its thread is joined before the rest of the renderer is torn down
+            AssetLoader assetLoader{!jobSystem.isSingleThreaded()};
+            uint64_t simulationTick = 0;
+            SimulationSnapshot nextSnapshot;
+            std::mutex snapshotMutex;
+            SimulationSnapshot currentSnapshot;
+            SimulationSnapshot previousSnapshot;
+            // interpolated instance transforms, owned by the render thread
+            RenderTransforms renderTransforms;
+            float lodPixelError = 1.0f;
+
             bool framebufferResized = false;
-            bool shouldExit = false;
+            std::atomic<bool> shouldExit = false;
         
             static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods)
             {
                 Renderer* app = reinterpret_cast<Renderer*>(glfwGetWindowUserPointer(window));
-                if (action == GLFW_PRESS) {
-                    app->pressedKeys.insert(key);
-                }
-                else if (action == GLFW_RELEASE) {
-                    app->pressedKeys.erase(key);
+                if (action == GLFW_PRESS || action == GLFW_RELEASE) {
+                    app->inputEvents.push({.type = InputEvent::Type::Key, .key = key, .action = action});
                 }
             }
 
             static void cursorPositionCallback(GLFWwindow* window, double xpos, double ypos) 
             {
                 Renderer* app = reinterpret_cast<Renderer*>(glfwGetWindowUserPointer(window));
-                app->cursorOffset.x += xpos - app->prevOffset.x;
-                app->cursorOffset.y += ypos - app->prevOffset.y;
-                app->prevOffset.x = xpos;
-                app->prevOffset.y = ypos;
+                glm::vec2 position(xpos, ypos);
+                if (app->hasPrevOffset) {
+                    app->inputEvents.push({.type = InputEvent::Type::CursorMove, .cursorDelta = position - app->prevOffset});
+                }
+                app->prevOffset = position;
+                app->hasPrevOffset = true;
             }
 
             static void framebufferResizeCallback(GLFWwindow* window, int width, int height) {
@@ -220,11 +400,48 @@ namespace volchara {
                 app->framebufferResized = true;
             }
 
-            void putObjectsToBuffer();
+            void markSceneDirty();
+            void markDrawsDirty();
+            // an object's streams or a mesh cache's, both already in the GPU layout; by the thread that owns the scene:
+            // the constructing one before run(), then the simulation thread under sceneMutex, e.g. in a serial frame callback
+            std::shared_ptr<GeometryAllocation> uploadGeometry(std::span<const PositionStream> positions, std::span<const AttributeStream> attributes,
+                std::span<const uint32_t> indices, std::span<const Meshlet> meshlets);
+            // the same from any other thread, which only takes sceneMutex when the geometry buffers have to grow
+            std::shared_ptr<GeometryAllocation> uploadLoadedGeometry(std::span<const PositionStream> positions, std::span<const AttributeStream> attributes,
+                std::span<const uint32_t> indices, std::span<const Meshlet> meshlets);
+            std::shared_ptr<GeometryAllocation> newGeometry(std::span<const PositionStream> positions, std::span<const AttributeStream> attributes,
+                std::span<const uint32_t> indices, std::span<const Meshlet> meshlets);
+            // first fit for all three ranges or none, under queueMutex
+            bool allocateGeometryRanges(GeometryAllocation& geometry);
+            // until the geometry fits at the end of every range; under sceneMutex and uploadMutex, as the buffers are replaced
+            void growGeometryBuffers(const GeometryAllocation& geometry);
+            // empty past maxCapacity
+            bool growGeometryBuffer(RangeAllocator& ranges, std::initializer_list<GrowableBuffer*> buffers, uint32_t count, uint64_t maxCapacity);
+            // under uploadMutex, to ranges already allocated
+            void streamGeometry(const GeometryAllocation& geometry, std::span<const PositionStream> positions, std::span<const AttributeStream> attributes,
+                std::span<const uint32_t> indices, std::span<const Meshlet> meshlets);
+            // retires the ranges; releaseRetiredBuffers frees them once no frame in flight can draw from them
+            void releaseGeometry(const GeometryAllocation& geometry);
+            void releaseRetiredBuffers();
+            // a unit cube with the default texture, uploaded before any thread but the constructing one runs
+            void createPlaceholderGeometry();
+            // from any thread
+            std::shared_ptr<GeometryAllocation> placeholderGeometry() const;
+            void createInstances(Object* obj);
+            void removeInstances(Object* obj);
+            // swaps in at most one finished load per tick, so a burst of them doesn't stall the simulation
+            void completeAssetLoads();
+            void updateMeshes(Object* obj);
             void putLightToBuffer();
+            void createAssetSource();
             void initWindow();
             void initVulkan();
             void mainLoop();
+            void startSimulation();
+            void stopSimulation();
+            void simulationLoop();
+            void processInputEvents();
+            void publishSnapshot(std::chrono::steady_clock::time_point time);
             void cleanup();
             bool checkValidationLayerSupport();
             std::vector<const char*> getRequiredExtensions();
@@ -239,6 +456,9 @@ namespace volchara {
             void createLogicalDevice();
             void createBufferCopyHandler();
             void createMemoryAllocator();
+            void checkMemoryBudget();
+            // one defragmentation pass; false when there is none to run
+            bool defragmentStep();
             void createTextureSampler();
             vk::SurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<vk::SurfaceFormatKHR>& availableFormats);
             vk::PresentModeKHR chooseSwapPresentMode(const std::vector<vk::PresentModeKHR>& availablePresentModes);
@@ -250,15 +470,18 @@ namespace volchara {
             vk::Format findDepthFormat();
             void createRenderPass();
             void createDescriptorSetLayout();
-            vk::raii::ShaderModule createShaderModule(const std::vector<char *>& code);
+            vk::raii::ShaderModule createShaderModule(std::span<const std::byte> code);
             void createGraphicsPipeline();
+            void createMeshletCullPipeline();
             void createCommandPool();
-            void createStagingBuffer();
             void createVertexBuffer();
             void createIndexBuffer();
             void createUniformBuffers();
-            void createSSBOBuffer();
-            RAIIvmaImage createImage(uint32_t width, uint32_t height, vk::Format format, vk::ImageTiling tiling, vk::ImageUsageFlags usage, vk::MemoryPropertyFlags properties, vk::ImageAspectFlags aspectFlags = vk::ImageAspectFlagBits::eColor);
+            void createObjectDataBuffers();
+            void createMeshletBuffers();
+            // shared between queueFamilies if there are several
+            RAIIvmaImage createImage(uint32_t width, uint32_t height, vk::Format format, vk::ImageTiling tiling, vk::ImageUsageFlags usage, vk::MemoryPropertyFlags properties, MemoryCategory category, vk::ImageAspectFlags aspectFlags = vk::ImageAspectFlagBits::eColor,
+                std::span<const uint32_t> queueFamilies = {});
             vk::raii::CommandBuffer beginSingleTimeCommands();
             void endSingleTimeCommands(vk::raii::CommandBuffer& buffer);
             void transitionImageLayout(const vk::Image& image, vk::Format format, vk::ImageLayout oldLayout, vk::ImageLayout newLayout);
@@ -266,16 +489,38 @@ namespace volchara {
             void createNormalResources();
             void createIntermediateColorResources();
             void createFramebuffers();
-            uint32_t createTextureImage(const std::filesystem::path path);
+            // an encoded image, e.g. one embedded in a glTF file, decoded straight from memory
+            uint32_t createTextureImage(std::span<const std::byte> encoded);
+            // tightly packed RGBA pixels, uploaded through stagingRing; from any thread
+            uint32_t createTextureImage(const void* pixels, uint32_t width, uint32_t height);
+            // creates the texture and writes its descriptor; from any thread once the descriptor sets exist
+            uint32_t uploadTexture(const DecodedImage& image);
+            // uploads a model's geometry and images on the calling thread, usually the asset loader's
+            LoadedModel uploadModel(ImportedModel&& model);
             void createDescriptorPool();
             void createDescriptorSets();
+            void writeMeshletCullDescriptors(uint32_t bufferIndex);
             uint32_t loadTextureToDescriptors(uint32_t textureIndex);
             void createCommandBuffers();
+            void createSecondaryCommandBuffers();
             void createSyncObjects();
             void updateCameraPosition(float passedSeconds);
             void recreateSwapChain();
+            void recordSceneCommandBuffer(vk::raii::CommandBuffer& buffer, uint32_t bufferIndex, size_t firstInstance, size_t lastInstance);
+            void recordSceneCommandBuffers(uint32_t bufferIndex);
+            // split into calls of at most maxDrawIndirectCount draws
+            void drawIndexedIndirect(vk::raii::CommandBuffer& buffer, vk::Buffer commands, uint32_t firstDraw, uint32_t drawCount);
+            void recordMeshletCulling(vk::raii::CommandBuffer& commandBuffer, uint32_t bufferIndex);
             void recordCommandBuffer(uint32_t imageIndex, uint32_t bufferIndex);
-            void updateUniformBuffer(uint32_t imageIndex);
+            void updateUniformBuffer(uint32_t imageIndex, const TransformState& cameraState);
+            void updateObjectData(uint32_t bufferIndex, const SimulationSnapshot& from, const SimulationSnapshot& to, float alpha);
+            void selectLods(const TransformState& cameraState);
+            void updateMeshletCulling(uint32_t bufferIndex);
+            void updateDrawCommands(uint32_t bufferIndex);
+            // the parallel callbacks of every added object, spread over the job system
+            void runParallelFrameCallbacks(float passedSeconds);
+            // the rest, under sceneMutex
+            void runSerialFrameCallbacks(float passedSeconds);
             void drawFrame();
         
             static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(vk::DebugUtilsMessageSeverityFlagBitsEXT messageSeverity, vk::DebugUtilsMessageTypeFlagsEXT messageType, const vk::DebugUtilsMessengerCallbackDataEXT* pCallbackData, void* pUserData) {
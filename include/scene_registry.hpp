@@ -0,0 +1,169 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <input_state.hpp>
+
+namespace volchara {
+    class Object;
+
+    using FrameCallback = std::function<void(Object*, float, const InputState&)>;
+
+    // how the renderer runs a frame callback every simulation tick
+    enum class CallbackExecution {
+        // on the simulation thread, one object after another, while it holds the scene; may touch other objects,
+        // lights and shared state, and add or remove objects
+        Serial,
+        // on the job system before the serial callbacks, alongside other objects' parallel callbacks;
+        // may only change its own object and must not add or remove objects
+        Parallel,
+    };
+
+    enum Component : uint32_t {
+        COMPONENT_TRANSFORM = 1 << 0,
+        COMPONENT_MESH = 1 << 1,
+        COMPONENT_MATERIAL = 1 << 2,
+        COMPONENT_CALLBACKS = 1 << 3,
+        // a tag without data: the entity belongs to an object added to the renderer
+        COMPONENT_ACTIVE = 1 << 4,
+        // the mesh has simplified versions the renderer picks from by screen size
+        COMPONENT_LOD = 1 << 5,
+    };
+    // every entity with all of these is drawn as one instance
+    const uint32_t DRAWABLE_COMPONENTS = COMPONENT_TRANSFORM | COMPONENT_MESH | COMPONENT_MATERIAL;
+
+    // a range of the renderer's shared index buffer, with indices relative to vertexOffset
+    struct MeshRef {
+        uint32_t firstIndex = 0;
+        uint32_t indexCount = 0;
+        int32_t vertexOffset = 0;
+        // meshlets in the renderer's meshlet buffer covering the range; drawn through cluster culling when not 0
+        uint32_t firstMeshlet = 0;
+        uint32_t meshletCount = 0;
+    };
+
+    struct Material {
+        uint32_t textureIndex = 0;
+        glm::vec3 color{0.0f, 0.0f, 0.0f};
+    };
+
+    const uint32_t MAX_LOD_LEVELS = 6;
+
+    // an index range drawn with the same vertices as the full mesh
+    struct LodLevel {
+        uint32_t firstIndex = 0;
+        uint32_t indexCount = 0;
+        // the largest deviation from the full mesh, relative to the bounding radius
+        float error = 0.0f;
+        // only the full mesh is split into meshlets
+        uint32_t firstMeshlet = 0;
+        uint32_t meshletCount = 0;
+    };
+
+    // levels from the full mesh down; the renderer copies the current one into the entity's MeshRef
+    struct LodChain {
+        std::array<LodLevel, MAX_LOD_LEVELS> levels;
+        uint32_t levelCount = 0;
+        uint32_t current = 0;
+        // the bounding sphere in mesh space
+        glm::vec3 center{0.0f, 0.0f, 0.0f};
+        float radius = 0.0f;
+    };
+
+    struct FrameCallbacks {
+        Object* owner = nullptr;
+        std::vector<FrameCallback> callbacks;
+        std::vector<FrameCallback> parallelCallbacks;
+    };
+
+    struct Entity {
+        uint32_t index = std::numeric_limits<uint32_t>::max();
+        uint32_t generation = 0;
+
+        bool operator==(const Entity& other) const = default;
+    };
+
+    // all entities with the same component set, every component in its own packed column;
+    // columns of components outside the set stay empty
+    struct Archetype {
+        uint32_t components = 0;
+        std::vector<Entity> entities;
+        std::vector<uint32_t> transforms;  // TransformStore slots
+        std::vector<MeshRef> meshes;
+        std::vector<Material> materials;
+        std::vector<FrameCallbacks> callbacks;
+        std::vector<LodChain> lods;
+
+        size_t size() const { return entities.size(); }
+    };
+
+    // archetype-based entity storage; removing an entity moves the last row of its archetype into its place,
+    // so rows are only stable until the next structural change
+    class SceneRegistry {
+        private:
+        struct Location {
+            uint32_t archetype = 0;
+            uint32_t row = 0;
+            uint32_t generation = 0;
+            bool alive = false;
+        };
+        // only ever appended, so archetype order is stable
+        std::vector<Archetype> archetypes;
+        std::vector<Location> locations;
+        std::vector<uint32_t> freeEntities;
+
+        uint32_t findArchetype(uint32_t components);
+        const Location& locate(Entity entity) const;
+        void removeRow(uint32_t archetype, uint32_t row);
+
+        public:
+        Entity create(uint32_t components);
+        void destroy(Entity entity);
+        bool alive(Entity entity) const;
+
+        uint32_t components(Entity entity) const;
+        // moves the entity to the archetype of the new set, keeping the components both sets share
+        void setComponents(Entity entity, uint32_t components);
+        void add(Entity entity, uint32_t components);
+        void remove(Entity entity, uint32_t components);
+
+        uint32_t& transform(Entity entity);
+        MeshRef& mesh(Entity entity);
+        Material& material(Entity entity);
+        FrameCallbacks& callbacks(Entity entity);
+        LodChain& lod(Entity entity);
+
+        // the number of entities holding all of `components`
+        size_t count(uint32_t components) const;
+
+        // visits every archetype holding all of `components` with the number of its first row,
+        // counting rows across the visited archetypes in order
+        template<class Fn>
+        void forEach(uint32_t components, Fn&& fn) {
+            size_t first = 0;
+            for (Archetype& archetype : archetypes) {
+                if ((archetype.components & components) != components || archetype.size() == 0) continue;
+                fn(archetype, first);
+                first += archetype.size();
+            }
+        }
+
+        // like forEach, limited to rows numbered [firstRow, lastRow)
+        template<class Fn>
+        void forEachInRange(uint32_t components, size_t firstRow, size_t lastRow, Fn&& fn) {
+            forEach(components, [&](Archetype& archetype, size_t first) {
+                size_t begin = std::max(firstRow, first);
+                size_t end = std::min(lastRow, first + archetype.size());
+                if (begin < end) fn(archetype, first, begin - first, end - first);
+            });
+        }
+    };
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <vector>
+
+#include <vulkan/vulkan_raii.hpp>
+
+#include <raii_wrappers.hpp>
+
+namespace volchara {
+    // a few fixed slots of host visible memory that uploads to device local buffers and images stream through, one slot
+    // at a time; an upload of any size needs no staging memory of its own, and a slot is filled while the previous ones copy.
+    // not thread safe, though it may submit to a queue other threads submit to as well
+    class StagingRing {
+        struct Slot {
+            RAIIvmaBuffer buffer = nullptr;
+            std::byte* mapped = nullptr;
+            vk::raii::CommandBuffer commands = nullptr;
+            vk::raii::Fence fence = nullptr;
+            bool pending = false;
+        };
+
+        vk::raii::Device* device = nullptr;
+        vk::raii::Queue queue = nullptr;
+        // held around each submit when the queue is shared
+        std::mutex* queueMutex = nullptr;
+        vk::raii::CommandPool commandPool = nullptr;
+        std::vector<Slot> slots;
+        vk::DeviceSize slotSize = 0;
+        size_t nextSlot = 0;
+
+        Slot& acquire();
+        void submit(Slot& slot);
+
+        public:
+        // writes count elements to out, starting at element first of the upload
+        using Fill = std::function<void(std::byte* out, size_t first, size_t count)>;
+
+        StagingRing(vk::raii::Device& dev, RAIIAllocator& allocator, uint32_t queueFamilyIndex, vk::DeviceSize slotSize, uint32_t slotCount,
+            uint32_t queueIndex = 0, std::mutex* queueMutex = nullptr);
+        StagingRing(nullptr_t) {}
+        ~StagingRing();
+        StagingRing(StagingRing&) = delete;
+        StagingRing& operator=(StagingRing&) = delete;
+        StagingRing(StagingRing&& other) = default;
+        StagingRing& operator=(StagingRing&& other) = default;
+
+        // elements never straddle two slots, so they are converted in place by fill
+        void upload(vk::Buffer to, vk::DeviceSize dstOffset, size_t elementSize, size_t elementCount, const Fill& fill);
+        template<typename T>
+        void upload(vk::Buffer to, vk::DeviceSize dstOffset, std::span<const T> elements) {
+            upload(to, dstOffset, sizeof(T), elements.size(), [&](std::byte* out, size_t first, size_t count) {
+                std::memcpy(out, elements.data() + first, count * sizeof(T));
+            });
+        }
+        // tightly packed texels into an image of one level and layer, whole rows per slot; the image is left ready
+        // to be sampled, by any queue family it is shared with, once finish() returns
+        void uploadImage(vk::Image to, uint32_t width, uint32_t height, size_t texelSize, const void* texels);
+        // a copy between device buffers, e.g. into a buffer that replaces a full one; waited for like an upload
+        void copy(vk::Buffer from, vk::Buffer to, vk::DeviceSize size);
+        // waits until every upload so far has reached its buffer
+        void finish();
+    };
+}
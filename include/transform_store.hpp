@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtx/quaternion.hpp>
+
+#include <job_system.hpp>
+
+namespace volchara {
+    // a transform captured by the simulation, interpolated by the renderer
+    struct TransformState {
+        glm::vec3 translation{0,0,0};
+        glm::vec3 scaling{1,1,1};
+        glm::quat rotationQuat{1,0,0,0};
+
+        static TransformState interpolate(const TransformState& from, const TransformState& to, float alpha);
+        glm::mat4 modelMatrix() const;
+    };
+
+    // structure-of-arrays transforms, each optionally relative to a parent slot;
+    // local matrices are rebuilt only for dirty slots, four at a time, world matrices only below them
+    class TransformStore {
+        public:
+        static constexpr size_t BATCH_SIZE = 4;
+        static constexpr uint32_t NO_PARENT = std::numeric_limits<uint32_t>::max();
+
+        private:
+        // padded to a multiple of BATCH_SIZE so the kernel never reads past the end
+        std::vector<float> translationX, translationY, translationZ;
+        std::vector<float> rotationX, rotationY, rotationZ, rotationW;
+        std::vector<float> scaleX, scaleY, scaleZ;
+        // a byte per slot, so jobs touching different slots don't race on shared words
+        std::vector<uint8_t> dirty;
+        std::vector<uint8_t> worldChanged;
+        std::vector<glm::mat4> localMatrices;
+        std::vector<glm::mat4> worldMatrices;
+
+        std::vector<uint32_t> parents;
+        std::vector<uint32_t> childCounts;
+        // slots sorted by depth, so a parent's world matrix is final before its children read it
+        std::vector<uint32_t> order;
+        std::vector<size_t> levelOffsets;
+        bool orderValid = false;
+        uint64_t parentsGeneration = 1;
+
+        std::vector<uint32_t> freeSlots;
+        size_t slotCount = 0;
+
+        void grow(size_t count);
+        void rebuildOrder();
+        void updateLocalMatrices(size_t firstSlot, size_t lastSlot);
+        void updateWorldMatrices(size_t firstOrder, size_t lastOrder, bool all);
+
+        public:
+        uint32_t allocate(const TransformState& state = {});
+        void release(uint32_t slot);
+        // for stores indexed directly by the caller instead of through allocate()
+        void resize(size_t count);
+        size_t size() const;
+
+        TransformState get(uint32_t slot) const;
+        void set(uint32_t slot, const TransformState& state);
+        glm::vec3 translation(uint32_t slot) const;
+        void setTranslation(uint32_t slot, glm::vec3 translation);
+        glm::vec3 scaling(uint32_t slot) const;
+        void setScaling(uint32_t slot, glm::vec3 scaling);
+        glm::quat rotation(uint32_t slot) const;
+        void setRotation(uint32_t slot, glm::quat rotation);
+
+        uint32_t parent(uint32_t slot) const;
+        void setParent(uint32_t slot, uint32_t parentSlot);
+        // changes whenever any parent link does
+        uint64_t hierarchyGeneration() const;
+        const std::vector<uint32_t>& parentSlots() const;
+        void setParentSlots(const std::vector<uint32_t>& parentSlots);
+
+        bool isDirty(uint32_t slot) const;
+        void markDirty(uint32_t slot);
+        void clearDirty(uint32_t slot);
+
+        // rebuilds dirty local matrices, then world matrices level by level
+        void updateMatrices(JobSystem& jobs, size_t grainSize);
+        const glm::mat4& worldMatrix(uint32_t slot) const;
+    };
+}
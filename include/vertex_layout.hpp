@@ -0,0 +1,62 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <vulkan/vulkan_raii.hpp>
+#include <glm/glm.hpp>
+
+namespace volchara {
+    // the CPU-side vertex; uploads split it into the streams below
+    struct Vertex {
+        glm::vec3 pos{0, 0, 0};
+        glm::vec3 normal{0, 0, 0};
+        glm::vec2 texCoord{0, 0};
+
+        bool operator==(const Vertex& other) const;
+        static std::vector<vk::VertexInputBindingDescription> getBindingDescriptions();
+        static std::vector<vk::VertexInputAttributeDescription> getAttributeDescriptions();
+    };
+
+    // positions get a stream of their own, so depth-only passes fetch 12 bytes per vertex
+    struct PositionStream {
+        float pos[3];
+    };
+
+    // an octahedral normal as two snorm16 and texture coordinates as two half floats
+    struct AttributeStream {
+        uint32_t normal;
+        uint32_t texCoord;
+    };
+
+    static_assert(sizeof(PositionStream) == 12 && sizeof(AttributeStream) == 8, "vertex streams must be tightly packed");
+
+    struct VertexStreamDescriptor {
+        uint32_t binding;
+        uint32_t stride;
+    };
+
+    struct VertexAttributeDescriptor {
+        uint32_t location;
+        uint32_t binding;
+        vk::Format format;
+        uint32_t offset;
+    };
+
+    // the pipeline's vertex input state is generated from these; base.vert has to use the same locations
+    inline constexpr std::array VERTEX_STREAMS{
+        VertexStreamDescriptor{.binding = 0, .stride = sizeof(PositionStream)},
+        VertexStreamDescriptor{.binding = 1, .stride = sizeof(AttributeStream)},
+    };
+
+    inline constexpr std::array VERTEX_ATTRIBUTES{
+        VertexAttributeDescriptor{.location = 0, .binding = 0, .format = vk::Format::eR32G32B32Sfloat, .offset = offsetof(PositionStream, pos)},
+        VertexAttributeDescriptor{.location = 1, .binding = 1, .format = vk::Format::eR16G16Snorm, .offset = offsetof(AttributeStream, normal)},
+        VertexAttributeDescriptor{.location = 2, .binding = 1, .format = vk::Format::eR16G16Sfloat, .offset = offsetof(AttributeStream, texCoord)},
+    };
+
+    PositionStream packPosition(glm::vec3 pos);
+    AttributeStream packAttributes(glm::vec3 normal, glm::vec2 texCoord);
+}
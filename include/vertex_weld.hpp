@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <job_system.hpp>
+#include <vertex_layout.hpp>
+
+namespace volchara {
+    // from this many vertices on, welding sorts keys on the job system instead of filling one hash table
+    const size_t PARALLEL_WELD_THRESHOLD = 1 << 20;
+
+    struct WeldedMesh {
+        std::vector<Vertex> vertices;
+        std::vector<uint32_t> indices;
+    };
+
+    struct WeldedStreams {
+        std::vector<PositionStream> positions;
+        std::vector<AttributeStream> attributes;
+        std::vector<uint32_t> indices;
+    };
+
+    // merges vertices with equal attributes, keeping the first of each in order of appearance;
+    // a positive epsilon rounds every attribute to a multiple of it first, so nearby vertices merge too
+    WeldedMesh weldVertices(std::span<const Vertex> vertices, float epsilon = 0.0f, JobSystem* jobs = nullptr);
+    // merges vertices whose packed position and attributes are equal bit for bit, as their GPU fetches would be
+    WeldedStreams weldVertices(std::span<const PositionStream> positions, std::span<const AttributeStream> attributes, JobSystem* jobs = nullptr);
+}
@@ -10,21 +10,21 @@ std::uniform_real_distribution<> dis(0.0f, 1.0f);
 std::uniform_real_distribution<> bdis(0.05f, 0.25f);
 
 
-void mvmnt(volchara::Object* obj, float passedSeconds, std::set<int> pressedKeys) {
-    if (pressedKeys.contains(GLFW_KEY_UP)) obj->transform.position.up(passedSeconds, true);
-    if (pressedKeys.contains(GLFW_KEY_DOWN)) obj->transform.position.down(passedSeconds, true);
-    if (pressedKeys.contains(GLFW_KEY_LEFT)) obj->transform.position.left(passedSeconds, true);
-    if (pressedKeys.contains(GLFW_KEY_RIGHT)) obj->transform.position.right(passedSeconds, true);
-    if (pressedKeys.contains(GLFW_KEY_PERIOD)) obj->transform.position.forward(passedSeconds, true);
-    if (pressedKeys.contains(GLFW_KEY_COMMA)) obj->transform.position.backward(passedSeconds, true);
-    if (pressedKeys.contains(GLFW_KEY_I)) obj->transform.position.up(passedSeconds, false);
-    if (pressedKeys.contains(GLFW_KEY_K)) obj->transform.position.down(passedSeconds, false);
-    if (pressedKeys.contains(GLFW_KEY_J)) obj->transform.position.left(passedSeconds, false);
-    if (pressedKeys.contains(GLFW_KEY_L)) obj->transform.position.right(passedSeconds, false);
-    if (pressedKeys.contains(GLFW_KEY_M)) obj->transform.position.forward(passedSeconds, false);
-    if (pressedKeys.contains(GLFW_KEY_N)) obj->transform.position.backward(passedSeconds, false);
-    if (pressedKeys.contains(GLFW_KEY_1)) obj->transform.rotation.ccw(passedSeconds);
-    if (pressedKeys.contains(GLFW_KEY_2)) obj->transform.rotation.cw(passedSeconds);
+void mvmnt(volchara::Object* obj, float passedSeconds, const volchara::InputState& input) {
+    if (input.isDown(GLFW_KEY_UP)) obj->transform.position.up(passedSeconds, true);
+    if (input.isDown(GLFW_KEY_DOWN)) obj->transform.position.down(passedSeconds, true);
+    if (input.isDown(GLFW_KEY_LEFT)) obj->transform.position.left(passedSeconds, true);
+    if (input.isDown(GLFW_KEY_RIGHT)) obj->transform.position.right(passedSeconds, true);
+    if (input.isDown(GLFW_KEY_PERIOD)) obj->transform.position.forward(passedSeconds, true);
+    if (input.isDown(GLFW_KEY_COMMA)) obj->transform.position.backward(passedSeconds, true);
+    if (input.isDown(GLFW_KEY_I)) obj->transform.position.up(passedSeconds, false);
+    if (input.isDown(GLFW_KEY_K)) obj->transform.position.down(passedSeconds, false);
+    if (input.isDown(GLFW_KEY_J)) obj->transform.position.left(passedSeconds, false);
+    if (input.isDown(GLFW_KEY_L)) obj->transform.position.right(passedSeconds, false);
+    if (input.isDown(GLFW_KEY_M)) obj->transform.position.forward(passedSeconds, false);
+    if (input.isDown(GLFW_KEY_N)) obj->transform.position.backward(passedSeconds, false);
+    if (input.isDown(GLFW_KEY_1)) obj->transform.rotation.ccw(passedSeconds);
+    if (input.isDown(GLFW_KEY_2)) obj->transform.rotation.cw(passedSeconds);
 }
 
 int main() {
@@ -35,12 +35,12 @@ int main() {
     // volchara::Plane obj3 = renderer.objPlaneFromWorldCoordinates({{0.3f, 0.8f, -0.3f}, {0.5f, 0.8f, -0.3f}, {0.5f, -0.1f, -0.3f}});
     // obj2.loadTexture(renderer.getResourceDir() / "textures/nouwu.jpg");
     // obj3.loadTexture(renderer.getResourceDir() / "textures/ovca.png");
-    // obj3.frameCallbacks.push_back(mvmnt);
+    // obj3.addFrameCallback(mvmnt);
     // renderer.addObject(&obj1);
     // renderer.addObject(&obj2);
     // renderer.addObject(&obj3);
     // volchara::GLTFModel obj1 = renderer.objGLTFModelFromFile(renderer.getResourceDir() / "models/fisch/fisch.gltf");
-    obj1.frameCallbacks.push_back(mvmnt);
+    obj1.addFrameCallback(mvmnt);
     renderer.addObject(&obj1);
     renderer.setAmbientLight({{}, {1.0f, 1.0f, 1.0f}, 0.01f});
     float r_offset = -0.05f;
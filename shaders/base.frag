@@ -1,10 +1,11 @@
 #version 450
 #extension GL_EXT_nonuniform_qualifier : enable
 
-layout(location = 0) in vec3 fragColor;
+layout(location = 0) flat in vec3 fragColor;
 layout(location = 1) in vec2 fragTexCoord;
 layout(location = 2) in vec3 fragWorldPos;
 layout(location = 3) in vec3 fragNormal;
+layout(location = 4) flat in uint fragTextureId;
 
 layout(set = 1, binding = 0) uniform sampler texSampler;
 layout(set = 1, binding = 1) uniform texture2D textures[];
@@ -20,13 +21,6 @@ layout(set = 4, binding = 0) uniform DirectionalLightUniformBufferObject {
     mat4 model;
 } directional;
 
-layout(push_constant) uniform PushConstants {
-    mat4 model;
-    uint textureId;
-    vec4 color;
-    float brightness;
-} pcs;
-
 layout(location = 0) out vec4 outColor;
 layout(location = 1) out vec4 outNormal;
 
@@ -36,7 +30,7 @@ void main() {
         pixelColor = vec4(fragColor, 1.0);
     }
     else {
-        pixelColor = texture(sampler2D(textures[pcs.textureId], texSampler), fragTexCoord);
+        pixelColor = texture(sampler2D(textures[nonuniformEXT(fragTextureId)], texSampler), fragTexCoord);
     }
     outColor = pixelColor;
     outNormal = vec4(fragNormal, 1.0);
@@ -5,31 +5,47 @@ layout(binding = 0) uniform UniformBufferObject {
     mat4 proj;
 } ubo;
 
-layout(push_constant) uniform PushConstants {
-    mat4 model;
-    uint textureId;
+struct ObjectData {
     vec4 color;
+    uint textureId;
     float brightness;
-} pcs;
+};
+
+layout(std430, set = 2, binding = 0) readonly buffer ObjectDataBuffer {
+    ObjectData objects[];
+} objectData;
+
+layout(std430, set = 2, binding = 1) readonly buffer ModelMatrixBuffer {
+    mat4 models[];
+} modelMatrices;
 
 layout(location = 0) in vec3 inPosition;
-layout(location = 1) in vec3 inNormal;
-layout(location = 2) in vec3 inColor;
-layout(location = 3) in vec2 inTexCoord;
+layout(location = 1) in vec2 inNormal;  // octahedral
+layout(location = 2) in vec2 inTexCoord;
 
-layout(location = 0) out vec3 fragColor;
+layout(location = 0) flat out vec3 fragColor;
 layout(location = 1) out vec2 fragTexCoord;
 layout(location = 2) out vec3 fragWorldPos;
 layout(location = 3) out vec3 fragNormal;
+layout(location = 4) flat out uint fragTextureId;
 
+vec3 octDecode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
 
 void main() {
-    vec4 worldPos = pcs.model * vec4(inPosition, 1.0);
+    mat4 model = modelMatrices.models[gl_InstanceIndex];
+    vec4 worldPos = model * vec4(inPosition, 1.0);
     gl_Position = ubo.proj * ubo.view * worldPos;
-    fragColor = inColor;
+    fragColor = objectData.objects[gl_InstanceIndex].color.rgb;
     fragTexCoord = inTexCoord;
+    fragTextureId = objectData.objects[gl_InstanceIndex].textureId;
 
     fragWorldPos = worldPos.xyz;
-    mat3 matMult = transpose(inverse(mat3(pcs.model)));
-    fragNormal = normalize(matMult * inNormal);
+    mat3 matMult = transpose(inverse(mat3(model)));
+    fragNormal = normalize(matMult * octDecode(inNormal));
 }
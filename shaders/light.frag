@@ -9,12 +9,27 @@ layout(input_attachment_index=1, set=0, binding=1) uniform subpassInput spNormal
 layout(input_attachment_index=2, set=0, binding=2) uniform subpassInput spDepth;
 
 layout(location=0) in vec2 inNDC;
+layout(location=1) flat in uint inLightIndex;
 
 layout(set=1, binding=0) uniform UniformBufferObject {
     mat4 view;
     mat4 proj;
 } ubo;
 
+struct ObjectData {
+    vec4 color;
+    uint textureId;
+    float brightness;
+};
+
+layout(std430, set=2, binding=0) readonly buffer ObjectDataBuffer {
+    ObjectData objects[];
+} objectData;
+
+layout(std430, set=2, binding=1) readonly buffer ModelMatrixBuffer {
+    mat4 models[];
+} modelMatrices;
+
 layout(push_constant) uniform PushConstants {
     mat4 model;
     uint textureId;
@@ -35,16 +50,16 @@ vec3 reconstructLightWorldPos(mat4 model) {
     return vec3(model * vec4(0,0,0,1));
 }
 
-float calcLightIntensity(vec3 lightPos, vec3 fragPos, vec3 fragNormal, bool physical) {
+float calcLightIntensity(vec3 lightPos, float brightness, vec3 fragPos, vec3 fragNormal, bool physical) {
     vec3 lightVec = lightPos - fragPos;
     float lightDist = length(lightVec);
     float lightDistanceIntensity = 0.0;
     if (physical) {
-        float lightAttenuation = pcs.brightness / max(lightDist*lightDist, 1e-4);
+        float lightAttenuation = brightness / max(lightDist*lightDist, 1e-4);
         lightDistanceIntensity = min(max(lightAttenuation, 0.0), 1.0);
     }
     else {
-        lightDistanceIntensity = min(max(pcs.brightness - lightDist, 0.0), 1.0);
+        lightDistanceIntensity = min(max(brightness - lightDist, 0.0), 1.0);
     }
     float lightNormalizedIntensity = max(dot(fragNormal, normalize(lightVec)), 0.0);
     return lightNormalizedIntensity * lightDistanceIntensity;
@@ -80,10 +95,11 @@ void main() {
     }
 
     else {
-        vec3 lightPos = reconstructLightWorldPos(pcs.model);
+        ObjectData light = objectData.objects[inLightIndex];
+        vec3 lightPos = reconstructLightWorldPos(modelMatrices.models[inLightIndex]);
         vec3 fragWorldPos = reconstructFragWorldPos(inDepth, inNDC);
-        float lightIntensity = calcLightIntensity(lightPos, fragWorldPos, inNormal, false);
-        vec3 lightColor = pcs.color.xyz * lightIntensity * inColor;
+        float lightIntensity = calcLightIntensity(lightPos, light.brightness, fragWorldPos, inNormal, false);
+        vec3 lightColor = light.color.xyz * lightIntensity * inColor;
         outColor = vec4(lightColor, 1.0);
     }
 }
\ No newline at end of file
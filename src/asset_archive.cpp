@@ -0,0 +1,181 @@
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <asset_archive.hpp>
+#include <lz4.hpp>
+
+namespace volchara {
+    namespace {
+        const std::array<char, 4> ASSET_ARCHIVE_MAGIC{'V', 'P', 'A', 'K'};
+
+        struct Header {
+            std::array<char, 4> magic = ASSET_ARCHIVE_MAGIC;
+            uint32_t version = ASSET_ARCHIVE_VERSION;
+            uint32_t entryCount = 0;
+            uint32_t flags = 0;  // none defined yet
+        };
+
+        // entryCount of these follow the header, sorted by name, then the names they point at
+        struct TocRecord {
+            uint64_t offset = 0;
+            uint64_t storedSize = 0;
+            uint64_t size = 0;
+            uint32_t compression = 0;
+            uint32_t nameLength = 0;
+            // from the start of the names
+            uint64_t nameOffset = 0;
+        };
+
+        uint64_t alignUp(uint64_t offset) {
+            return (offset + ASSET_ARCHIVE_ALIGNMENT - 1) / ASSET_ARCHIVE_ALIGNMENT * ASSET_ARCHIVE_ALIGNMENT;
+        }
+    }
+
+    AssetArchive::AssetArchive(const std::filesystem::path& archivePath, std::unique_ptr<AssetSource> fallback)
+            : file(std::make_shared<MappedFile>(archivePath)), fallback(std::move(fallback)) {
+        Header header;
+        if (file->size() < sizeof(Header)) {
+            throw std::runtime_error("asset archive is truncated!");
+        }
+        std::memcpy(&header, file->data(), sizeof(Header));
+        if (header.magic != ASSET_ARCHIVE_MAGIC || header.version != ASSET_ARCHIVE_VERSION) {
+            throw std::runtime_error("asset archive has an unknown format!");
+        }
+        uint64_t namesOffset = sizeof(Header) + static_cast<uint64_t>(header.entryCount) * sizeof(TocRecord);
+        if (namesOffset > file->size()) {
+            throw std::runtime_error("asset archive is truncated!");
+        }
+        entries.reserve(header.entryCount);
+        for (uint32_t i = 0; i < header.entryCount; i++) {
+            TocRecord record;
+            std::memcpy(&record, file->data() + sizeof(Header) + i * sizeof(TocRecord), sizeof(TocRecord));
+            uint64_t namesSize = file->size() - namesOffset;
+            bool known = record.compression == static_cast<uint32_t>(AssetCompression::None) || record.compression == static_cast<uint32_t>(AssetCompression::LZ4);
+            if (record.nameOffset > namesSize || record.nameLength > namesSize - record.nameOffset
+                    || record.offset > file->size() || record.storedSize > file->size() - record.offset || !known
+                    || (record.compression == static_cast<uint32_t>(AssetCompression::None) && record.storedSize != record.size)) {
+                throw std::runtime_error("asset archive is corrupt!");
+            }
+            ArchiveEntry entry{
+                .name = std::string_view(reinterpret_cast<const char*>(file->data() + namesOffset + record.nameOffset), record.nameLength),
+                .offset = record.offset,
+                .storedSize = record.storedSize,
+                .size = record.size,
+                .compression = static_cast<AssetCompression>(record.compression),
+            };
+            // lookups bisect the table as it is
+            if (!entries.empty() && entries.back().name >= entry.name) {
+                throw std::runtime_error("asset archive is corrupt!");
+            }
+            entries.push_back(entry);
+        }
+    }
+
+    const ArchiveEntry* AssetArchive::find(std::string_view name) const {
+        auto entry = std::lower_bound(entries.begin(), entries.end(), name, [](const ArchiveEntry& entry, std::string_view name) {
+            return entry.name < name;
+        });
+        return entry != entries.end() && entry->name == name ? &*entry : nullptr;
+    }
+
+    std::span<const ArchiveEntry> AssetArchive::contents() const {
+        return entries;
+    }
+
+    bool AssetArchive::contains(std::string_view name) const {
+        return find(name) || (fallback && fallback->contains(name));
+    }
+
+    Asset AssetArchive::open(std::string_view name) const {
+        const ArchiveEntry* entry = find(name);
+        if (!entry) {
+            if (fallback) return fallback->open(name);
+            throw std::runtime_error("asset " + std::string(name) + " isn't in the archive!");
+        }
+        std::span<const std::byte> stored(file->data() + entry->offset, entry->storedSize);
+        if (entry->compression == AssetCompression::None) {
+            return Asset(file, stored);
+        }
+        auto buffer = std::make_shared<std::vector<std::byte>>(entry->size);
+        lz4Decompress(stored, *buffer);
+        return Asset(buffer, *buffer);
+    }
+
+    void writeAssetArchive(const std::filesystem::path& archivePath, std::vector<ArchiveInput> inputs, AssetCompression compression) {
+        std::sort(inputs.begin(), inputs.end(), [](const ArchiveInput& a, const ArchiveInput& b) {
+            return a.name < b.name;
+        });
+        for (size_t i = 1; i < inputs.size(); i++) {
+            if (inputs[i - 1].name == inputs[i].name) {
+                throw std::runtime_error("asset archive would contain " + inputs[i].name + " twice!");
+            }
+        }
+        Header header{.entryCount = static_cast<uint32_t>(inputs.size())};
+        std::vector<TocRecord> records;
+        std::string names;
+        for (const ArchiveInput& input : inputs) {
+            records.push_back({
+                .nameLength = static_cast<uint32_t>(input.name.size()),
+                .nameOffset = names.size(),
+            });
+            names += input.name;
+        }
+
+        std::filesystem::path temporaryPath = archivePath;
+        temporaryPath += ".tmp";
+        std::ofstream out(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            throw std::runtime_error("failed to open asset archive for writing!");
+        }
+        try {
+            // the table is written last, once the entries' offsets and stored sizes are known
+            uint64_t written = sizeof(Header) + records.size() * sizeof(TocRecord) + names.size();
+            out.seekp(static_cast<std::streamoff>(written));
+            const char zeros[ASSET_ARCHIVE_ALIGNMENT] = {};
+            for (size_t i = 0; i < inputs.size(); i++) {
+                MappedFile file(inputs[i].file);
+                std::span<const std::byte> stored(file.data(), file.size());
+                std::vector<std::byte> compressed;
+                if (compression == AssetCompression::LZ4) {
+                    compressed = lz4Compress(stored);
+                    if (compressed.size() <= stored.size() - stored.size() / 8) {
+                        stored = compressed;
+                        records[i].compression = static_cast<uint32_t>(AssetCompression::LZ4);
+                    }
+                }
+                records[i].offset = alignUp(written);
+                records[i].storedSize = stored.size();
+                records[i].size = file.size();
+                out.write(zeros, static_cast<std::streamsize>(records[i].offset - written));
+                out.write(reinterpret_cast<const char*>(stored.data()), static_cast<std::streamsize>(stored.size()));
+                written = records[i].offset + stored.size();
+            }
+            out.seekp(0);
+            out.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+            out.write(reinterpret_cast<const char*>(records.data()), static_cast<std::streamsize>(records.size() * sizeof(TocRecord)));
+            out.write(names.data(), static_cast<std::streamsize>(names.size()));
+            out.close();
+            if (!out) {
+                throw std::runtime_error("failed to write asset archive!");
+            }
+            std::filesystem::rename(temporaryPath, archivePath);
+        } catch (...) {
+            std::error_code error;
+            std::filesystem::remove(temporaryPath, error);
+            throw;
+        }
+    }
+}
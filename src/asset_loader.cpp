@@ -0,0 +1,51 @@
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include <asset_loader.hpp>
+
+namespace volchara {
+    AssetLoader::AssetLoader(bool threaded) {
+        if (threaded) {
+            thread = std::thread(&AssetLoader::loop, this);
+        }
+    }
+
+    AssetLoader::~AssetLoader() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wakeCondition.notify_all();
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+
+    void AssetLoader::submit(std::function<void()> task) {
+        if (!thread.joinable()) {
+            task();
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push_back(std::move(task));
+        }
+        wakeCondition.notify_one();
+    }
+
+    void AssetLoader::loop() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wakeCondition.wait(lock, [this]{ return stopping || !tasks.empty(); });
+                if (stopping) return;
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+            task();
+        }
+    }
+}
@@ -0,0 +1,23 @@
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+#include <asset_source.hpp>
+#include <mapped_file.hpp>
+
+namespace volchara {
+    LooseFileSource::LooseFileSource(std::filesystem::path root) : root(std::move(root)) {}
+
+    bool LooseFileSource::contains(std::string_view name) const {
+        std::error_code error;
+        return std::filesystem::is_regular_file(root / name, error);
+    }
+
+    Asset LooseFileSource::open(std::string_view name) const {
+        auto file = std::make_shared<MappedFile>(root / name);
+        return Asset(file, std::span(file->data(), file->size()));
+    }
+}
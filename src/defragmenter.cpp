@@ -0,0 +1,215 @@
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <vulkan/vulkan_raii.hpp>
+#include <vk_mem_alloc.hpp>
+
+#include <defragmenter.hpp>
+#include <memory_stats.hpp>
+#include <raii_wrappers.hpp>
+
+namespace volchara {
+    Defragmenter::Defragmenter(vk::raii::Device& dev, RAIIAllocator& fromAllocator, uint32_t queueFamilyIndex, uint32_t maxMovesPerPass, vk::DeviceSize maxBytesPerPass) {
+        device = &dev;
+        allocator = fromAllocator;
+        maxMoves = maxMovesPerPass;
+        maxBytes = maxBytesPerPass;
+        queue = device->getQueue(queueFamilyIndex, 0);
+        vk::CommandPoolCreateInfo poolInfo{
+            .flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+            .queueFamilyIndex = queueFamilyIndex,
+        };
+        commandPool = device->createCommandPool(poolInfo);
+        vk::CommandBufferAllocateInfo commandInfo{
+            .commandPool = commandPool,
+            .level = vk::CommandBufferLevel::ePrimary,
+            .commandBufferCount = 1,
+        };
+        commands = std::move(device->allocateCommandBuffers(commandInfo).front());
+        fence = device->createFence({});
+    }
+    Defragmenter::~Defragmenter() {
+        if (context) vmaEndDefragmentation(static_cast<VmaAllocator>(allocator), context, nullptr);
+    }
+    Defragmenter::Defragmenter(Defragmenter&& other) {
+        swap(*this, other);
+    }
+    const Defragmenter& Defragmenter::operator=(Defragmenter&& other) {
+        Defragmenter t(std::move(other));
+        swap(*this, t);
+        return *this;
+    }
+
+    bool Defragmenter::active() const {
+        return context != nullptr;
+    }
+
+    void Defragmenter::begin() {
+        if (context) return;
+        VmaDefragmentationInfo info{
+            .flags = VMA_DEFRAGMENTATION_FLAG_ALGORITHM_BALANCED_BIT,
+            .maxBytesPerPass = maxBytes,
+            .maxAllocationsPerPass = maxMoves,
+        };
+        if (vmaBeginDefragmentation(static_cast<VmaAllocator>(allocator), &info, &context) != VK_SUCCESS) {
+            throw std::runtime_error("failed to begin defragmentation!");
+        }
+    }
+
+    bool Defragmenter::step(std::span<RAIIvmaBuffer* const> buffers, std::span<RAIIvmaImage> textures, bool& buffersMoved, std::vector<uint32_t>& movedTextures) {
+        buffersMoved = false;
+        movedTextures.clear();
+        if (!context) return false;
+        VmaAllocator vmaAllocator = static_cast<VmaAllocator>(allocator);
+        VmaDefragmentationPassMoveInfo pass{};
+        VkResult result = vmaBeginDefragmentationPass(vmaAllocator, context, &pass);
+        if (result == VK_INCOMPLETE) {
+            std::vector<RAIIvmaBuffer*> movingBuffers;
+            std::vector<vk::ImageMemoryBarrier> beforeCopies;
+            std::vector<vk::ImageMemoryBarrier> afterCopies;
+            commands.reset();
+            commands.begin({.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+            vk::ImageSubresourceRange color{
+                .aspectMask = vk::ImageAspectFlagBits::eColor,
+                .levelCount = 1,
+                .layerCount = 1,
+            };
+            for (uint32_t i = 0; i < pass.moveCount; i++) {
+                VmaDefragmentationMove& move = pass.pMoves[i];
+                vma::Allocation source(move.srcAllocation);
+                vma::Allocation destination(move.dstTmpAllocation);
+                auto buffer = std::find_if(buffers.begin(), buffers.end(), [&](RAIIvmaBuffer* buffer) { return static_cast<vma::Allocation>(*buffer) == source; });
+                auto texture = std::find_if(textures.begin(), textures.end(), [&](const RAIIvmaImage& texture) { return static_cast<vma::Allocation>(texture) == source; });
+                // anything else, e.g. a persistently mapped buffer, stays where it is
+                if (buffer == buffers.end() && texture == textures.end()) {
+                    move.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+                    continue;
+                }
+                VmaAllocationInfo allocationInfo;
+                vmaGetAllocationInfo(vmaAllocator, move.srcAllocation, &allocationInfo);
+                moved.allocationsMoved++;
+                moved.bytesMoved += allocationInfo.size;
+                if (buffer != buffers.end()) {
+                    vk::Buffer target = (*buffer)->beginMove(destination);
+                    commands.copyBuffer(**buffer, target, vk::BufferCopy{.size = (*buffer)->size()});
+                    movingBuffers.push_back(*buffer);
+                    continue;
+                }
+                vk::Image target = texture->beginMove(destination);
+                beforeCopies.push_back({
+                    .srcAccessMask = vk::AccessFlagBits::eShaderRead,
+                    .dstAccessMask = vk::AccessFlagBits::eTransferRead,
+                    .oldLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
+                    .newLayout = vk::ImageLayout::eTransferSrcOptimal,
+                    .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+                    .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+                    .image = *texture,
+                    .subresourceRange = color,
+                });
+                beforeCopies.push_back({
+                    .dstAccessMask = vk::AccessFlagBits::eTransferWrite,
+                    .oldLayout = vk::ImageLayout::eUndefined,
+                    .newLayout = vk::ImageLayout::eTransferDstOptimal,
+                    .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+                    .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+                    .image = target,
+                    .subresourceRange = color,
+                });
+                afterCopies.push_back({
+                    .srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+                    .dstAccessMask = vk::AccessFlagBits::eShaderRead,
+                    .oldLayout = vk::ImageLayout::eTransferDstOptimal,
+                    .newLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
+                    .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+                    .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+                    .image = target,
+                    .subresourceRange = color,
+                });
+                movedTextures.push_back(static_cast<uint32_t>(texture - textures.begin()));
+            }
+            // every move of the pass may have been ignored, which leaves nothing to submit or wait for
+            if (movingBuffers.empty() && movedTextures.empty()) {
+                commands.end();
+                result = vmaEndDefragmentationPass(vmaAllocator, context, &pass);
+                return finishStep(result);
+            }
+            // the transitions of every texture come first, then all the copies
+            if (!beforeCopies.empty()) {
+                commands.pipelineBarrier(vk::PipelineStageFlagBits::eAllCommands, vk::PipelineStageFlagBits::eTransfer, {}, nullptr, nullptr, beforeCopies);
+            }
+            vk::ImageSubresourceLayers layers{
+                .aspectMask = vk::ImageAspectFlagBits::eColor,
+                .layerCount = 1,
+            };
+            for (size_t i = 0; i < movedTextures.size(); i++) {
+                RAIIvmaImage& texture = textures[movedTextures[i]];
+                vk::ImageCopy region{
+                    .srcSubresource = layers,
+                    .dstSubresource = layers,
+                    .extent = texture.extent(),
+                };
+                // afterCopies holds the new images in the same order
+                commands.copyImage(texture, vk::ImageLayout::eTransferSrcOptimal, afterCopies[i].image, vk::ImageLayout::eTransferDstOptimal, region);
+            }
+            vk::MemoryBarrier copied{
+                .srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+                .dstAccessMask = vk::AccessFlagBits::eMemoryRead | vk::AccessFlagBits::eMemoryWrite,
+            };
+            commands.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eAllCommands, {}, copied, nullptr, afterCopies);
+            commands.end();
+            vk::SubmitInfo submitInfo{
+                .commandBufferCount = 1,
+                .pCommandBuffers = &*commands,
+            };
+            // the fence also covers the frames submitted before the pass, the only ones that may still read the old copies
+            queue.submit(submitInfo, fence);
+            device->waitForFences({fence}, true, std::numeric_limits<uint64_t>::max());
+            device->resetFences({fence});
+
+            for (RAIIvmaBuffer* buffer : movingBuffers) {
+                buffer->finishMove();
+            }
+            for (uint32_t index : movedTextures) {
+                textures[index].finishMove();
+            }
+            buffersMoved = !movingBuffers.empty();
+            moved.passes++;
+            result = vmaEndDefragmentationPass(vmaAllocator, context, &pass);
+        }
+        return finishStep(result);
+    }
+
+    bool Defragmenter::finishStep(VkResult result) {
+        if (result == VK_SUCCESS) {
+            vmaEndDefragmentation(static_cast<VmaAllocator>(allocator), context, nullptr);
+            context = nullptr;
+            return false;
+        }
+        if (result != VK_INCOMPLETE) {
+            throw std::runtime_error("defragmentation failed!");
+        }
+        return true;
+    }
+
+    FragmentationStats Defragmenter::stats() const {
+        return moved;
+    }
+
+    void Defragmenter::swap(Defragmenter& lhs, Defragmenter& rhs) {
+        std::swap(lhs.device, rhs.device);
+        std::swap(lhs.allocator, rhs.allocator);
+        std::swap(lhs.queue, rhs.queue);
+        std::swap(lhs.commandPool, rhs.commandPool);
+        std::swap(lhs.commands, rhs.commands);
+        std::swap(lhs.fence, rhs.fence);
+        std::swap(lhs.context, rhs.context);
+        std::swap(lhs.maxMoves, rhs.maxMoves);
+        std::swap(lhs.maxBytes, rhs.maxBytes);
+        std::swap(lhs.moved, rhs.moved);
+    }
+}
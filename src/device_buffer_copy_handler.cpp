@@ -13,7 +13,7 @@ namespace volchara {
         commandPool = device->createCommandPool(poolInfo);
         // fence = device->createFence({});
     }
-    void DeviceBufferCopyHandler::submit(vk::Buffer& from, vk::Buffer& to, uint32_t size) {
+    void DeviceBufferCopyHandler::submit(vk::Buffer& from, vk::Buffer& to, uint32_t size, vk::DeviceSize dstOffset) {
         vk::CommandBufferAllocateInfo bufInfo{
             .commandPool = commandPool,
             .level = vk::CommandBufferLevel::ePrimary,
@@ -22,6 +22,7 @@ namespace volchara {
         vk::raii::CommandBuffer cmdBuf = std::move(device->allocateCommandBuffers(bufInfo).front());
         cmdBuf.begin({.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
         vk::BufferCopy copyCmd{
+            .dstOffset = dstOffset,
             .size = size,
         };
         cmdBuf.copyBuffer(from, to, copyCmd);
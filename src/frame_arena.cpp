@@ -0,0 +1,72 @@
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+
+#include <frame_arena.hpp>
+
+namespace volchara {
+    FrameArena::FrameArena(size_t capacity, std::pmr::memory_resource* upstream) : upstream(upstream) {
+        if (capacity > 0) {
+            block = static_cast<std::byte*>(upstream->allocate(capacity, alignof(std::max_align_t)));
+            blockSize = capacity;
+        }
+    }
+
+    FrameArena::~FrameArena() {
+        releaseOverflow();
+        if (block) upstream->deallocate(block, blockSize, alignof(std::max_align_t));
+    }
+
+    void* FrameArena::do_allocate(size_t bytes, size_t alignment) {
+        void* data = block + used;
+        size_t space = blockSize - used;
+        if (block && std::align(alignment, bytes, data, space)) {
+            used = blockSize - space + bytes;
+            return data;
+        }
+        // the header sits in front of the data, on the data's alignment
+        alignment = std::max(alignment, alignof(Overflow));
+        size_t headerSize = (sizeof(Overflow) + alignment - 1) / alignment * alignment;
+        size_t size = headerSize + bytes;
+        std::byte* allocation = static_cast<std::byte*>(upstream->allocate(size, alignment));
+        overflow = new (allocation) Overflow{.size = size, .alignment = alignment, .next = overflow};
+        overflowBytes += size;
+        return allocation + headerSize;
+    }
+
+    void FrameArena::do_deallocate(void*, size_t, size_t) {}
+
+    bool FrameArena::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+        return this == &other;
+    }
+
+    void FrameArena::releaseOverflow() {
+        while (overflow) {
+            Overflow* next = overflow->next;
+            upstream->deallocate(overflow, overflow->size, overflow->alignment);
+            overflow = next;
+        }
+        overflowBytes = 0;
+    }
+
+    void FrameArena::reset() {
+        if (overflow) {
+            // one block that holds all of this frame, with room for the next to grow a little
+            size_t needed = used + overflowBytes;
+            releaseOverflow();
+            if (block) upstream->deallocate(block, blockSize, alignof(std::max_align_t));
+            blockSize = std::max(needed + needed / 2, blockSize * 2);
+            block = static_cast<std::byte*>(upstream->allocate(blockSize, alignof(std::max_align_t)));
+        }
+        used = 0;
+    }
+
+    size_t FrameArena::capacity() const {
+        return blockSize;
+    }
+
+    size_t FrameArena::bytesUsed() const {
+        return used + overflowBytes;
+    }
+}
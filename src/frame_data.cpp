@@ -0,0 +1,164 @@
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <limits>
+#include <memory_resource>
+#include <span>
+#include <vector>
+
+#include <vulkan/vulkan_raii.hpp>
+#include <glm/glm.hpp>
+
+#include <frame_data.hpp>
+
+namespace volchara {
+    void RenderTransforms::interpolate(const SimulationSnapshot& from, const SimulationSnapshot& to, float alpha, JobSystem& jobs) {
+        size_t slotCount = to.transforms.size();
+        // a tick that swapped in a loaded model added transforms, which it isn't interpolated into
+        if (from.transforms.size() != slotCount) {
+            interpolate(to, to, alpha, jobs);
+            return;
+        }
+
+        // a slot that didn't move in either tick still has the right matrix, unless a tick went unseen
+        bool updateAll = store.size() != slotCount || to.tick > tick + 1;
+        store.resize(slotCount);
+        if (hierarchyGeneration != to.hierarchyGeneration) {
+            store.setParentSlots(to.parents);
+            hierarchyGeneration = to.hierarchyGeneration;
+        }
+        jobs.parallelForRange(slotCount, MIN_OBJECTS_PER_UPDATE_JOB, [&](size_t begin, size_t end) {
+            for (size_t slot = begin; slot < end; slot++) {
+                if (updateAll || from.moved[slot] || to.moved[slot]) {
+                    store.set(static_cast<uint32_t>(slot), TransformState::interpolate(from.transforms[slot], to.transforms[slot], alpha));
+                }
+            }
+        });
+        store.updateMatrices(jobs, MIN_OBJECTS_PER_UPDATE_JOB);
+        tick = to.tick;
+    }
+
+    void writeModelMatrices(glm::mat4* models, const TransformStore& transforms, std::span<const uint32_t> instanceSlots, JobSystem& jobs) {
+        // instances aren't slots: an object's submeshes share their node's slot, nodes without a mesh and the camera
+        // have slots of their own, and instances are ordered by archetype so a secondary buffer draws a range of them.
+        // so matrices are gathered from the contiguous world matrix column, mostly in order as an object's nodes
+        // take consecutive slots, and written out sequentially in instance order
+        jobs.parallelForRange(instanceSlots.size(), MIN_OBJECTS_PER_UPDATE_JOB, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                models[i] = transforms.worldMatrix(instanceSlots[i]);
+            }
+        });
+    }
+
+    void writeObjectData(ObjectData* data, SceneRegistry& scene) {
+        scene.forEach(DRAWABLE_COMPONENTS, [&](Archetype& archetype, size_t first) {
+            for (size_t row = 0; row < archetype.size(); row++) {
+                data[first + row] = {
+                    .color = glm::vec4(archetype.materials[row].color, 0.0f),
+                    .textureIndex = archetype.materials[row].textureIndex,
+                };
+            }
+        });
+    }
+
+    bool selectLodLevels(SceneRegistry& scene, const TransformStore& transforms, glm::vec3 cameraPosition, float pixelsPerUnit,
+            float pixelError, JobSystem& jobs) {
+        std::atomic<bool> changed = false;
+        scene.forEach(DRAWABLE_COMPONENTS | COMPONENT_LOD, [&](Archetype& archetype, size_t) {
+            jobs.parallelForRange(archetype.size(), MIN_OBJECTS_PER_UPDATE_JOB, [&](size_t begin, size_t end) {
+                for (size_t row = begin; row < end; row++) {
+                    // an instance added since the last snapshot has no interpolated transform yet
+                    if (archetype.transforms[row] >= transforms.size()) continue;
+                    LodChain& chain = archetype.lods[row];
+                    const glm::mat4& model = transforms.worldMatrix(archetype.transforms[row]);
+                    float scale = std::max({glm::length(glm::vec3(model[0])), glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))});
+                    float radius = chain.radius * scale;
+                    float distance = glm::length(glm::vec3(model * glm::vec4(chain.center, 1.0f)) - cameraPosition);
+                    // the bounding sphere's projected radius in pixels; from inside it the full mesh is drawn
+                    float projectedRadius = distance > radius ? radius * pixelsPerUnit / distance : std::numeric_limits<float>::max();
+                    uint32_t level = chain.current;
+                    while (level + 1 < chain.levelCount && chain.levels[level + 1].error * projectedRadius <= pixelError * LOD_HYSTERESIS) level++;
+                    while (level > 0 && chain.levels[level].error * projectedRadius > pixelError) level--;
+                    if (level == chain.current) continue;
+                    chain.current = level;
+                    archetype.meshes[row].firstIndex = chain.levels[level].firstIndex;
+                    archetype.meshes[row].indexCount = chain.levels[level].indexCount;
+                    archetype.meshes[row].firstMeshlet = chain.levels[level].firstMeshlet;
+                    archetype.meshes[row].meshletCount = chain.levels[level].meshletCount;
+                    changed = true;
+                }
+            });
+        });
+        return changed;
+    }
+
+    MeshletCullLayout writeMeshletCullJobs(SceneRegistry& scene, MeshletCullJob* jobs, vk::DrawIndexedIndirectCommand* draws,
+            std::vector<uint32_t>& drawSlots) {
+        drawSlots.resize(scene.count(DRAWABLE_COMPONENTS), NO_MESHLET_DRAW);
+        MeshletCullLayout layout;
+        uint32_t culledIndexCount = 0;
+        scene.forEach(DRAWABLE_COMPONENTS, [&](Archetype& archetype, size_t first) {
+            for (size_t row = 0; row < archetype.size(); row++) {
+                const MeshRef& mesh = archetype.meshes[row];
+                uint32_t instance = static_cast<uint32_t>(first + row);
+                uint32_t slot = NO_MESHLET_DRAW;
+                // every draw reserves room for all its indices; what doesn't fit is drawn whole
+                if (mesh.meshletCount > 0 && mesh.indexCount > 0 && layout.jobCount + mesh.meshletCount <= MESHLET_CULL_JOB_CAPACITY &&
+                        culledIndexCount + mesh.indexCount <= CULLED_INDEX_CAPACITY) {
+                    draws[layout.drawCount] = {
+                        .indexCount = 0,
+                        .instanceCount = 1,
+                        .firstIndex = culledIndexCount,
+                        .vertexOffset = mesh.vertexOffset,
+                        .firstInstance = instance,
+                    };
+                    for (uint32_t meshlet = 0; meshlet < mesh.meshletCount; meshlet++) {
+                        jobs[layout.jobCount++] = {.meshlet = mesh.firstMeshlet + meshlet, .instance = instance, .draw = layout.drawCount};
+                    }
+                    slot = layout.drawCount++;
+                    culledIndexCount += mesh.indexCount;
+                }
+                layout.slotsChanged |= drawSlots[instance] != slot;
+                drawSlots[instance] = slot;
+            }
+        });
+        return layout;
+    }
+
+    MeshletCullDispatch meshletCullDispatch(uint32_t jobCount) {
+        // a workgroup per job, in rows no wider than every device allows
+        const uint32_t maxGroupsPerRow = 65535;
+        uint32_t groupsPerRow = std::min(jobCount, maxGroupsPerRow);
+        return {
+            .groupCountX = groupsPerRow,
+            .groupCountY = groupsPerRow > 0 ? (jobCount + groupsPerRow - 1) / groupsPerRow : 0,
+            .jobCount = jobCount,
+        };
+    }
+
+    void writeDrawCommands(vk::DrawIndexedIndirectCommand* commands, SceneRegistry& scene, std::span<const uint32_t> drawSlots) {
+        scene.forEach(DRAWABLE_COMPONENTS, [&](Archetype& archetype, size_t first) {
+            for (size_t row = 0; row < archetype.size(); row++) {
+                const MeshRef& mesh = archetype.meshes[row];
+                uint32_t instance = static_cast<uint32_t>(first + row);
+                // firstInstance selects the ObjectData record
+                commands[instance] = {
+                    .indexCount = mesh.indexCount,
+                    .instanceCount = drawSlots[instance] == NO_MESHLET_DRAW ? 1u : 0u,
+                    .firstIndex = mesh.firstIndex,
+                    .vertexOffset = mesh.vertexOffset,
+                    .firstInstance = instance,
+                };
+            }
+        });
+    }
+
+    std::pmr::vector<vk::CommandBuffer> gatherCommandBuffers(std::span<const vk::raii::CommandBuffer> buffers, std::pmr::memory_resource* memory) {
+        std::pmr::vector<vk::CommandBuffer> handles(memory);
+        handles.reserve(buffers.size());
+        for (const vk::raii::CommandBuffer& buffer : buffers) {
+            handles.push_back(*buffer);
+        }
+        return handles;
+    }
+}
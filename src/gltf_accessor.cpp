@@ -0,0 +1,178 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include <tiny_gltf.h>
+
+#include <gltf_accessor.hpp>
+
+namespace volchara {
+    namespace {
+        uint32_t componentSize(int componentType) {
+            switch (componentType) {
+                case TINYGLTF_COMPONENT_TYPE_BYTE:
+                case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+                    return 1;
+                case TINYGLTF_COMPONENT_TYPE_SHORT:
+                case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+                    return 2;
+                case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+                case TINYGLTF_COMPONENT_TYPE_FLOAT:
+                    return 4;
+                default:
+                    throw std::runtime_error("failed to load gltf: unsupported accessor component type");
+            }
+        }
+
+        uint32_t typeComponents(int type) {
+            switch (type) {
+                case TINYGLTF_TYPE_SCALAR: return 1;
+                case TINYGLTF_TYPE_VEC2: return 2;
+                case TINYGLTF_TYPE_VEC3: return 3;
+                case TINYGLTF_TYPE_VEC4: return 4;
+                default:
+                    throw std::runtime_error("failed to load gltf: unsupported accessor type");
+            }
+        }
+
+        // the first of count elements of elementSize bytes, stride apart, checked to lie inside the buffer
+        const unsigned char* viewElements(const tinygltf::Model& model, int bufferView, size_t byteOffset, size_t count, size_t elementSize, size_t stride) {
+            if (bufferView < 0 || static_cast<size_t>(bufferView) >= model.bufferViews.size()) {
+                throw std::runtime_error("failed to load gltf: accessor refers to a nonexistent buffer view");
+            }
+            const tinygltf::BufferView& view = model.bufferViews[bufferView];
+            if (view.buffer < 0 || static_cast<size_t>(view.buffer) >= model.buffers.size()) {
+                throw std::runtime_error("failed to load gltf: buffer view refers to a nonexistent buffer");
+            }
+            const std::vector<unsigned char>& data = model.buffers[view.buffer].data;
+            size_t extent = count == 0 ? 0 : (count - 1) * stride + elementSize;
+            if (view.byteOffset > data.size() || view.byteLength > data.size() - view.byteOffset
+                    || byteOffset > view.byteLength || extent > view.byteLength - byteOffset) {
+                throw std::runtime_error("failed to load gltf: accessor exceeds its buffer view");
+            }
+            return data.data() + view.byteOffset + byteOffset;
+        }
+
+        template<typename T>
+        T load(const unsigned char* bytes) {
+            T value;
+            std::memcpy(&value, bytes, sizeof(T));
+            return value;
+        }
+
+        uint32_t loadIndex(const unsigned char* bytes, int componentType) {
+            switch (componentType) {
+                case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE: return *bytes;
+                case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: return load<uint16_t>(bytes);
+                case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT: return load<uint32_t>(bytes);
+                default:
+                    throw std::runtime_error("failed to load gltf: indices are not unsigned integers");
+            }
+        }
+    }
+
+    AccessorView::AccessorView(const tinygltf::Model& model, int accessor) {
+        if (accessor < 0 || static_cast<size_t>(accessor) >= model.accessors.size()) {
+            throw std::runtime_error("failed to load gltf: nonexistent accessor");
+        }
+        const tinygltf::Accessor& source = model.accessors[accessor];
+        componentType = source.componentType;
+        components = typeComponents(source.type);
+        normalized = source.normalized;
+        elementCount = source.count;
+        size_t elementSize = componentSize(componentType) * components;
+
+        if (source.bufferView >= 0) {
+            if (static_cast<size_t>(source.bufferView) >= model.bufferViews.size()) {
+                throw std::runtime_error("failed to load gltf: accessor refers to a nonexistent buffer view");
+            }
+            stride = model.bufferViews[source.bufferView].byteStride;
+            if (stride == 0) stride = elementSize;
+            if (stride < elementSize) {
+                throw std::runtime_error("failed to load gltf: buffer view stride is smaller than its elements");
+            }
+            begin = viewElements(model, source.bufferView, source.byteOffset, elementCount, elementSize, stride);
+        }
+        if (source.bufferView >= 0 && !source.sparse.isSparse) return;
+
+        // elements without a buffer view are zero until the sparse substitutions
+        dense.assign(elementCount * elementSize, 0);
+        for (size_t i = 0; begin && i < elementCount; i++) {
+            std::memcpy(dense.data() + i * elementSize, begin + i * stride, elementSize);
+        }
+        if (source.sparse.isSparse) {
+            const auto& sparse = source.sparse;
+            size_t sparseCount = static_cast<size_t>(std::max(sparse.count, 0));
+            uint32_t indexSize = componentSize(sparse.indices.componentType);
+            const unsigned char* indices = viewElements(model, sparse.indices.bufferView, sparse.indices.byteOffset, sparseCount, indexSize, indexSize);
+            const unsigned char* values = viewElements(model, sparse.values.bufferView, sparse.values.byteOffset, sparseCount, elementSize, elementSize);
+            for (size_t i = 0; i < sparseCount; i++) {
+                uint32_t index = loadIndex(indices + i * indexSize, sparse.indices.componentType);
+                if (index >= elementCount) {
+                    throw std::runtime_error("failed to load gltf: sparse index out of range");
+                }
+                std::memcpy(dense.data() + index * elementSize, values + i * elementSize, elementSize);
+            }
+        }
+        begin = dense.data();
+        stride = elementSize;
+    }
+
+    size_t AccessorView::count() const {
+        return elementCount;
+    }
+
+    uint32_t AccessorView::componentCount() const {
+        return components;
+    }
+
+    uint32_t AccessorView::readIndex(size_t element) const {
+        if (components != 1) {
+            throw std::runtime_error("failed to load gltf: indices are not scalars");
+        }
+        return loadIndex(begin + element * stride, componentType);
+    }
+
+    void AccessorView::readFloats(size_t element, float* out, uint32_t outCount) const {
+        const unsigned char* bytes = begin + element * stride;
+        uint32_t count = std::min(outCount, components);
+        // normalized signed values decode with max(c / MAX, -1), as the spec has it
+        switch (componentType) {
+            case TINYGLTF_COMPONENT_TYPE_FLOAT:
+                std::memcpy(out, bytes, count * sizeof(float));
+                break;
+            case TINYGLTF_COMPONENT_TYPE_BYTE:
+                for (uint32_t i = 0; i < count; i++) {
+                    float value = load<int8_t>(bytes + i);
+                    out[i] = normalized ? std::max(value / 127.0f, -1.0f) : value;
+                }
+                break;
+            case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+                for (uint32_t i = 0; i < count; i++) {
+                    float value = bytes[i];
+                    out[i] = normalized ? value / 255.0f : value;
+                }
+                break;
+            case TINYGLTF_COMPONENT_TYPE_SHORT:
+                for (uint32_t i = 0; i < count; i++) {
+                    float value = load<int16_t>(bytes + i * 2);
+                    out[i] = normalized ? std::max(value / 32767.0f, -1.0f) : value;
+                }
+                break;
+            case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+                for (uint32_t i = 0; i < count; i++) {
+                    float value = load<uint16_t>(bytes + i * 2);
+                    out[i] = normalized ? value / 65535.0f : value;
+                }
+                break;
+            case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+                for (uint32_t i = 0; i < count; i++) {
+                    out[i] = static_cast<float>(load<uint32_t>(bytes + i * 4));
+                }
+                break;
+        }
+    }
+}
@@ -0,0 +1,57 @@
+#include <cstdint>
+#include <span>
+#include <utility>
+
+#include <vulkan/vulkan_raii.hpp>
+#include <vk_mem_alloc.hpp>
+
+#include <growable_buffer.hpp>
+#include <memory_stats.hpp>
+#include <raii_wrappers.hpp>
+#include <staging_ring.hpp>
+
+namespace volchara {
+    namespace {
+        RAIIvmaBuffer createDeviceBuffer(RAIIAllocator& allocator, vk::DeviceSize size, vk::BufferUsageFlags usage, MemoryCategory category, std::span<const uint32_t> queueFamilies) {
+            bool shared = queueFamilies.size() > 1;
+            vk::BufferCreateInfo bufferInfo{
+                .size = size,
+                // the contents are copied out when the buffer is replaced
+                .usage = usage | vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst,
+                .sharingMode = shared ? vk::SharingMode::eConcurrent : vk::SharingMode::eExclusive,
+                .queueFamilyIndexCount = shared ? static_cast<uint32_t>(queueFamilies.size()) : 0,
+                .pQueueFamilyIndices = shared ? queueFamilies.data() : nullptr,
+            };
+            vma::AllocationCreateInfo allocInfo{
+                .usage = vma::MemoryUsage::eAuto,
+            };
+            return allocator.createBuffer(bufferInfo, allocInfo, category);
+        }
+    }
+
+    GrowableBuffer::GrowableBuffer(RAIIAllocator& allocator, vk::DeviceSize elementSize, uint32_t capacity, vk::BufferUsageFlags usage, MemoryCategory category,
+            std::span<const uint32_t> queueFamilies)
+            : allocator(&allocator), elementSize(elementSize), elementCapacity(capacity), usage(usage), category(category), queueFamilies(queueFamilies) {
+        buffer = createDeviceBuffer(allocator, capacity * elementSize, usage, category, queueFamilies);
+    }
+
+    uint32_t GrowableBuffer::capacity() const {
+        return elementCapacity;
+    }
+
+    GrowableBuffer::operator vk::Buffer() const {
+        return buffer;
+    }
+
+    RAIIvmaBuffer& GrowableBuffer::deviceBuffer() {
+        return buffer;
+    }
+
+    RAIIvmaBuffer GrowableBuffer::grow(uint32_t newCapacity, uint32_t used, StagingRing& ring) {
+        RAIIvmaBuffer grown = createDeviceBuffer(*allocator, newCapacity * elementSize, usage, category, queueFamilies);
+        ring.copy(buffer, grown, used * elementSize);
+        elementCapacity = newCapacity;
+        RAIIvmaBuffer::swap(buffer, grown);
+        return grown;
+    }
+}
@@ -0,0 +1,171 @@
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include <job_system.hpp>
+
+namespace volchara {
+    namespace {
+        thread_local const JobSystem* workerOwner = nullptr;
+        thread_local size_t workerQueue = 0;
+    }
+
+    bool JobCounter::done() const {
+        return pending.load(std::memory_order_acquire) == 0;
+    }
+
+    JobSystem::JobQueue::JobQueue() {
+        // how deep a fan-out gets depends on how quickly the workers take its jobs, so a steady frame could still
+        // grow the deque's map long after warming up; clearing leaves the map and the pool's chunks behind
+        for (size_t i = 0; i < RESERVED_QUEUE_JOBS; i++) {
+            jobs.push_back({});
+        }
+        jobs.clear();
+    }
+
+    size_t JobSystem::defaultThreadCount() {
+        #ifdef VOLCHARA_SINGLE_THREADED_JOBS
+        return 0;
+        #else
+        size_t hardwareThreads = std::thread::hardware_concurrency();
+        return hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+        #endif
+    }
+
+    JobSystem::JobSystem(size_t threadCount) {
+        for (size_t i = 0; i < threadCount + 1; i++) {
+            queues.push_back(std::make_unique<JobQueue>());
+        }
+        for (size_t i = 0; i < threadCount; i++) {
+            threads.emplace_back(&JobSystem::workerLoop, this, i + 1);
+        }
+    }
+
+    JobSystem::~JobSystem() {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stopping = true;
+        }
+        wakeCondition.notify_all();
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+    }
+
+    size_t JobSystem::concurrency() const {
+        return threads.size() + 1;
+    }
+
+    bool JobSystem::isSingleThreaded() const {
+        return threads.empty();
+    }
+
+    size_t JobSystem::currentQueue() const {
+        return workerOwner == this ? workerQueue : 0;
+    }
+
+    bool JobSystem::popJob(size_t queueIndex, bool newest, Job& job) {
+        JobQueue& queue = *queues[queueIndex];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.jobs.empty()) return false;
+        if (newest) {
+            job = std::move(queue.jobs.back());
+            queue.jobs.pop_back();
+        } else {
+            job = std::move(queue.jobs.front());
+            queue.jobs.pop_front();
+        }
+        queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    bool JobSystem::tryRunJob() {
+        size_t own = currentQueue();
+        Job job;
+        // own deque LIFO for locality, shared queue FIFO, then steal the oldest job of another worker
+        bool found = (own != 0 && popJob(own, true, job)) || popJob(0, false, job);
+        for (size_t i = 1; !found && i < queues.size(); i++) {
+            size_t victim = (own + i) % queues.size();
+            if (victim != 0 && victim != own) {
+                found = popJob(victim, false, job);
+            }
+        }
+        if (!found) return false;
+        execute(job);
+        return true;
+    }
+
+    void JobSystem::execute(Job& job) {
+        try {
+            job.task();
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(job.counter->errorMutex);
+            if (!job.counter->error) job.counter->error = std::current_exception();
+        }
+        job.counter->pending.fetch_sub(1, std::memory_order_acq_rel);
+    }
+
+    void JobSystem::workerLoop(size_t queueIndex) {
+        workerOwner = this;
+        workerQueue = queueIndex;
+        while (true) {
+            if (tryRunJob()) continue;
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            wakeCondition.wait(lock, [this]{ return stopping || queuedJobs.load(std::memory_order_relaxed) > 0; });
+            if (stopping) return;
+        }
+    }
+
+    void JobSystem::run(JobCounter& counter, std::function<void()> task) {
+        counter.pending.fetch_add(1, std::memory_order_relaxed);
+        JobQueue& queue = *queues[currentQueue()];
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.jobs.push_back({std::move(task), &counter});
+        }
+        queuedJobs.fetch_add(1, std::memory_order_relaxed);
+        if (!threads.empty()) {
+            // taking the lock orders this push against a worker that is about to sleep
+            { std::lock_guard<std::mutex> lock(sleepMutex); }
+            wakeCondition.notify_one();
+        }
+    }
+
+    void JobSystem::wait(JobCounter& counter) {
+        while (!counter.done()) {
+            if (!tryRunJob()) {
+                std::this_thread::yield();
+            }
+        }
+        std::exception_ptr error;
+        {
+            std::lock_guard<std::mutex> lock(counter.errorMutex);
+            error = std::exchange(counter.error, nullptr);
+        }
+        if (error) std::rethrow_exception(error);
+    }
+
+    void JobSystem::parallelFor(size_t count, FunctionRef<void(size_t)> task) {
+        if (count == 0) return;
+        JobCounter counter;
+        for (size_t i = 0; i < count; i++) {
+            run(counter, [&task, i]{ task(i); });
+        }
+        wait(counter);
+    }
+
+    void JobSystem::parallelForRange(size_t count, size_t grainSize, FunctionRef<void(size_t, size_t)> task) {
+        if (count == 0) return;
+        grainSize = std::max<size_t>(grainSize, 1);
+        JobCounter counter;
+        // jobs capture two words, which std::function stores without allocating
+        auto range = [&](size_t begin) { task(begin, std::min(count, begin + grainSize)); };
+        for (size_t begin = 0; begin < count; begin += grainSize) {
+            run(counter, [&range, begin]{ range(begin); });
+        }
+        wait(counter);
+    }
+}
@@ -0,0 +1,34 @@
+#include <cstddef>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include <lz4.h>
+
+#include <lz4.hpp>
+
+namespace volchara {
+    std::vector<std::byte> lz4Compress(std::span<const std::byte> input) {
+        if (input.size() > LZ4_MAX_INPUT_SIZE) {
+            throw std::runtime_error("input is too large for an LZ4 block!");
+        }
+        int inputSize = static_cast<int>(input.size());
+        std::vector<std::byte> output(LZ4_compressBound(inputSize));
+        int written = LZ4_compress_default(reinterpret_cast<const char*>(input.data()), reinterpret_cast<char*>(output.data()), inputSize, static_cast<int>(output.size()));
+        if (written <= 0) {
+            throw std::runtime_error("LZ4 compression failed!");
+        }
+        output.resize(written);
+        return output;
+    }
+
+    void lz4Decompress(std::span<const std::byte> input, std::span<std::byte> output) {
+        if (input.size() > LZ4_MAX_INPUT_SIZE || output.size() > LZ4_MAX_INPUT_SIZE) {
+            throw std::runtime_error("LZ4 block is too large!");
+        }
+        int read = LZ4_decompress_safe(reinterpret_cast<const char*>(input.data()), reinterpret_cast<char*>(output.data()), static_cast<int>(input.size()), static_cast<int>(output.size()));
+        if (read < 0 || static_cast<size_t>(read) != output.size()) {
+            throw std::runtime_error("LZ4 block is corrupt!");
+        }
+    }
+}
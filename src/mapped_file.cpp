@@ -0,0 +1,82 @@
+#include <filesystem>
+#include <stdexcept>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <mapped_file.hpp>
+
+namespace volchara {
+    #if defined(_WIN32)
+    MappedFile::MappedFile(const std::filesystem::path& path) {
+        HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            throw std::runtime_error("failed to open file!");
+        }
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize)) {
+            CloseHandle(file);
+            throw std::runtime_error("failed to read file size!");
+        }
+        length = static_cast<size_t>(fileSize.QuadPart);
+        // an empty file can't be mapped, and there is nothing to read anyway
+        if (length > 0) {
+            mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (mapping) begin = static_cast<const std::byte*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        }
+        CloseHandle(file);
+        if (length > 0 && !begin) {
+            if (mapping) CloseHandle(mapping);
+            throw std::runtime_error("failed to map file!");
+        }
+    }
+
+    MappedFile::~MappedFile() {
+        if (begin) UnmapViewOfFile(begin);
+        if (mapping) CloseHandle(mapping);
+    }
+    #else
+    MappedFile::MappedFile(const std::filesystem::path& path) {
+        int file = open(path.c_str(), O_RDONLY);
+        if (file < 0) {
+            throw std::runtime_error("failed to open file!");
+        }
+        struct stat status;
+        if (fstat(file, &status) != 0) {
+            close(file);
+            throw std::runtime_error("failed to read file size!");
+        }
+        length = static_cast<size_t>(status.st_size);
+        // an empty file can't be mapped, and there is nothing to read anyway
+        if (length > 0) {
+            void* address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, file, 0);
+            if (address != MAP_FAILED) begin = static_cast<const std::byte*>(address);
+        }
+        // the mapping keeps the file alive
+        close(file);
+        if (length > 0 && !begin) {
+            throw std::runtime_error("failed to map file!");
+        }
+    }
+
+    MappedFile::~MappedFile() {
+        if (begin) munmap(const_cast<std::byte*>(begin), length);
+    }
+    #endif
+
+    const std::byte* MappedFile::data() const {
+        return begin;
+    }
+
+    size_t MappedFile::size() const {
+        return length;
+    }
+}
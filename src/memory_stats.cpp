@@ -0,0 +1,80 @@
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+#include <memory_stats.hpp>
+
+namespace volchara {
+    namespace {
+        std::string megabytes(uint64_t bytes) {
+            std::ostringstream out;
+            out.setf(std::ios::fixed);
+            out.precision(1);
+            out << bytes / (1024.0 * 1024.0) << " MB";
+            return out.str();
+        }
+    }
+
+    const char* memoryCategoryName(MemoryCategory category) {
+        switch (category) {
+            case MemoryCategory::Geometry: return "geometry";
+            case MemoryCategory::Textures: return "textures";
+            case MemoryCategory::Attachments: return "attachments";
+            case MemoryCategory::Staging: return "staging";
+            case MemoryCategory::Uniforms: return "uniforms";
+            case MemoryCategory::Other: return "other";
+        }
+        return "unknown";
+    }
+
+    float FragmentationStats::fragmentation() const {
+        if (unusedBytes == 0) return 0.0f;
+        return 1.0f - static_cast<float>(largestUnusedRange) / static_cast<float>(unusedBytes);
+    }
+
+    std::string describeMemoryReport(const MemoryReport& report) {
+        std::ostringstream out;
+        for (size_t heap = 0; heap < report.heaps.size(); heap++) {
+            const HeapUsage& usage = report.heaps[heap];
+            out << "heap " << heap << (usage.deviceLocal ? " (device local)" : "") << ": "
+                << megabytes(usage.usage) << " of " << megabytes(usage.budget) << (report.driverBudget ? " budget" : " estimated budget")
+                << ", " << megabytes(usage.allocationBytes) << " in " << usage.allocationCount << " allocations"
+                << " across " << megabytes(usage.blockBytes) << " of blocks\n";
+        }
+        for (size_t category = 0; category < MEMORY_CATEGORY_COUNT; category++) {
+            const CategoryUsage& usage = report.categories[category];
+            out << memoryCategoryName(static_cast<MemoryCategory>(category)) << ": "
+                << megabytes(usage.bytes) << " in " << usage.allocationCount << " allocations\n";
+        }
+        const FragmentationStats& fragmentation = report.fragmentation;
+        out << "fragmentation: " << static_cast<int>(fragmentation.fragmentation() * 100) << "% of "
+            << megabytes(fragmentation.unusedBytes) << " free in " << fragmentation.unusedRangeCount << " ranges, "
+            << fragmentation.allocationsMoved << " allocations (" << megabytes(fragmentation.bytesMoved) << ") moved in "
+            << fragmentation.passes << " passes\n";
+        return out.str();
+    }
+
+    void MemoryAccounting::add(MemoryCategory category, uint64_t size) {
+        bytes[static_cast<size_t>(category)].fetch_add(size, std::memory_order_relaxed);
+        counts[static_cast<size_t>(category)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void MemoryAccounting::remove(MemoryCategory category, uint64_t size) {
+        bytes[static_cast<size_t>(category)].fetch_sub(size, std::memory_order_relaxed);
+        counts[static_cast<size_t>(category)].fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    std::array<CategoryUsage, MEMORY_CATEGORY_COUNT> MemoryAccounting::usage() const {
+        std::array<CategoryUsage, MEMORY_CATEGORY_COUNT> usage;
+        for (size_t category = 0; category < MEMORY_CATEGORY_COUNT; category++) {
+            usage[category] = {
+                .bytes = bytes[category].load(std::memory_order_relaxed),
+                .allocationCount = counts[category].load(std::memory_order_relaxed),
+            };
+        }
+        return usage;
+    }
+}
@@ -0,0 +1,288 @@
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <mesh_cache.hpp>
+#include <mesh_optimizer.hpp>
+
+namespace volchara {
+    namespace {
+        enum SectionIndex : uint32_t {
+            SECTION_POSITIONS,
+            SECTION_ATTRIBUTES,
+            SECTION_INDICES,
+            SECTION_MESHLETS,
+            SECTION_NODES,
+            SECTION_SUBMESHES,
+            SECTION_LODS,
+            SECTION_MATERIALS,
+            // (int32 image, uint32 uri length, uint32 encoded length, uri, encoded bytes) per texture
+            SECTION_TEXTURES,
+            // (uint64 size, int64 modification time, uint32 uri length, uri) per external buffer file of the model
+            SECTION_SOURCES,
+            SECTION_COUNT,
+        };
+
+        struct Section {
+            uint64_t offset = 0;
+            uint64_t size = 0;
+        };
+
+        const std::array<char, 4> MESH_CACHE_MAGIC{'V', 'M', 'S', 'H'};
+        // every section starts aligned for any of the cached structs
+        const size_t SECTION_ALIGNMENT = 16;
+
+        struct Header {
+            std::array<char, 4> magic = MESH_CACHE_MAGIC;
+            uint32_t version = MESH_CACHE_VERSION;
+            // the model file the cache was built from
+            uint64_t sourceSize = 0;
+            int64_t sourceTime = 0;
+            uint64_t settingsHash = 0;
+            uint32_t flags = 0;  // none defined yet
+            uint32_t padding = 0;
+            std::array<Section, SECTION_COUNT> sections;
+        };
+
+        bool readSource(const std::filesystem::path& modelPath, uint64_t& size, int64_t& time) {
+            std::error_code error;
+            size = std::filesystem::file_size(modelPath, error);
+            if (error) return false;
+            time = std::filesystem::last_write_time(modelPath, error).time_since_epoch().count();
+            return !error;
+        }
+
+        // FNV-1a over everything besides the model that shapes the cached geometry
+        uint64_t hashSettings(const LodSettings& lodSettings) {
+            const std::array<uint32_t, 6> values{
+                lodSettings.maxLevels,
+                std::bit_cast<uint32_t>(lodSettings.reduction),
+                std::bit_cast<uint32_t>(lodSettings.maxError),
+                MAX_MESHLET_VERTICES,
+                MAX_MESHLET_TRIANGLES,
+                VERTEX_CACHE_SIZE,
+            };
+            uint64_t hash = 0xcbf29ce484222325ull;
+            for (uint32_t value : values) {
+                for (int byte = 0; byte < 4; byte++) {
+                    hash ^= (value >> (byte * 8)) & 0xff;
+                    hash *= 0x100000001b3ull;
+                }
+            }
+            return hash;
+        }
+
+        // true if every recorded buffer file next to the model still has its size and modification time
+        bool sourcesUnchanged(std::span<const std::byte> bytes, const std::filesystem::path& modelDirectory) {
+            size_t offset = 0;
+            while (offset < bytes.size()) {
+                uint64_t recordedSize;
+                int64_t recordedTime;
+                uint32_t uriLength;
+                if (bytes.size() - offset < sizeof(recordedSize) + sizeof(recordedTime) + sizeof(uriLength)) {
+                    throw std::runtime_error("mesh cache is corrupt!");
+                }
+                std::memcpy(&recordedSize, bytes.data() + offset, sizeof(recordedSize));
+                std::memcpy(&recordedTime, bytes.data() + offset + sizeof(recordedSize), sizeof(recordedTime));
+                std::memcpy(&uriLength, bytes.data() + offset + sizeof(recordedSize) + sizeof(recordedTime), sizeof(uriLength));
+                offset += sizeof(recordedSize) + sizeof(recordedTime) + sizeof(uriLength);
+                if (bytes.size() - offset < uriLength) {
+                    throw std::runtime_error("mesh cache is corrupt!");
+                }
+                std::string uri(reinterpret_cast<const char*>(bytes.data() + offset), uriLength);
+                offset += uriLength;
+                uint64_t size;
+                int64_t time;
+                if (!readSource(modelDirectory / uri, size, time) || size != recordedSize || time != recordedTime) return false;
+            }
+            return true;
+        }
+
+        Header readHeader(const MappedFile& file) {
+            Header header;
+            if (file.size() < sizeof(Header)) {
+                throw std::runtime_error("mesh cache is truncated!");
+            }
+            std::memcpy(&header, file.data(), sizeof(Header));
+            return header;
+        }
+
+        template<typename T>
+        std::span<const T> readSection(const MappedFile& file, const Header& header, SectionIndex index) {
+            const Section& section = header.sections[index];
+            if (section.offset > file.size() || section.size > file.size() - section.offset
+                    || section.offset % alignof(T) != 0 || section.size % sizeof(T) != 0) {
+                throw std::runtime_error("mesh cache is corrupt!");
+            }
+            return std::span(reinterpret_cast<const T*>(file.data() + section.offset), section.size / sizeof(T));
+        }
+
+        std::vector<CachedTexture> readTextures(std::span<const std::byte> bytes) {
+            std::vector<CachedTexture> textures;
+            size_t offset = 0;
+            while (offset < bytes.size()) {
+                int32_t image;
+                uint32_t uriLength;
+                uint32_t encodedLength;
+                if (bytes.size() - offset < sizeof(image) + sizeof(uriLength) + sizeof(encodedLength)) {
+                    throw std::runtime_error("mesh cache is corrupt!");
+                }
+                std::memcpy(&image, bytes.data() + offset, sizeof(image));
+                std::memcpy(&uriLength, bytes.data() + offset + sizeof(image), sizeof(uriLength));
+                std::memcpy(&encodedLength, bytes.data() + offset + sizeof(image) + sizeof(uriLength), sizeof(encodedLength));
+                offset += sizeof(image) + sizeof(uriLength) + sizeof(encodedLength);
+                if (bytes.size() - offset < static_cast<uint64_t>(uriLength) + encodedLength) {
+                    throw std::runtime_error("mesh cache is corrupt!");
+                }
+                textures.push_back({
+                    .image = image,
+                    .uri = std::string(reinterpret_cast<const char*>(bytes.data() + offset), uriLength),
+                    .encoded = bytes.subspan(offset + uriLength, encodedLength),
+                });
+                offset += uriLength + encodedLength;
+            }
+            return textures;
+        }
+    }
+
+    MeshCache::MeshCache(const std::filesystem::path& cachePath) : file(cachePath) {
+        Header header = readHeader(file);
+        if (header.magic != MESH_CACHE_MAGIC || header.version != MESH_CACHE_VERSION) {
+            throw std::runtime_error("mesh cache has an unknown format!");
+        }
+        data.positions = readSection<PositionStream>(file, header, SECTION_POSITIONS);
+        data.attributes = readSection<AttributeStream>(file, header, SECTION_ATTRIBUTES);
+        data.indices = readSection<uint32_t>(file, header, SECTION_INDICES);
+        data.meshlets = readSection<Meshlet>(file, header, SECTION_MESHLETS);
+        data.nodes = readSection<CachedNode>(file, header, SECTION_NODES);
+        data.submeshes = readSection<Submesh>(file, header, SECTION_SUBMESHES);
+        data.lods = readSection<CachedLodChain>(file, header, SECTION_LODS);
+        data.materials = readSection<CachedMaterial>(file, header, SECTION_MATERIALS);
+        data.textures = readTextures(readSection<std::byte>(file, header, SECTION_TEXTURES));
+        if (data.positions.size() != data.attributes.size()) {
+            throw std::runtime_error("mesh cache is corrupt!");
+        }
+    }
+
+    std::shared_ptr<const MeshCache> MeshCache::open(const std::filesystem::path& cachePath, const std::filesystem::path& modelPath,
+            const LodSettings& lodSettings) {
+        uint64_t sourceSize;
+        int64_t sourceTime;
+        std::error_code error;
+        if (!std::filesystem::exists(cachePath, error) || !readSource(modelPath, sourceSize, sourceTime)) return nullptr;
+        try {
+            auto cache = std::make_shared<MeshCache>(cachePath);
+            Header header = readHeader(cache->file);
+            if (header.sourceSize != sourceSize || header.sourceTime != sourceTime || header.settingsHash != hashSettings(lodSettings)) return nullptr;
+            if (!sourcesUnchanged(readSection<std::byte>(cache->file, header, SECTION_SOURCES), modelPath.parent_path())) return nullptr;
+            return cache;
+        } catch (const std::runtime_error&) {
+            // rebuilt like a missing cache
+            return nullptr;
+        }
+    }
+
+    std::filesystem::path meshCachePath(const std::filesystem::path& modelPath) {
+        std::filesystem::path cachePath = modelPath;
+        cachePath += ".vmesh";
+        return cachePath;
+    }
+
+    void writeMeshCache(const std::filesystem::path& cachePath, const std::filesystem::path& modelPath, std::span<const std::string> bufferUris,
+            const LodSettings& lodSettings, const MeshCacheData& data) {
+        Header header;
+        if (!readSource(modelPath, header.sourceSize, header.sourceTime)) {
+            throw std::runtime_error("failed to read model file attributes!");
+        }
+        header.settingsHash = hashSettings(lodSettings);
+        std::vector<std::byte> sourceBytes;
+        for (const std::string& uri : bufferUris) {
+            uint64_t size;
+            int64_t time;
+            if (!readSource(modelPath.parent_path() / uri, size, time)) {
+                throw std::runtime_error("failed to read model buffer attributes!");
+            }
+            uint32_t uriLength = static_cast<uint32_t>(uri.size());
+            size_t offset = sourceBytes.size();
+            sourceBytes.resize(offset + sizeof(size) + sizeof(time) + sizeof(uriLength) + uriLength);
+            std::byte* record = sourceBytes.data() + offset;
+            std::memcpy(record, &size, sizeof(size));
+            record += sizeof(size);
+            std::memcpy(record, &time, sizeof(time));
+            record += sizeof(time);
+            std::memcpy(record, &uriLength, sizeof(uriLength));
+            record += sizeof(uriLength);
+            std::memcpy(record, uri.data(), uriLength);
+        }
+        std::vector<std::byte> textureBytes;
+        for (const CachedTexture& texture : data.textures) {
+            uint32_t uriLength = static_cast<uint32_t>(texture.uri.size());
+            uint32_t encodedLength = static_cast<uint32_t>(texture.encoded.size());
+            size_t offset = textureBytes.size();
+            textureBytes.resize(offset + sizeof(texture.image) + sizeof(uriLength) + sizeof(encodedLength) + uriLength + encodedLength);
+            std::byte* record = textureBytes.data() + offset;
+            std::memcpy(record, &texture.image, sizeof(texture.image));
+            record += sizeof(texture.image);
+            std::memcpy(record, &uriLength, sizeof(uriLength));
+            record += sizeof(uriLength);
+            std::memcpy(record, &encodedLength, sizeof(encodedLength));
+            record += sizeof(encodedLength);
+            std::memcpy(record, texture.uri.data(), uriLength);
+            if (encodedLength > 0) std::memcpy(record + uriLength, texture.encoded.data(), encodedLength);
+        }
+        std::array<std::span<const std::byte>, SECTION_COUNT> sections{
+            std::as_bytes(data.positions),
+            std::as_bytes(data.attributes),
+            std::as_bytes(data.indices),
+            std::as_bytes(data.meshlets),
+            std::as_bytes(data.nodes),
+            std::as_bytes(data.submeshes),
+            std::as_bytes(data.lods),
+            std::as_bytes(data.materials),
+            std::span<const std::byte>(textureBytes),
+            std::span<const std::byte>(sourceBytes),
+        };
+        uint64_t offset = sizeof(Header);
+        for (size_t i = 0; i < SECTION_COUNT; i++) {
+            offset = (offset + SECTION_ALIGNMENT - 1) / SECTION_ALIGNMENT * SECTION_ALIGNMENT;
+            header.sections[i] = {.offset = offset, .size = sections[i].size()};
+            offset += sections[i].size();
+        }
+
+        std::filesystem::path temporaryPath = cachePath;
+        temporaryPath += ".tmp";
+        std::ofstream out(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            throw std::runtime_error("failed to open mesh cache for writing!");
+        }
+        try {
+            out.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+            const char zeros[SECTION_ALIGNMENT] = {};
+            uint64_t written = sizeof(Header);
+            for (size_t i = 0; i < SECTION_COUNT; i++) {
+                out.write(zeros, static_cast<std::streamsize>(header.sections[i].offset - written));
+                out.write(reinterpret_cast<const char*>(sections[i].data()), static_cast<std::streamsize>(sections[i].size()));
+                written = header.sections[i].offset + sections[i].size();
+            }
+            out.close();
+            if (!out) {
+                throw std::runtime_error("failed to write mesh cache!");
+            }
+            std::filesystem::rename(temporaryPath, cachePath);
+        } catch (...) {
+            std::error_code error;
+            std::filesystem::remove(temporaryPath, error);
+            throw;
+        }
+    }
+}
@@ -0,0 +1,246 @@
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <mesh_optimizer.hpp>
+
+namespace volchara {
+    namespace {
+        struct CacheCounts {
+            size_t misses = 0;
+            size_t triangles = 0;
+            size_t vertices = 0;
+        };
+
+        // a FIFO cache kept as the miss count at which every vertex last entered it
+        CacheCounts countCacheMisses(std::span<const uint32_t> indices, uint32_t cacheSize) {
+            CacheCounts counts{.triangles = indices.size() / 3};
+            if (indices.empty()) return counts;
+            uint32_t maxIndex = *std::max_element(indices.begin(), indices.end());
+            std::vector<size_t> entered(static_cast<size_t>(maxIndex) + 1, 0);
+            size_t time = cacheSize + 1;
+            for (uint32_t index : indices) {
+                if (time - entered[index] <= cacheSize) continue;
+                if (entered[index] == 0) counts.vertices++;
+                entered[index] = time++;
+                counts.misses++;
+            }
+            return counts;
+        }
+
+        VertexCacheStats toStats(const CacheCounts& counts) {
+            VertexCacheStats stats;
+            if (counts.triangles) stats.acmr = static_cast<float>(counts.misses) / counts.triangles;
+            if (counts.vertices) stats.atvr = static_cast<float>(counts.misses) / counts.vertices;
+            return stats;
+        }
+
+        CacheCounts countRanges(const std::vector<uint32_t>& indices, std::span<const IndexRange> ranges) {
+            CacheCounts total;
+            for (const IndexRange& range : ranges) {
+                CacheCounts counts = countCacheMisses(std::span(indices).subspan(range.first, range.count), VERTEX_CACHE_SIZE);
+                total.misses += counts.misses;
+                total.triangles += counts.triangles;
+                total.vertices += counts.vertices;
+            }
+            return total;
+        }
+
+        // Sander et al., "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw";
+        // vertices are numbered from 0, clusterStarts gets the triangles at which the cache was refilled
+        std::vector<uint32_t> tipsify(std::span<const uint32_t> indices, size_t vertexCount, uint32_t cacheSize, std::vector<size_t>& clusterStarts) {
+            size_t triangleCount = indices.size() / 3;
+            std::vector<uint32_t> liveTriangles(vertexCount, 0);
+            for (uint32_t index : indices) {
+                liveTriangles[index]++;
+            }
+            std::vector<size_t> adjacencyOffsets(vertexCount + 1, 0);
+            std::partial_sum(liveTriangles.begin(), liveTriangles.end(), adjacencyOffsets.begin() + 1);
+            std::vector<uint32_t> adjacency(indices.size());
+            std::vector<size_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+            for (size_t i = 0; i < indices.size(); i++) {
+                adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+            }
+
+            std::vector<uint8_t> emitted(triangleCount, 0);
+            std::vector<size_t> cacheTime(vertexCount, 0);
+            std::vector<uint32_t> deadEnds;
+            std::vector<uint32_t> candidates;
+            std::vector<uint32_t> order;
+            order.reserve(triangleCount);
+            size_t time = cacheSize + 1;
+            size_t cursor = 0;
+
+            auto skipDeadEnd = [&]() -> int64_t {
+                while (!deadEnds.empty()) {
+                    uint32_t vertex = deadEnds.back();
+                    deadEnds.pop_back();
+                    if (liveTriangles[vertex] > 0) return vertex;
+                }
+                for (; cursor < vertexCount; cursor++) {
+                    if (liveTriangles[cursor] > 0) return static_cast<int64_t>(cursor);
+                }
+                return -1;
+            };
+
+            clusterStarts.assign(1, 0);
+            int64_t fanning = skipDeadEnd();
+            while (fanning >= 0) {
+                candidates.clear();
+                for (size_t a = adjacencyOffsets[fanning]; a < adjacencyOffsets[fanning + 1]; a++) {
+                    uint32_t triangle = adjacency[a];
+                    if (emitted[triangle]) continue;
+                    for (size_t corner = 0; corner < 3; corner++) {
+                        uint32_t vertex = indices[triangle * 3 + corner];
+                        deadEnds.push_back(vertex);
+                        candidates.push_back(vertex);
+                        liveTriangles[vertex]--;
+                        if (time - cacheTime[vertex] > cacheSize) {
+                            cacheTime[vertex] = time++;
+                        }
+                    }
+                    emitted[triangle] = 1;
+                    order.push_back(triangle);
+                }
+
+                // prefers the candidate that entered the cache earliest and will still be in it after its fan
+                int64_t next = -1;
+                int64_t bestPriority = -1;
+                for (uint32_t vertex : candidates) {
+                    if (liveTriangles[vertex] == 0) continue;
+                    int64_t priority = 0;
+                    if (time - cacheTime[vertex] + 2 * liveTriangles[vertex] <= cacheSize) {
+                        priority = static_cast<int64_t>(time - cacheTime[vertex]);
+                    }
+                    if (priority > bestPriority) {
+                        bestPriority = priority;
+                        next = vertex;
+                    }
+                }
+                if (next < 0) {
+                    next = skipDeadEnd();
+                    if (next >= 0 && order.size() != clusterStarts.back()) clusterStarts.push_back(order.size());
+                }
+                fanning = next;
+            }
+            return order;
+        }
+
+        glm::vec3 readPosition(const float* positions, size_t stride, uint32_t vertex) {
+            const float* p = reinterpret_cast<const float*>(reinterpret_cast<const char*>(positions) + vertex * stride);
+            return glm::vec3(p[0], p[1], p[2]);
+        }
+
+        void optimizeRange(std::vector<uint32_t>& indices, const IndexRange& range, const float* positions, size_t positionStride) {
+            std::span<uint32_t> rangeIndices = std::span(indices).subspan(range.first, range.count - range.count % 3);
+            if (rangeIndices.size() < 6) return;
+            auto [minIt, maxIt] = std::minmax_element(rangeIndices.begin(), rangeIndices.end());
+            uint32_t baseVertex = *minIt;
+            std::vector<uint32_t> local(rangeIndices.begin(), rangeIndices.end());
+            for (uint32_t& index : local) {
+                index -= baseVertex;
+            }
+
+            std::vector<size_t> clusterStarts;
+            std::vector<uint32_t> order = tipsify(local, *maxIt - baseVertex + 1, VERTEX_CACHE_SIZE, clusterStarts);
+            clusterStarts.push_back(order.size());
+
+            // clusters facing away from the mesh's centre are likely to occlude the rest, so they are drawn first
+            struct Cluster {
+                size_t begin;
+                size_t end;
+                float occlusion = 0.0f;
+            };
+            std::vector<Cluster> clusters;
+            std::vector<glm::vec3> centroids;
+            std::vector<glm::vec3> normals;
+            glm::vec3 meshCentroid(0.0f);
+            float meshArea = 0.0f;
+            for (size_t c = 0; c + 1 < clusterStarts.size(); c++) {
+                glm::vec3 centroid(0.0f);
+                glm::vec3 normal(0.0f);
+                float area = 0.0f;
+                for (size_t t = clusterStarts[c]; t < clusterStarts[c + 1]; t++) {
+                    glm::vec3 a = readPosition(positions, positionStride, local[order[t] * 3 + 0] + baseVertex);
+                    glm::vec3 b = readPosition(positions, positionStride, local[order[t] * 3 + 1] + baseVertex);
+                    glm::vec3 v = readPosition(positions, positionStride, local[order[t] * 3 + 2] + baseVertex);
+                    glm::vec3 weightedNormal = glm::cross(b - a, v - a);
+                    float triangleArea = glm::length(weightedNormal);
+                    centroid += (a + b + v) / 3.0f * triangleArea;
+                    normal += weightedNormal;
+                    area += triangleArea;
+                }
+                meshCentroid += centroid;
+                meshArea += area;
+                centroids.push_back(area > 0.0f ? centroid / area : centroid);
+                normals.push_back(glm::length(normal) > 0.0f ? glm::normalize(normal) : normal);
+                clusters.push_back({.begin = clusterStarts[c], .end = clusterStarts[c + 1]});
+            }
+            if (meshArea > 0.0f) meshCentroid /= meshArea;
+            for (size_t c = 0; c < clusters.size(); c++) {
+                clusters[c].occlusion = glm::dot(centroids[c] - meshCentroid, normals[c]);
+            }
+            std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b) {
+                return a.occlusion > b.occlusion;
+            });
+
+            size_t out = 0;
+            for (const Cluster& cluster : clusters) {
+                for (size_t t = cluster.begin; t < cluster.end; t++) {
+                    for (size_t corner = 0; corner < 3; corner++) {
+                        rangeIndices[out++] = local[order[t] * 3 + corner] + baseVertex;
+                    }
+                }
+            }
+        }
+    }
+
+    VertexCacheStats analyzeVertexCache(std::span<const uint32_t> indices, uint32_t cacheSize) {
+        return toStats(countCacheMisses(indices, cacheSize));
+    }
+
+    MeshOptimizationReport optimizeIndexRanges(std::vector<uint32_t>& indices, std::span<const IndexRange> ranges,
+            const float* positions, size_t positionStride, size_t vertexCount) {
+        // everything is checked before the first range is counted or reordered
+        for (const IndexRange& range : ranges) {
+            if (static_cast<size_t>(range.first) + range.count > indices.size()) {
+                throw std::runtime_error("index range is out of bounds!");
+            }
+            for (uint32_t i = range.first; i < range.first + range.count; i++) {
+                if (indices[i] >= vertexCount) {
+                    throw std::runtime_error("index refers to a nonexistent vertex!");
+                }
+            }
+        }
+        MeshOptimizationReport report;
+        report.before = toStats(countRanges(indices, ranges));
+        for (const IndexRange& range : ranges) {
+            optimizeRange(indices, range, positions, positionStride);
+        }
+        report.after = toStats(countRanges(indices, ranges));
+        return report;
+    }
+
+    std::vector<uint32_t> optimizeVertexFetch(std::vector<uint32_t>& indices, size_t vertexCount) {
+        const uint32_t unused = std::numeric_limits<uint32_t>::max();
+        std::vector<uint32_t> remap(vertexCount, unused);
+        std::vector<uint32_t> oldIndices;
+        oldIndices.reserve(vertexCount);
+        for (uint32_t& index : indices) {
+            if (index >= vertexCount) {
+                throw std::runtime_error("index refers to a nonexistent vertex!");
+            }
+            if (remap[index] == unused) {
+                remap[index] = static_cast<uint32_t>(oldIndices.size());
+                oldIndices.push_back(index);
+            }
+            index = remap[index];
+        }
+        return oldIndices;
+    }
+}
@@ -0,0 +1,240 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <queue>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <mesh_simplifier.hpp>
+
+namespace volchara {
+    namespace {
+        // the upper triangle of a symmetric 4x4 matrix summing area-weighted squared distances to planes
+        struct Quadric {
+            double a00 = 0, a01 = 0, a02 = 0, a11 = 0, a12 = 0, a22 = 0;
+            double b0 = 0, b1 = 0, b2 = 0;
+            double c = 0;
+            double weight = 0;
+
+            static Quadric fromPlane(glm::vec3 normal, float distance, float weight) {
+                double x = normal.x, y = normal.y, z = normal.z, d = distance, w = weight;
+                return {
+                    .a00 = w * x * x, .a01 = w * x * y, .a02 = w * x * z, .a11 = w * y * y, .a12 = w * y * z, .a22 = w * z * z,
+                    .b0 = w * x * d, .b1 = w * y * d, .b2 = w * z * d,
+                    .c = w * d * d,
+                    .weight = w,
+                };
+            }
+
+            Quadric& operator+=(const Quadric& other) {
+                a00 += other.a00; a01 += other.a01; a02 += other.a02; a11 += other.a11; a12 += other.a12; a22 += other.a22;
+                b0 += other.b0; b1 += other.b1; b2 += other.b2;
+                c += other.c;
+                weight += other.weight;
+                return *this;
+            }
+
+            // the mean squared distance of p to the summed planes
+            double error(glm::vec3 p) const {
+                if (weight <= 0) return 0;
+                double x = p.x, y = p.y, z = p.z;
+                double e = a00 * x * x + a11 * y * y + a22 * z * z + 2 * (a01 * x * y + a02 * x * z + a12 * y * z)
+                    + 2 * (b0 * x + b1 * y + b2 * z) + c;
+                return std::max(e, 0.0) / weight;
+            }
+        };
+
+        struct Collapse {
+            double cost;
+            uint32_t from;
+            uint32_t to;
+
+            bool operator>(const Collapse& other) const { return cost > other.cost; }
+        };
+
+        uint64_t edgeKey(uint32_t a, uint32_t b) {
+            return (static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b);
+        }
+
+        // vertices sharing a position with another vertex, i.e. sitting on an attribute seam
+        std::vector<uint8_t> findSeams(const std::vector<glm::vec3>& positions) {
+            std::vector<uint32_t> order(positions.size());
+            for (uint32_t i = 0; i < order.size(); i++) {
+                order[i] = i;
+            }
+            auto bits = [&](uint32_t v) {
+                return std::array{std::bit_cast<uint32_t>(positions[v].x + 0.0f), std::bit_cast<uint32_t>(positions[v].y + 0.0f), std::bit_cast<uint32_t>(positions[v].z + 0.0f)};
+            };
+            std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return bits(a) < bits(b); });
+            std::vector<uint8_t> seams(positions.size(), 0);
+            for (size_t i = 1; i < order.size(); i++) {
+                if (bits(order[i]) == bits(order[i - 1])) {
+                    seams[order[i]] = 1;
+                    seams[order[i - 1]] = 1;
+                }
+            }
+            return seams;
+        }
+    }
+
+    std::vector<uint32_t> simplifyMesh(std::span<const uint32_t> indices, const float* positions, size_t positionStride, size_t vertexCount,
+            size_t targetIndexCount, float maxError, float* resultError) {
+        if (resultError) *resultError = 0.0f;
+        std::vector<uint32_t> triangles(indices.begin(), indices.end() - indices.size() % 3);
+        size_t triangleCount = triangles.size() / 3;
+        for (uint32_t index : triangles) {
+            if (index >= vertexCount) {
+                throw std::runtime_error("index refers to a nonexistent vertex!");
+            }
+        }
+        std::vector<glm::vec3> points(vertexCount);
+        for (size_t v = 0; v < vertexCount; v++) {
+            const float* p = reinterpret_cast<const float*>(reinterpret_cast<const char*>(positions) + v * positionStride);
+            points[v] = glm::vec3(p[0], p[1], p[2]);
+        }
+
+        std::vector<uint8_t> locked = findSeams(points);
+        std::unordered_map<uint64_t, uint32_t> edgeUses;
+        for (size_t t = 0; t < triangleCount; t++) {
+            for (size_t corner = 0; corner < 3; corner++) {
+                edgeUses[edgeKey(triangles[t * 3 + corner], triangles[t * 3 + (corner + 1) % 3])]++;
+            }
+        }
+        for (auto [key, uses] : edgeUses) {
+            if (uses == 1) {
+                locked[key >> 32] = 1;
+                locked[key & 0xffffffffu] = 1;
+            }
+        }
+
+        std::vector<Quadric> quadrics(vertexCount);
+        std::vector<std::vector<uint32_t>> adjacency(vertexCount);
+        for (uint32_t t = 0; t < triangleCount; t++) {
+            glm::vec3 a = points[triangles[t * 3]], b = points[triangles[t * 3 + 1]], c = points[triangles[t * 3 + 2]];
+            glm::vec3 cross = glm::cross(b - a, c - a);
+            float area = glm::length(cross);
+            if (area > 0.0f) {
+                glm::vec3 normal = cross / area;
+                Quadric plane = Quadric::fromPlane(normal, -glm::dot(normal, a), area);
+                for (size_t corner = 0; corner < 3; corner++) {
+                    quadrics[triangles[t * 3 + corner]] += plane;
+                }
+            }
+            for (size_t corner = 0; corner < 3; corner++) {
+                adjacency[triangles[t * 3 + corner]].push_back(t);
+            }
+        }
+
+        std::vector<uint8_t> alive(triangleCount, 1);
+        std::vector<uint8_t> removed(vertexCount, 0);
+        size_t aliveCount = triangleCount;
+        auto collapseCost = [&](uint32_t from, uint32_t to) {
+            Quadric q = quadrics[from];
+            q += quadrics[to];
+            return q.error(points[to]);
+        };
+        std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> queue;
+        auto pushEdges = [&](uint32_t v) {
+            for (uint32_t t : adjacency[v]) {
+                if (!alive[t]) continue;
+                for (size_t corner = 0; corner < 3; corner++) {
+                    uint32_t w = triangles[t * 3 + corner];
+                    if (w == v) continue;
+                    if (!locked[w]) queue.push({collapseCost(w, v), w, v});
+                    if (!locked[v]) queue.push({collapseCost(v, w), v, w});
+                }
+            }
+        };
+        for (uint32_t v = 0; v < vertexCount; v++) {
+            if (!locked[v]) pushEdges(v);
+        }
+
+        // rejects collapses that flip a remaining triangle or join two vertices with more than two common neighbours
+        std::vector<uint32_t> neighbourMarks(vertexCount, 0);
+        uint32_t mark = 0;
+        auto isValid = [&](uint32_t from, uint32_t to) {
+            mark++;
+            for (uint32_t t : adjacency[to]) {
+                if (!alive[t]) continue;
+                for (size_t corner = 0; corner < 3; corner++) {
+                    neighbourMarks[triangles[t * 3 + corner]] = mark;
+                }
+            }
+            uint32_t shared = 0;
+            for (uint32_t t : adjacency[from]) {
+                if (!alive[t]) continue;
+                bool hasTo = false;
+                for (size_t corner = 0; corner < 3; corner++) {
+                    uint32_t w = triangles[t * 3 + corner];
+                    hasTo |= w == to;
+                    if (w != from && w != to && neighbourMarks[w] == mark) {
+                        shared++;
+                        neighbourMarks[w] = 0;
+                    }
+                }
+                if (hasTo) continue;
+                glm::vec3 before[3];
+                glm::vec3 after[3];
+                for (size_t corner = 0; corner < 3; corner++) {
+                    uint32_t w = triangles[t * 3 + corner];
+                    before[corner] = points[w];
+                    after[corner] = w == from ? points[to] : points[w];
+                }
+                glm::vec3 oldNormal = glm::cross(before[1] - before[0], before[2] - before[0]);
+                glm::vec3 newNormal = glm::cross(after[1] - after[0], after[2] - after[0]);
+                if (glm::dot(oldNormal, newNormal) <= 0.0f) return false;
+            }
+            return shared <= 2;
+        };
+
+        double maxCost = static_cast<double>(maxError) * maxError;
+        double acceptedCost = 0;
+        while (aliveCount * 3 > targetIndexCount && !queue.empty()) {
+            Collapse collapse = queue.top();
+            queue.pop();
+            if (removed[collapse.from] || removed[collapse.to]) continue;
+            // a neighbouring collapse may have changed the cost either way, as it is normalized by the summed weight,
+            // so a stale entry goes back with the current one and is taken in order
+            double cost = collapseCost(collapse.from, collapse.to);
+            if (cost != collapse.cost) {
+                queue.push({cost, collapse.from, collapse.to});
+                continue;
+            }
+            if (cost > maxCost) break;
+            if (!isValid(collapse.from, collapse.to)) continue;
+
+            for (uint32_t t : adjacency[collapse.from]) {
+                if (!alive[t]) continue;
+                uint32_t* corners = &triangles[t * 3];
+                if (corners[0] == collapse.to || corners[1] == collapse.to || corners[2] == collapse.to) {
+                    alive[t] = 0;
+                    aliveCount--;
+                    continue;
+                }
+                for (size_t corner = 0; corner < 3; corner++) {
+                    if (corners[corner] == collapse.from) corners[corner] = collapse.to;
+                }
+                adjacency[collapse.to].push_back(t);
+            }
+            std::vector<uint32_t>().swap(adjacency[collapse.from]);
+            quadrics[collapse.to] += quadrics[collapse.from];
+            removed[collapse.from] = 1;
+            acceptedCost = std::max(acceptedCost, cost);
+            pushEdges(collapse.to);
+        }
+
+        std::vector<uint32_t> result;
+        result.reserve(aliveCount * 3);
+        for (size_t t = 0; t < triangleCount; t++) {
+            if (!alive[t]) continue;
+            result.insert(result.end(), triangles.begin() + t * 3, triangles.begin() + t * 3 + 3);
+        }
+        if (resultError) *resultError = static_cast<float>(std::sqrt(acceptedCost));
+        return result;
+    }
+}
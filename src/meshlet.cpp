@@ -0,0 +1,113 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <meshlet.hpp>
+
+namespace volchara {
+    namespace {
+        glm::vec3 readPosition(const float* positions, size_t stride, uint32_t vertex) {
+            const float* p = reinterpret_cast<const float*>(reinterpret_cast<const char*>(positions) + vertex * stride);
+            return glm::vec3(p[0], p[1], p[2]);
+        }
+
+        void computeBounds(Meshlet& meshlet, const std::vector<uint32_t>& indices, const float* positions, size_t positionStride) {
+            glm::vec3 low(std::numeric_limits<float>::max());
+            glm::vec3 high(std::numeric_limits<float>::lowest());
+            for (uint32_t i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.indexCount; i++) {
+                glm::vec3 p = readPosition(positions, positionStride, indices[i]);
+                low = glm::min(low, p);
+                high = glm::max(high, p);
+            }
+            glm::vec3 center = (low + high) / 2.0f;
+
+            glm::vec3 normalSum(0.0f);
+            std::vector<glm::vec3> normals;
+            for (uint32_t i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.indexCount; i += 3) {
+                glm::vec3 a = readPosition(positions, positionStride, indices[i]);
+                glm::vec3 b = readPosition(positions, positionStride, indices[i + 1]);
+                glm::vec3 c = readPosition(positions, positionStride, indices[i + 2]);
+                meshlet.radius = std::max({meshlet.radius, glm::length(a - center), glm::length(b - center), glm::length(c - center)});
+                glm::vec3 cross = glm::cross(b - a, c - a);
+                float area = glm::length(cross);
+                if (area == 0.0f) continue;
+                normals.push_back(cross / area);
+                normalSum += normals.back();
+            }
+
+            meshlet.center[0] = center.x;
+            meshlet.center[1] = center.y;
+            meshlet.center[2] = center.z;
+
+            // the cone stays open (cutoff 1, never culled) when the triangles face too many ways to bound
+            float sumLength = glm::length(normalSum);
+            if (normals.empty() || sumLength == 0.0f) return;
+            glm::vec3 axis = normalSum / sumLength;
+            float minDot = 1.0f;
+            for (const glm::vec3& normal : normals) {
+                minDot = std::min(minDot, glm::dot(normal, axis));
+            }
+            meshlet.coneAxis[0] = axis.x;
+            meshlet.coneAxis[1] = axis.y;
+            meshlet.coneAxis[2] = axis.z;
+            if (minDot <= 0.1f) return;
+            meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+        }
+    }
+
+    std::vector<Meshlet> buildMeshlets(const std::vector<uint32_t>& indices, const IndexRange& range,
+            const float* positions, size_t positionStride, size_t vertexCount) {
+        if (range.first + range.count > indices.size()) {
+            throw std::runtime_error("index range is out of bounds!");
+        }
+        std::vector<Meshlet> meshlets;
+        // the meshlet a vertex was last counted in, numbered from 1
+        std::vector<uint32_t> lastMeshlet(vertexCount, 0);
+        uint32_t meshletNumber = 1;
+        Meshlet current{.firstIndex = range.first};
+        uint32_t uniqueVertices = 0;
+        uint32_t end = range.first + range.count - range.count % 3;
+        // vertices of triangle i not yet in the current meshlet; a triangle repeating a vertex counts it once
+        auto countNewVertices = [&](uint32_t i) {
+            uint32_t count = 0;
+            for (uint32_t corner = 0; corner < 3; corner++) {
+                uint32_t vertex = indices[i + corner];
+                if (lastMeshlet[vertex] != meshletNumber && (corner < 1 || vertex != indices[i]) && (corner < 2 || vertex != indices[i + 1])) {
+                    count++;
+                }
+            }
+            return count;
+        };
+        for (uint32_t i = range.first; i < end; i++) {
+            if (indices[i] >= vertexCount) {
+                throw std::runtime_error("index refers to a nonexistent vertex!");
+            }
+        }
+        for (uint32_t i = range.first; i < end; i += 3) {
+            uint32_t newVertices = countNewVertices(i);
+            if (uniqueVertices + newVertices > MAX_MESHLET_VERTICES || current.indexCount / 3 == MAX_MESHLET_TRIANGLES) {
+                meshlets.push_back(current);
+                current = {.firstIndex = i};
+                uniqueVertices = 0;
+                meshletNumber++;
+                newVertices = countNewVertices(i);
+            }
+            for (uint32_t corner = 0; corner < 3; corner++) {
+                lastMeshlet[indices[i + corner]] = meshletNumber;
+            }
+            uniqueVertices += newVertices;
+            current.indexCount += 3;
+        }
+        if (current.indexCount > 0) meshlets.push_back(current);
+
+        for (Meshlet& meshlet : meshlets) {
+            computeBounds(meshlet, indices, positions, positionStride);
+        }
+        return meshlets;
+    }
+}
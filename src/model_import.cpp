@@ -0,0 +1,402 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtx/quaternion.hpp>
+#include <glm/gtx/matrix_decompose.hpp>
+#include <stb_image.h>
+#include <tiny_gltf.h>
+
+#include <gltf_accessor.hpp>
+#include <mapped_file.hpp>
+#include <model_import.hpp>
+#include <vertex_weld.hpp>
+
+namespace volchara {
+    namespace {
+        // what imported models are simplified with; part of the mesh cache's key
+        const LodSettings IMPORT_LOD_SETTINGS{};
+
+        TransformState nodeTransformState(const tinygltf::Node& node) {
+            TransformState state;
+            if (node.matrix.size() == 16) {
+                glm::mat4 matrix;
+                for (int i = 0; i < 16; i++) {
+                    matrix[i / 4][i % 4] = static_cast<float>(node.matrix[i]);
+                }
+                glm::vec3 skew;
+                glm::vec4 perspective;
+                glm::decompose(matrix, state.scaling, state.rotationQuat, state.translation, skew, perspective);
+                return state;
+            }
+            if (node.translation.size() == 3) {
+                state.translation = glm::vec3(node.translation[0], node.translation[1], node.translation[2]);
+            }
+            if (node.rotation.size() == 4) {
+                state.rotationQuat = glm::quat(static_cast<float>(node.rotation[3]), static_cast<float>(node.rotation[0]), static_cast<float>(node.rotation[1]), static_cast<float>(node.rotation[2]));
+            }
+            if (node.scale.size() == 3) {
+                state.scaling = glm::vec3(node.scale[0], node.scale[1], node.scale[2]);
+            }
+            return state;
+        }
+
+        void writeModelCache(const ImportedModel& imported, const std::filesystem::path& cachePath, const std::filesystem::path& modelPath,
+                std::span<const std::string> bufferUris, std::span<const CachedTexture> textures) {
+            std::vector<CachedNode> nodes;
+            for (size_t i = 0; i < imported.nodes.size(); i++) {
+                const TransformState& state = imported.nodes[i];
+                nodes.push_back({
+                    .translation = {state.translation.x, state.translation.y, state.translation.z},
+                    .scaling = {state.scaling.x, state.scaling.y, state.scaling.z},
+                    .rotation = {state.rotationQuat.x, state.rotationQuat.y, state.rotationQuat.z, state.rotationQuat.w},
+                    .parent = imported.nodeParents[i],
+                });
+            }
+            std::vector<CachedLodChain> lods;
+            for (const LodChain& chain : imported.lods) {
+                CachedLodChain cached{
+                    .levelCount = chain.levelCount,
+                    .center = {chain.center.x, chain.center.y, chain.center.z},
+                    .radius = chain.radius,
+                };
+                std::copy(chain.levels.begin(), chain.levels.end(), cached.levels);
+                lods.push_back(cached);
+            }
+            // external images are read again on load, so changes to them show up without rebuilding the cache
+            std::vector<CachedTexture> cachedTextures;
+            for (const CachedTexture& texture : textures) {
+                cachedTextures.push_back({
+                    .image = texture.image,
+                    .uri = texture.uri,
+                    .encoded = texture.uri.empty() ? texture.encoded : std::span<const std::byte>(),
+                });
+            }
+            writeMeshCache(cachePath, modelPath, bufferUris, IMPORT_LOD_SETTINGS, {
+                .positions = imported.positions,
+                .attributes = imported.attributes,
+                .indices = imported.indices,
+                .meshlets = imported.meshlets,
+                .nodes = nodes,
+                .submeshes = imported.submeshes,
+                .lods = lods,
+                .materials = imported.materials,
+                .textures = cachedTextures,
+            });
+        }
+
+        // embedded images from their bytes, the others from their file next to the model
+        std::map<int32_t, DecodedImage> decodeImages(std::span<const CachedTexture> textures, const std::filesystem::path& modelPath, JobSystem* jobs) {
+            std::vector<DecodedImage> decoded(textures.size());
+            auto decode = [&](size_t i) {
+                decoded[i] = textures[i].encoded.empty()
+                    ? decodeImageFile(modelPath.parent_path() / textures[i].uri)
+                    : decodeImage(textures[i].encoded);
+            };
+            if (jobs) {
+                jobs->parallelFor(textures.size(), decode);
+            }
+            else {
+                for (size_t i = 0; i < textures.size(); i++) decode(i);
+            }
+            std::map<int32_t, DecodedImage> images;
+            for (size_t i = 0; i < textures.size(); i++) {
+                images[textures[i].image] = std::move(decoded[i]);
+            }
+            return images;
+        }
+
+        ImportedModel importCache(const std::filesystem::path& modelPath, std::shared_ptr<const MeshCache> cache, JobSystem* jobs) {
+            const MeshCacheData& data = cache->data;
+            ImportedModel imported;
+            for (const CachedNode& node : data.nodes) {
+                if (node.parent >= static_cast<int32_t>(data.nodes.size())) {
+                    throw std::runtime_error("mesh cache refers to a nonexistent node!");
+                }
+                imported.nodes.push_back({
+                    .translation = glm::vec3(node.translation[0], node.translation[1], node.translation[2]),
+                    .scaling = glm::vec3(node.scaling[0], node.scaling[1], node.scaling[2]),
+                    .rotationQuat = glm::quat(node.rotation[3], node.rotation[0], node.rotation[1], node.rotation[2]),
+                });
+                imported.nodeParents.push_back(node.parent);
+            }
+            imported.submeshes.assign(data.submeshes.begin(), data.submeshes.end());
+            for (const CachedLodChain& cached : data.lods) {
+                LodChain chain;
+                std::copy(std::begin(cached.levels), std::end(cached.levels), chain.levels.begin());
+                chain.levelCount = cached.levelCount;
+                chain.center = glm::vec3(cached.center[0], cached.center[1], cached.center[2]);
+                chain.radius = cached.radius;
+                imported.lods.push_back(chain);
+            }
+            for (const Submesh& submesh : imported.submeshes) {
+                if (submesh.node >= imported.nodes.size()) {
+                    throw std::runtime_error("mesh cache refers to a nonexistent node!");
+                }
+                if (submesh.material >= data.materials.size()) {
+                    throw std::runtime_error("mesh cache refers to a nonexistent material!");
+                }
+            }
+            imported.materials.assign(data.materials.begin(), data.materials.end());
+            imported.images = decodeImages(data.textures, modelPath, jobs);
+            imported.meshCache = std::move(cache);
+            return imported;
+        }
+    }
+
+    DecodedImage decodeImage(std::span<const std::byte> encoded) {
+        int width, height, channels;
+        stbi_uc* pixels = stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(encoded.data()), static_cast<int>(encoded.size()), &width, &height, &channels, STBI_rgb_alpha);
+        if (!pixels) {
+            throw std::runtime_error("couldn't load texture image");
+        }
+        return {
+            .width = static_cast<uint32_t>(width),
+            .height = static_cast<uint32_t>(height),
+            .pixels = std::shared_ptr<unsigned char>(pixels, stbi_image_free),
+        };
+    }
+
+    DecodedImage decodeImageFile(const std::filesystem::path& path) {
+        MappedFile file(path);
+        return decodeImage(std::span(file.data(), file.size()));
+    }
+
+    namespace {
+        // parses and preprocesses the model and writes its cache; a conversion skips decoding the images, and fails
+        // when the cache can't be written instead of carrying on without it
+        ImportedModel parseGLTFModel(const std::filesystem::path& modelPath, JobSystem* jobs, bool convertOnly) {
+            tinygltf::TinyGLTF gltfLoader;
+            // images stay encoded, and are decoded once on upload
+            gltfLoader.SetImagesAsIs(true);
+            tinygltf::Model model;
+            std::string err;
+            std::string warn;
+            std::u8string unicodePathTmp = modelPath.u8string();
+            std::string unicodePath(unicodePathTmp.begin(), unicodePathTmp.end());
+            bool res;
+            if (modelPath.extension().string() == ".gltf") {
+                res = gltfLoader.LoadASCIIFromFile(&model, &err, &warn, unicodePath);
+            }
+            else if (modelPath.extension().string() == ".glb") {
+                // parsed from the mapping, so the file isn't read into memory before tinygltf copies its buffers out
+                MappedFile glb(modelPath);
+                if (glb.size() > std::numeric_limits<unsigned int>::max()) {
+                    throw std::runtime_error("failed to load gltf: file too large");
+                }
+                std::u8string baseDirTmp = modelPath.parent_path().u8string();
+                res = gltfLoader.LoadBinaryFromMemory(&model, &err, &warn, reinterpret_cast<const unsigned char*>(glb.data()),
+                    static_cast<unsigned int>(glb.size()), std::string(baseDirTmp.begin(), baseDirTmp.end()));
+            }
+            else {
+                throw std::runtime_error(std::string("failed to load gltf: unknown extension ") + modelPath.extension().string());
+            }
+            if (!res || !err.empty()) {
+                throw std::runtime_error("failed to load gltf: " + err);
+            }
+            // the model's materials, then one for primitives without a material
+            std::vector<CachedMaterial> materials;
+            std::vector<bool> usedImages(model.images.size(), false);
+            for (const tinygltf::Material& material : model.materials) {
+                const tinygltf::PbrMetallicRoughness& pbr = material.pbrMetallicRoughness;
+                CachedMaterial cached;
+                for (size_t i = 0; i < 3 && i < pbr.baseColorFactor.size(); i++) {
+                    cached.color[i] = static_cast<float>(pbr.baseColorFactor[i]);
+                }
+                int texture = pbr.baseColorTexture.index;
+                if (texture >= 0 && static_cast<size_t>(texture) < model.textures.size()) {
+                    int image = model.textures[texture].source;
+                    if (image >= 0 && static_cast<size_t>(image) < model.images.size()) {
+                        cached.image = image;
+                        usedImages[image] = true;
+                    }
+                }
+                materials.push_back(cached);
+            }
+            uint32_t defaultMaterial = static_cast<uint32_t>(materials.size());
+            materials.push_back({});
+            // only images some material samples are loaded
+            std::vector<CachedTexture> textures;
+            for (size_t image = 0; image < model.images.size(); image++) {
+                if (!usedImages[image]) continue;
+                textures.push_back({
+                    .image = static_cast<int32_t>(image),
+                    .uri = model.images[image].uri,
+                    .encoded = std::as_bytes(std::span(model.images[image].image)),
+                });
+            }
+            // read straight into the GPU layout
+            std::vector<PositionStream> resPositions;
+            std::vector<AttributeStream> resAttributes;
+            std::vector<uint32_t> resIndices;
+            std::vector<TransformState> nodes;
+            std::vector<int> nodeParents;
+            std::vector<Submesh> submeshes;
+            // primitives are optimized one by one, so submesh ranges stay valid
+            std::vector<IndexRange> primitiveRanges;
+            // a range per primitive by glTF mesh, shared by every node that uses the mesh
+            std::map<int, std::vector<Submesh>> meshRanges;
+            tinygltf::Scene& defScene = model.scenes[std::max(model.defaultScene, 0)];
+            // (glTF node, parent in nodes)
+            std::vector<std::pair<int, int>> pending;
+            for (int root : defScene.nodes) {
+                pending.push_back({root, -1});
+            }
+            while (!pending.empty()) {
+                auto [node_id, parentNode] = pending.back();
+                pending.pop_back();
+                tinygltf::Node& node = model.nodes[node_id];
+                int localNode = static_cast<int>(nodes.size());
+                nodes.push_back(nodeTransformState(node));
+                nodeParents.push_back(parentNode);
+                for (int child : node.children) {
+                    pending.push_back({child, localNode});
+                }
+                if (node.mesh < 0) {
+                    continue;
+                }
+
+                auto meshRange = meshRanges.find(node.mesh);
+                if (meshRange == meshRanges.end()) {
+                    std::vector<Submesh> ranges;
+                    tinygltf::Mesh& mesh = model.meshes[node.mesh];
+                    for (const tinygltf::Primitive& prim : mesh.primitives) {
+                        uint32_t primitiveFirst = static_cast<uint32_t>(resIndices.size());
+                        if (prim.mode != TINYGLTF_MODE_TRIANGLES && prim.mode != 0) {
+                            throw std::runtime_error("failed to load gltf: currently only triangle load available");
+                        }
+
+                        auto iterPosition = prim.attributes.find("POSITION");
+                        if (iterPosition == prim.attributes.end()) {
+                            continue;
+                        }
+                        AccessorView positions(model, iterPosition->second);
+                        if (positions.componentCount() != 3) {
+                            throw std::runtime_error("failed to load gltf: position not vec3");
+                        }
+                        // missing normals and texture coordinates stay zero
+                        std::optional<AccessorView> normals;
+                        auto iterNormal = prim.attributes.find("NORMAL");
+                        if (iterNormal != prim.attributes.end()) {
+                            normals.emplace(model, iterNormal->second);
+                            if (normals->componentCount() != 3 || normals->count() != positions.count()) {
+                                throw std::runtime_error("failed to load gltf: normal not vec3 per position");
+                            }
+                        }
+                        std::optional<AccessorView> texCoords;
+                        auto iterTexCoord = prim.attributes.find("TEXCOORD_0");
+                        if (iterTexCoord != prim.attributes.end()) {
+                            texCoords.emplace(model, iterTexCoord->second);
+                            if (texCoords->componentCount() != 2 || texCoords->count() != positions.count()) {
+                                throw std::runtime_error("failed to load gltf: uv not vec2 per position");
+                            }
+                        }
+
+                        uint32_t primitiveVertex = static_cast<uint32_t>(resPositions.size());
+                        resPositions.resize(primitiveVertex + positions.count());
+                        resAttributes.reserve(resPositions.size());
+                        for (size_t i = 0; i < positions.count(); i++) {
+                            positions.readFloats(i, resPositions[primitiveVertex + i].pos, 3);
+                            float normal[3] = {0.0f, 0.0f, 0.0f};
+                            float texCoord[2] = {0.0f, 0.0f};
+                            if (normals) normals->readFloats(i, normal, 3);
+                            if (texCoords) texCoords->readFloats(i, texCoord, 2);
+                            resAttributes.push_back(packAttributes(glm::vec3(normal[0], normal[1], normal[2]), glm::vec2(texCoord[0], texCoord[1])));
+                        }
+
+                        if (prim.indices >= 0) {
+                            AccessorView indices(model, prim.indices);
+                            resIndices.reserve(resIndices.size() + indices.count());
+                            for (size_t i = 0; i < indices.count(); i++) {
+                                uint32_t index = indices.readIndex(i);
+                                if (index >= positions.count()) {
+                                    throw std::runtime_error("failed to load gltf: index refers to a nonexistent vertex");
+                                }
+                                resIndices.push_back(index + primitiveVertex);
+                            }
+                        }
+                        else {
+                            for (size_t i = 0; i < positions.count(); i++) {
+                                resIndices.push_back(primitiveVertex + static_cast<uint32_t>(i));
+                            }
+                        }
+                        primitiveRanges.push_back({.first = primitiveFirst, .count = static_cast<uint32_t>(resIndices.size()) - primitiveFirst});
+                        bool hasMaterial = prim.material >= 0 && static_cast<size_t>(prim.material) < model.materials.size();
+                        ranges.push_back({
+                            .firstIndex = primitiveFirst,
+                            .indexCount = primitiveRanges.back().count,
+                            .material = hasMaterial ? static_cast<uint32_t>(prim.material) : defaultMaterial,
+                        });
+                    }
+                    meshRange = meshRanges.emplace(node.mesh, std::move(ranges)).first;
+                }
+                for (Submesh submesh : meshRange->second) {
+                    submesh.node = static_cast<uint32_t>(localNode);
+                    submeshes.push_back(submesh);
+                }
+            }
+            // the cache is only valid as long as the buffer files are unchanged
+            std::vector<std::string> bufferUris;
+            for (const tinygltf::Buffer& buffer : model.buffers) {
+                if (!buffer.uri.empty() && !buffer.uri.starts_with("data:")) bufferUris.push_back(buffer.uri);
+            }
+            // everything is read out of the buffers by now; images were copied out by tinygltf
+            std::vector<tinygltf::Buffer>().swap(model.buffers);
+            // primitives repeat vertices at their seams
+            WeldedStreams welded = weldVertices(resPositions, resAttributes, jobs);
+            std::vector<PositionStream>().swap(resPositions);
+            std::vector<AttributeStream>().swap(resAttributes);
+            for (uint32_t& index : resIndices) {
+                index = welded.indices[index];
+            }
+            optimizeGeometry(welded.positions, welded.attributes, resIndices, primitiveRanges);
+            ImportedModel imported;
+            imported.positions = std::move(welded.positions);
+            imported.attributes = std::move(welded.attributes);
+            imported.indices = std::move(resIndices);
+            imported.nodes = std::move(nodes);
+            imported.nodeParents = std::move(nodeParents);
+            imported.submeshes = std::move(submeshes);
+            imported.lods = buildSubmeshLods(imported.positions, imported.indices, imported.submeshes, IMPORT_LOD_SETTINGS);
+            imported.meshlets = buildSubmeshMeshlets(imported.positions, imported.indices, imported.submeshes);
+            imported.materials = std::move(materials);
+            if (convertOnly) {
+                writeModelCache(imported, meshCachePath(modelPath), modelPath, bufferUris, textures);
+                return imported;
+            }
+            imported.images = decodeImages(textures, modelPath, jobs);
+            try {
+                writeModelCache(imported, meshCachePath(modelPath), modelPath, bufferUris, textures);
+            } catch (const std::exception& e) {
+                // the model still loads, just parsed again next time
+                std::cerr << "failed to write mesh cache: " << e.what() << std::endl;
+            }
+            return imported;
+        }
+    }
+
+    ImportedModel importGLTFModel(const std::filesystem::path& modelPath, JobSystem* jobs) {
+        // later launches map the preprocessed model instead of parsing it
+        if (std::shared_ptr<const MeshCache> cache = MeshCache::open(meshCachePath(modelPath), modelPath, IMPORT_LOD_SETTINGS)) {
+            return importCache(modelPath, std::move(cache), jobs);
+        }
+        return parseGLTFModel(modelPath, jobs, false);
+    }
+
+    void convertGLTFModel(const std::filesystem::path& modelPath, JobSystem* jobs) {
+        parseGLTFModel(modelPath, jobs, true);
+    }
+}
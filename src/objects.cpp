@@ -1,96 +1,153 @@
+#include <algorithm>
 #include <array>
+#include <cstddef>
 #include <filesystem>
+#include <iostream>
+#include <limits>
+#include <map>
 #include <numeric>
-#include <set>
-#include <unordered_map>
+#include <optional>
+#include <span>
+#include <utility>
 #include <vector>
 
 #include <vulkan/vulkan_raii.hpp>
 #include <glm/glm.hpp>
 #include <glm/gtx/transform.hpp>
 #include <glm/gtx/quaternion.hpp>
-#include <glm/gtx/hash.hpp>
-#include <stb_image.h>
-#include <tiny_gltf.h>
 
+#include <mesh_cache.hpp>
+#include <mesh_optimizer.hpp>
+#include <model_import.hpp>
 #include <objects.hpp>
 #include <renderer.hpp>
+#include <vertex_weld.hpp>
 
 
 namespace volchara {
-    template<class T>
-    inline void hash_combine(std::size_t& seed, T const& v) noexcept {
-        seed ^= std::hash<T>{}(v) + 0x9e3779b97f4a7c15ull + (seed<<6) + (seed>>2);
-    }
-
-    struct VertexHash {
-        std::size_t operator()(Vertex const& v) const {
-            std::size_t seed = 0;
-            hash_combine(seed, v.pos);
-            hash_combine(seed, v.normal);
-            hash_combine(seed, v.color);
-            hash_combine(seed, v.texCoord);
-            return seed;
-        }
-    };
-
-    bool Vertex::operator==(const Vertex& other) const {
-        return ((pos == other.pos) && (color == other.color) && (texCoord == other.texCoord));
-    }
-
-    vk::VertexInputBindingDescription Vertex::getBindingDescription() {
-        vk::VertexInputBindingDescription bindingDescription{
-            .binding = 0,
-            .stride = sizeof(Vertex),
-            .inputRate = vk::VertexInputRate::eVertex,
-        };
-
-        return bindingDescription;
-    }
-
-    std::vector<vk::VertexInputAttributeDescription> Vertex::getAttributeDescriptions() {
-        std::vector<vk::VertexInputAttributeDescription> attributeDescriptions{};
-
-        vk::VertexInputAttributeDescription positionDescription{
-            .location = 0,
-            .binding = 0,
-            .format = vk::Format::eR32G32B32Sfloat,
-            .offset = offsetof(Vertex, pos),
-        };
-        attributeDescriptions.push_back(positionDescription);
-
-        vk::VertexInputAttributeDescription normalDescription{
-            .location = 1,
-            .binding = 0,
-            .format = vk::Format::eR32G32B32Sfloat,
-            .offset = offsetof(Vertex, normal),
-        };
-        attributeDescriptions.push_back(normalDescription);
-
-        vk::VertexInputAttributeDescription colorDescription{
-            .location = 2,
-            .binding = 0,
-            .format = vk::Format::eR32G32B32Sfloat,
-            .offset = offsetof(Vertex, color),
-        };
-        attributeDescriptions.push_back(colorDescription);
-
-        vk::VertexInputAttributeDescription textureCoordinatesDescription{
-            .location = 3,
-            .binding = 0,
-            .format = vk::Format::eR32G32Sfloat,
-            .offset = offsetof(Vertex, texCoord),
-        };
-        attributeDescriptions.push_back(textureCoordinatesDescription);
-    
-        return attributeDescriptions;
+    namespace {
+        glm::vec3 unpackPosition(const PositionStream& position) {
+            return glm::vec3(position.pos[0], position.pos[1], position.pos[2]);
+        }
+
+        void packVertices(std::span<const Vertex> vertices, std::vector<PositionStream>& positions, std::vector<AttributeStream>& attributes) {
+            positions.clear();
+            attributes.clear();
+            positions.reserve(vertices.size());
+            attributes.reserve(vertices.size());
+            for (const Vertex& vertex : vertices) {
+                positions.push_back(packPosition(vertex.pos));
+                attributes.push_back(packAttributes(vertex.normal, vertex.texCoord));
+            }
+        }
+
+        // simplifies indices[first, first + count) level by level, each time from the full range
+        LodChain buildLodChain(const std::vector<PositionStream>& positions, std::vector<uint32_t>& indices, uint32_t first, uint32_t count, const LodSettings& settings) {
+            LodChain chain;
+            chain.levels[0] = {.firstIndex = first, .indexCount = count};
+            chain.levelCount = 1;
+            if (count == 0) return chain;
+            glm::vec3 low(std::numeric_limits<float>::max());
+            glm::vec3 high(std::numeric_limits<float>::lowest());
+            for (uint32_t i = first; i < first + count; i++) {
+                low = glm::min(low, unpackPosition(positions[indices[i]]));
+                high = glm::max(high, unpackPosition(positions[indices[i]]));
+            }
+            chain.center = (low + high) / 2.0f;
+            for (uint32_t i = first; i < first + count; i++) {
+                chain.radius = std::max(chain.radius, glm::length(unpackPosition(positions[indices[i]]) - chain.center));
+            }
+            if (chain.radius == 0.0f) return chain;
+
+            size_t target = count;
+            uint32_t levelCount = std::min(settings.maxLevels + 1, MAX_LOD_LEVELS);
+            while (chain.levelCount < levelCount) {
+                target = static_cast<size_t>(target * settings.reduction) / 3 * 3;
+                float error = 0.0f;
+                std::vector<uint32_t> simplified = simplifyMesh(std::span(indices).subspan(first, count), positions[0].pos, sizeof(PositionStream), positions.size(),
+                    target, settings.maxError * chain.radius, &error);
+                // the error bound stopped the simplification before it saved much
+                const LodLevel& previous = chain.levels[chain.levelCount - 1];
+                if (simplified.empty() || simplified.size() * 10 > previous.indexCount * 9) break;
+                IndexRange range{.first = static_cast<uint32_t>(indices.size()), .count = static_cast<uint32_t>(simplified.size())};
+                indices.insert(indices.end(), simplified.begin(), simplified.end());
+                optimizeIndexRanges(indices, std::span(&range, 1), positions[0].pos, sizeof(PositionStream), positions.size());
+                chain.levels[chain.levelCount++] = {.firstIndex = range.first, .indexCount = range.count, .error = error / chain.radius};
+            }
+            return chain;
+        }
+    }
+
+    void optimizeGeometry(std::vector<PositionStream>& positions, std::vector<AttributeStream>& attributes, std::vector<uint32_t>& indices,
+            const std::vector<IndexRange>& ranges) {
+        if (positions.empty() || indices.empty()) return;
+        [[maybe_unused]] MeshOptimizationReport report = optimizeIndexRanges(indices, ranges, positions[0].pos, sizeof(PositionStream), positions.size());
+        std::vector<uint32_t> oldIndices = optimizeVertexFetch(indices, positions.size());
+        std::vector<PositionStream> reorderedPositions;
+        std::vector<AttributeStream> reorderedAttributes;
+        reorderedPositions.reserve(oldIndices.size());
+        reorderedAttributes.reserve(oldIndices.size());
+        for (uint32_t oldIndex : oldIndices) {
+            reorderedPositions.push_back(positions[oldIndex]);
+            reorderedAttributes.push_back(attributes[oldIndex]);
+        }
+        positions = std::move(reorderedPositions);
+        attributes = std::move(reorderedAttributes);
+        #ifdef VOLCHARA_MESH_STATS
+        std::clog << "mesh optimized: " << indices.size() / 3 << " triangles, "
+            << "ACMR " << report.before.acmr << " -> " << report.after.acmr << ", "
+            << "ATVR " << report.before.atvr << " -> " << report.after.atvr << std::endl;
+        #endif
+    }
+
+    std::vector<LodChain> buildSubmeshLods(const std::vector<PositionStream>& positions, std::vector<uint32_t>& indices,
+            const std::vector<Submesh>& submeshes, const LodSettings& settings) {
+        std::vector<LodChain> lods;
+        if (submeshes.empty()) {
+            lods.push_back(buildLodChain(positions, indices, 0, static_cast<uint32_t>(indices.size()), settings));
+            return lods;
+        }
+        // glTF nodes sharing a mesh share its ranges, so every range is simplified once
+        std::map<std::pair<uint32_t, uint32_t>, LodChain> chains;
+        for (const Submesh& submesh : submeshes) {
+            auto key = std::make_pair(submesh.firstIndex, submesh.indexCount);
+            auto chain = chains.find(key);
+            if (chain == chains.end()) {
+                chain = chains.emplace(key, buildLodChain(positions, indices, submesh.firstIndex, submesh.indexCount, settings)).first;
+            }
+            lods.push_back(chain->second);
+        }
+        return lods;
+    }
+
+    std::vector<Meshlet> buildSubmeshMeshlets(const std::vector<PositionStream>& positions, const std::vector<uint32_t>& indices,
+            std::vector<Submesh>& submeshes) {
+        std::vector<Meshlet> meshlets;
+        if (positions.empty()) return meshlets;
+        if (submeshes.empty()) {
+            return buildMeshlets(indices, {.first = 0, .count = static_cast<uint32_t>(indices.size())}, positions[0].pos, sizeof(PositionStream), positions.size());
+        }
+        // (first meshlet, meshlet count) by index range, as nodes sharing a glTF mesh share its ranges
+        std::map<std::pair<uint32_t, uint32_t>, std::pair<uint32_t, uint32_t>> ranges;
+        for (Submesh& submesh : submeshes) {
+            auto key = std::make_pair(submesh.firstIndex, submesh.indexCount);
+            auto range = ranges.find(key);
+            if (range == ranges.end()) {
+                std::vector<Meshlet> built = buildMeshlets(indices, {.first = submesh.firstIndex, .count = submesh.indexCount}, positions[0].pos, sizeof(PositionStream), positions.size());
+                range = ranges.emplace(key, std::make_pair(static_cast<uint32_t>(meshlets.size()), static_cast<uint32_t>(built.size()))).first;
+                meshlets.insert(meshlets.end(), built.begin(), built.end());
+            }
+            submesh.firstMeshlet = range->second.first;
+            submesh.meshletCount = range->second.second;
+        }
+        return meshlets;
     }
 
     void Transform::Position::forward(float distance, bool world) {
         if (world) {
-            parent->translation += glm::vec3(0, 0, -distance);
+            parent->setTranslation(parent->translation() + glm::vec3(0, 0, -distance));
         } else {
-            parent->translation += parent->rotationQuat * glm::vec3(0, 0, -distance);
+            parent->setTranslation(parent->translation() + parent->rotationQuat() * glm::vec3(0, 0, -distance));
         }
     }
     void Transform::Position::backward(float distance, bool world) {
@@ -98,9 +155,9 @@ namespace volchara {
     }
     void Transform::Position::left(float distance, bool world) {
         if (world) {
-            parent->translation += glm::vec3(-distance, 0, 0);
+            parent->setTranslation(parent->translation() + glm::vec3(-distance, 0, 0));
         } else {
-            parent->translation += parent->rotationQuat * glm::vec3(-distance, 0, 0);
+            parent->setTranslation(parent->translation() + parent->rotationQuat() * glm::vec3(-distance, 0, 0));
         }
     }
     void Transform::Position::right(float distance, bool world) {
@@ -108,9 +165,9 @@ namespace volchara {
     }
     void Transform::Position::up(float distance, bool world) {
         if (world) {
-            parent->translation += glm::vec3(0, distance, 0);
+            parent->setTranslation(parent->translation() + glm::vec3(0, distance, 0));
         } else {
-            parent->translation += parent->rotationQuat * glm::vec3(0, distance, 0);
+            parent->setTranslation(parent->translation() + parent->rotationQuat() * glm::vec3(0, distance, 0));
         }
     }
     void Transform::Position::down(float distance, bool world) {
@@ -119,9 +176,9 @@ namespace volchara {
 
     void Transform::Rotation::up(float degrees, bool world) {
         if (world) {
-            parent->rotationQuat = glm::normalize(glm::quat({degrees, 0, 0}) * parent->rotationQuat);
+            parent->setRotationQuat(glm::normalize(glm::quat({degrees, 0, 0}) * parent->rotationQuat()));
         } else {
-            parent->rotationQuat = glm::normalize(parent->rotationQuat * glm::quat({degrees, 0, 0}));
+            parent->setRotationQuat(glm::normalize(parent->rotationQuat() * glm::quat({degrees, 0, 0})));
         }
     }
     void Transform::Rotation::down(float degrees, bool world) {
@@ -129,9 +186,9 @@ namespace volchara {
     }
     void Transform::Rotation::left(float degrees, bool world) {
         if (world) {
-            parent->rotationQuat = glm::normalize(glm::quat({0, degrees, 0}) * parent->rotationQuat);
+            parent->setRotationQuat(glm::normalize(glm::quat({0, degrees, 0}) * parent->rotationQuat()));
         } else {
-            parent->rotationQuat = glm::normalize(parent->rotationQuat * glm::quat({0, degrees, 0}));
+            parent->setRotationQuat(glm::normalize(parent->rotationQuat() * glm::quat({0, degrees, 0})));
         }
     }
     void Transform::Rotation::right(float degrees, bool world) {
@@ -139,71 +196,339 @@ namespace volchara {
     }
     void Transform::Rotation::cw(float degrees, bool world) {
         if (world) {
-            parent->rotationQuat = glm::normalize(glm::quat({0, 0, -degrees}) * parent->rotationQuat);
+            parent->setRotationQuat(glm::normalize(glm::quat({0, 0, -degrees}) * parent->rotationQuat()));
         } else {
-            parent->rotationQuat = glm::normalize(parent->rotationQuat * glm::quat({0, 0, -degrees}));
+            parent->setRotationQuat(glm::normalize(parent->rotationQuat() * glm::quat({0, 0, -degrees})));
         }
     }
     void Transform::Rotation::ccw(float degrees, bool world) {
         cw(-degrees, world);
     }
 
-    glm::mat4 Transform::modelMatrix() {
-        glm::mat4 translationMatrix = glm::translate(translation);
-        glm::mat4 scaleMatrix = glm::scale(scaling);
-        glm::mat4 rotationMatrix = glm::toMat4(rotationQuat);
-        glm::mat4 result = translationMatrix * rotationMatrix * scaleMatrix;
-        return result;
+    Transform::Transform(TransformStore& store, const TransformState& state) : store(&store), slot(store.allocate(state)), position(this), rotation(this) {}
+
+    Transform::Transform(const Transform& other) : store(other.store), slot(other.store->allocate(other.state())), position(this), rotation(this) {
+        store->setParent(slot, store->parent(other.slot));
+    }
+
+    Transform::Transform(Transform&& other) noexcept : store(std::exchange(other.store, nullptr)), slot(other.slot), position(this), rotation(this) {}
+
+    Transform& Transform::operator=(const Transform& other) {
+        if (this != &other) {
+            if (!store) {
+                store = other.store;
+                slot = store->allocate(other.state());
+            }
+            else {
+                store->set(slot, other.state());
+            }
+            store->setParent(slot, other.store->parent(other.slot));
+        }
+        return *this;
+    }
+
+    Transform& Transform::operator=(Transform&& other) noexcept {
+        if (this != &other) {
+            if (store) store->release(slot);
+            store = std::exchange(other.store, nullptr);
+            slot = other.slot;
+        }
+        return *this;
+    }
+
+    Transform::~Transform() {
+        if (store) store->release(slot);
+    }
+
+    glm::vec3 Transform::translation() const {
+        return store->translation(slot);
+    }
+
+    void Transform::setTranslation(glm::vec3 translation) {
+        store->setTranslation(slot, translation);
+    }
+
+    glm::vec3 Transform::scaling() const {
+        return store->scaling(slot);
+    }
+
+    void Transform::setScaling(glm::vec3 scaling) {
+        store->setScaling(slot, scaling);
+    }
+
+    glm::quat Transform::rotationQuat() const {
+        return store->rotation(slot);
+    }
+
+    void Transform::setRotationQuat(glm::quat rotation) {
+        store->setRotation(slot, rotation);
+    }
+
+    bool Transform::isDirty() const {
+        return store->isDirty(slot);
+    }
+
+    void Transform::clearDirty() {
+        store->clearDirty(slot);
+    }
+
+    void Transform::setParent(const Transform& parent) {
+        if (parent.store != store) {
+            throw std::runtime_error("parent transform belongs to another renderer!");
+        }
+        store->setParent(slot, parent.slot);
+    }
+
+    void Transform::clearParent() {
+        store->setParent(slot, TransformStore::NO_PARENT);
+    }
+
+    uint32_t Transform::slotIndex() const {
+        return slot;
+    }
+
+    glm::mat4 Transform::modelMatrix() const {
+        return state().modelMatrix();
+    }
+
+    TransformState Transform::state() const {
+        return store->get(slot);
+    }
+
+    GeometryAllocation::~GeometryAllocation() {
+        if (renderer) renderer->releaseGeometry(*this);
     }
 
-    Object::Object(Renderer& renderer, std::vector<Vertex> initVertices, std::vector<uint32_t> initIndices, glm::vec3 translation, glm::vec3 scaling, glm::quat rotation) {
+    Object::Object(Renderer& renderer, std::vector<Vertex> initVertices, std::vector<uint32_t> initIndices, glm::vec3 translation, glm::vec3 scaling, glm::quat rotation)
+        : transform(renderer.transforms, {.translation = translation, .scaling = scaling, .rotationQuat = rotation}),
+          entity(renderer.scene.create(COMPONENT_TRANSFORM)) {
         this->renderer = &renderer;
-        vertices = initVertices;
+        renderer.scene.transform(entity) = transform.slotIndex();
+        packVertices(initVertices, positions, attributes);
         if (initIndices.empty()) {
-            indices = std::vector<uint32_t>(vertices.size());
+            indices = std::vector<uint32_t>(positions.size());
             std::iota(indices.begin(), indices.end(), 0);
         }
         else {
-            indices = initIndices;
+            indices = std::move(initIndices);
         }
-        transform.translation = translation;
-        transform.scaling = scaling;
-        transform.rotationQuat = rotation;
     }
-    void Object::runFrameCallbacks(float passedSeconds, std::set<int> pressedKeys) {
-        for (auto callback : frameCallbacks) {
-            callback(this, passedSeconds, pressedKeys);
+    Object::Object(const Object& other)
+        : positions(other.positions), attributes(other.attributes), indices(other.indices), keepGeometry(other.keepGeometry), geometry(other.geometry), transform(other.transform),
+          entity(other.renderer->scene.create(COMPONENT_TRANSFORM)),
+          nodes(other.nodes), nodeParents(other.nodeParents), submeshes(other.submeshes), materials(other.materials), lods(other.lods), meshlets(other.meshlets), meshCache(other.meshCache),
+          pendingModel(other.pendingModel), pendingTexture(other.pendingTexture), renderer(other.renderer), textureIndex(other.textureIndex), color(other.color) {
+        renderer->scene.transform(entity) = transform.slotIndex();
+        copyFrameCallbacks(other);
+        linkNodes();
+    }
+    Object::Object(Object&& other) noexcept
+        : positions(std::move(other.positions)), attributes(std::move(other.attributes)), indices(std::move(other.indices)), keepGeometry(other.keepGeometry), geometry(std::move(other.geometry)),
+          transform(std::move(other.transform)), entity(std::exchange(other.entity, {})), instances(std::exchange(other.instances, {})),
+          nodes(std::move(other.nodes)), nodeParents(std::move(other.nodeParents)), submeshes(std::move(other.submeshes)), materials(std::move(other.materials)), lods(std::move(other.lods)), meshlets(std::move(other.meshlets)), meshCache(std::move(other.meshCache)),
+          pendingModel(std::move(other.pendingModel)), pendingTexture(std::move(other.pendingTexture)), renderer(other.renderer), textureIndex(other.textureIndex), color(other.color) {
+        adoptFrameCallbacks();
+    }
+    Object& Object::operator=(const Object& other) {
+        if (this != &other) {
+            positions = other.positions;
+            attributes = other.attributes;
+            indices = other.indices;
+            keepGeometry = other.keepGeometry;
+            geometry = other.geometry;
+            transform = other.transform;
+            nodes = other.nodes;
+            nodeParents = other.nodeParents;
+            submeshes = other.submeshes;
+            materials = other.materials;
+            lods = other.lods;
+            meshlets = other.meshlets;
+            meshCache = other.meshCache;
+            pendingModel = other.pendingModel;
+            pendingTexture = other.pendingTexture;
+            renderer = other.renderer;
+            textureIndex = other.textureIndex;
+            color = other.color;
+            copyFrameCallbacks(other);
+            linkNodes();
+        }
+        return *this;
+    }
+    Object& Object::operator=(Object&& other) noexcept {
+        if (this != &other) {
+            releaseEntities();
+            positions = std::move(other.positions);
+            attributes = std::move(other.attributes);
+            indices = std::move(other.indices);
+            keepGeometry = other.keepGeometry;
+            geometry = std::move(other.geometry);
+            transform = std::move(other.transform);
+            entity = std::exchange(other.entity, {});
+            instances = std::exchange(other.instances, {});
+            nodes = std::move(other.nodes);
+            nodeParents = std::move(other.nodeParents);
+            submeshes = std::move(other.submeshes);
+            materials = std::move(other.materials);
+            lods = std::move(other.lods);
+            meshlets = std::move(other.meshlets);
+            meshCache = std::move(other.meshCache);
+            pendingModel = std::move(other.pendingModel);
+            pendingTexture = std::move(other.pendingTexture);
+            renderer = other.renderer;
+            textureIndex = other.textureIndex;
+            color = other.color;
+            adoptFrameCallbacks();
+        }
+        return *this;
+    }
+    Object::~Object() {
+        releaseEntities();
+    }
+    void Object::copyFrameCallbacks(const Object& other) {
+        SceneRegistry& scene = renderer->scene;
+        if (scene.alive(other.entity) && (scene.components(other.entity) & COMPONENT_CALLBACKS)) {
+            scene.add(entity, COMPONENT_CALLBACKS);
+            const FrameCallbacks& otherCallbacks = scene.callbacks(other.entity);
+            scene.callbacks(entity) = {.owner = this, .callbacks = otherCallbacks.callbacks, .parallelCallbacks = otherCallbacks.parallelCallbacks};
+        }
+        else {
+            scene.remove(entity, COMPONENT_CALLBACKS);
+        }
+        // the entity may have changed archetypes, moving drawn rows
+        renderer->markSceneDirty();
+    }
+    void Object::adoptFrameCallbacks() {
+        SceneRegistry& scene = renderer->scene;
+        if (scene.alive(entity) && (scene.components(entity) & COMPONENT_CALLBACKS)) {
+            scene.callbacks(entity).owner = this;
+        }
+    }
+    void Object::releaseEntities() {
+        if (!renderer || !renderer->scene.alive(entity)) return;
+        for (Entity instance : instances) {
+            if (instance != entity && renderer->scene.alive(instance)) renderer->scene.destroy(instance);
+        }
+        instances.clear();
+        renderer->scene.destroy(entity);
+        entity = {};
+    }
+    void Object::linkNodes() {
+        for (size_t i = 0; i < nodes.size(); i++) {
+            nodes[i].setParent(nodeParents[i] < 0 ? transform : nodes[nodeParents[i]]);
+        }
+    }
+    void Object::setParent(Object& parent) {
+        transform.setParent(parent.transform);
+    }
+    void Object::addFrameCallback(FrameCallback callback, CallbackExecution execution) {
+        SceneRegistry& scene = renderer->scene;
+        if (!(scene.components(entity) & COMPONENT_CALLBACKS)) {
+            scene.add(entity, COMPONENT_CALLBACKS);
+            scene.callbacks(entity).owner = this;
+            renderer->markSceneDirty();
+        }
+        FrameCallbacks& callbacks = scene.callbacks(entity);
+        (execution == CallbackExecution::Parallel ? callbacks.parallelCallbacks : callbacks.callbacks).push_back(std::move(callback));
+    }
+    void Object::runFrameCallbacks(float passedSeconds, const InputState& input) {
+        SceneRegistry& scene = renderer->scene;
+        if (!(scene.components(entity) & COMPONENT_CALLBACKS)) return;
+        for (auto& callback : scene.callbacks(entity).parallelCallbacks) {
+            callback(this, passedSeconds, input);
+        }
+        for (auto& callback : scene.callbacks(entity).callbacks) {
+            callback(this, passedSeconds, input);
         }
         return;
     }
     void Object::setColor(std::array<float, 3> color) {
-        for (Vertex& v : vertices) {
-            v.color.r = color[0];
-            v.color.g = color[1];
-            v.color.b = color[2];
+        this->color = {color[0], color[1], color[2]};
+        for (Entity instance : instances) {
+            renderer->scene.material(instance).color = this->color;
         }
+        renderer->markSceneDirty();
     }
     void Object::loadTexture(const std::filesystem::path path) {
-        textureIndex = renderer->createTextureImage(path);
-        renderer->loadTextureToDescriptors(textureIndex);
-    }
-    void Object::generateIndices(std::vector<Vertex> fromVertices) {
-        std::vector<Vertex> newVertices;
-        std::vector<uint32_t> newIndices;
-        std::unordered_map<Vertex, int32_t, VertexHash> indexMap;
-        for (Vertex v : fromVertices) {
-            auto pos = indexMap.find(v);
-            if (pos == indexMap.end()) {
-                newIndices.push_back(newVertices.size());
-                indexMap.insert({v, newVertices.size()});
-                newVertices.push_back(v);
-            } else {
-                newIndices.push_back(pos->second);
+        textureIndex = renderer->uploadTexture(decodeImageFile(path));
+        for (Entity instance : instances) {
+            renderer->scene.material(instance).textureIndex = textureIndex;
+        }
+        renderer->markSceneDirty();
+    }
+    void Object::loadTextureAsync(const std::filesystem::path path) {
+        pendingTexture = renderer->assetLoader.load<uint32_t>([renderer = renderer, path] {
+            return renderer->uploadTexture(decodeImageFile(path));
+        });
+    }
+    bool Object::isLoading() const {
+        return pendingModel || pendingTexture;
+    }
+    void Object::adoptModel(ImportedModel&& model) {
+        // drops the placeholder, or a model adopted before
+        geometry.reset();
+        std::map<int32_t, uint32_t> textures;
+        for (const auto& [image, decoded] : model.images) {
+            textures[image] = renderer->uploadTexture(decoded);
+        }
+        adoptModelData(std::move(model), textures);
+    }
+    void Object::adoptModel(LoadedModel&& loaded) {
+        geometry = std::move(loaded.geometry);
+        adoptModelData(std::move(loaded.model), loaded.textures);
+        if (!keepGeometry) {
+            std::vector<PositionStream>().swap(positions);
+            std::vector<AttributeStream>().swap(attributes);
+            std::vector<uint32_t>().swap(indices);
+            std::vector<Meshlet>().swap(meshlets);
+            meshCache.reset();
+        }
+    }
+    void Object::adoptModelData(ImportedModel&& model, const std::map<int32_t, uint32_t>& textures) {
+        positions = std::move(model.positions);
+        attributes = std::move(model.attributes);
+        indices = std::move(model.indices);
+        meshlets = std::move(model.meshlets);
+        meshCache = std::move(model.meshCache);
+        nodes.clear();
+        for (const TransformState& state : model.nodes) {
+            nodes.emplace_back(renderer->transforms, state);
+        }
+        nodeParents = std::move(model.nodeParents);
+        submeshes = std::move(model.submeshes);
+        lods = std::move(model.lods);
+        linkNodes();
+
+        materials.clear();
+        for (const CachedMaterial& material : model.materials) {
+            auto texture = textures.find(material.image);
+            if (texture != textures.end()) {
+                // black, so the texture is drawn
+                materials.push_back({.textureIndex = texture->second});
+            }
+            else {
+                materials.push_back({.color = glm::vec3(material.color[0], material.color[1], material.color[2])});
             }
         }
-        maxVertexIndex = *std::max_element(newIndices.begin(), newIndices.end());
-        vertices = newVertices;
-        indices = newIndices;
+    }
+    void Object::generateIndices(const std::vector<Vertex>& fromVertices, float weldEpsilon) {
+        WeldedMesh welded = weldVertices(fromVertices, weldEpsilon, &renderer->jobSystem);
+        packVertices(welded.vertices, positions, attributes);
+        optimizeGeometry(positions, attributes, welded.indices, {{.first = 0, .count = static_cast<uint32_t>(welded.indices.size())}});
+        indices = std::move(welded.indices);
+    }
+
+    void Object::generateLods(const LodSettings& settings) {
+        if (geometry) {
+            throw std::runtime_error("LODs have to be generated before the object is first added!");
+        }
+        lods = buildSubmeshLods(positions, indices, submeshes, settings);
+    }
+
+    void Object::generateMeshlets() {
+        if (geometry) {
+            throw std::runtime_error("meshlets have to be generated before the object is first added!");
+        }
+        meshlets = buildSubmeshMeshlets(positions, indices, submeshes);
     }
 
     Plane Plane::fromWorldCoordinates(Renderer& renderer, InitDataPlane initVertices, bool wIndices) {
@@ -232,123 +557,19 @@ namespace volchara {
         return obj;
     }
     
-    GLTFModel GLTFModel::fromFile(Renderer &renderer, std::filesystem::path modelPath) {
-        tinygltf::TinyGLTF gltfLoader;
-        tinygltf::Model model;
-        std::string err;
-        std::string warn;
-        std::u8string unicodePathTmp = modelPath.u8string();
-        std::string unicodePath(unicodePathTmp.begin(), unicodePathTmp.end());
-        bool res;
-        if (modelPath.extension().string() == ".gltf") {
-            res = gltfLoader.LoadASCIIFromFile(&model, &err, &warn, unicodePath);
-        }
-        else if (modelPath.extension().string() == ".glb") {
-            res = gltfLoader.LoadBinaryFromFile(&model, &err, &warn, unicodePath);
-        }
-        else {
-            throw std::runtime_error(std::string("failed to load gltf: unknown extension ") + modelPath.extension().string());
-        }
-        if (!res || !err.empty()) {
-            throw std::runtime_error("failed to load gltf: " + err);
-        }
-        bool solid_color;
-        if (model.textures.size() < 1) {
-            solid_color = true;
-        }
-        else {
-            solid_color = false;
-        }
-        std::map<int, int> textureMapping;
-        for (tinygltf::Texture& texture : model.textures) {
-            int modelTextureId = texture.source;
-            std::filesystem::path texturePath = modelPath.parent_path() / model.images[modelTextureId].uri;
-            int rendererTextureId = renderer.createTextureImage(texturePath);
-            renderer.loadTextureToDescriptors(rendererTextureId);
-            textureMapping[modelTextureId] = rendererTextureId;
-        }
-        std::vector<Vertex> resVertices;
-        std::vector<uint32_t> resIndices;
-        tinygltf::Scene& defScene = model.scenes[model.defaultScene];
-        std::vector<int> nodes(defScene.nodes.begin(), defScene.nodes.end());
-        while (!nodes.empty()) {
-            int node_id = nodes.back();
-            nodes.pop_back();
-            tinygltf::Node& node = model.nodes[node_id];
-            for (int child : node.children) {
-                nodes.push_back(child);
-            }
-            if (node.mesh < 0) {
-                continue;
-            }
+    GLTFModel GLTFModel::fromFile(Renderer& renderer, std::filesystem::path modelPath) {
+        GLTFModel obj(renderer, {});
+        obj.adoptModel(importGLTFModel(modelPath, &renderer.jobSystem));
+        return obj;
+    }
 
-            tinygltf::Mesh& mesh = model.meshes[node.mesh];
-            for (const tinygltf::Primitive prim : mesh.primitives) {
-                if (prim.mode != TINYGLTF_MODE_TRIANGLES && prim.mode != 0) {
-                    throw std::runtime_error("failed to load gltf: currently only triangle load available");
-                }
-
-                auto iterPosition = prim.attributes.find("POSITION");
-                if (iterPosition == prim.attributes.end()) {
-                    continue;
-                }
-                tinygltf::Accessor accessorPosition = model.accessors[iterPosition->second];
-                if (accessorPosition.type != TINYGLTF_TYPE_VEC3 || accessorPosition.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT) {
-                    throw std::runtime_error("failed to load gltf: position not vec3 float");
-                }
-                auto iterTexCoord = prim.attributes.find("TEXCOORD_0");
-                if (iterTexCoord == prim.attributes.end()) {
-                    continue;
-                }
-                tinygltf::Accessor accessorTexCoord = model.accessors[iterTexCoord->second];
-                if (accessorTexCoord.type != TINYGLTF_TYPE_VEC2 || accessorTexCoord.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT) {
-                    throw std::runtime_error("failed to load gltf: uv not vec2 float");
-                }
-                
-                tinygltf::BufferView& bufferViewPosition = model.bufferViews[accessorPosition.bufferView];
-                tinygltf::Buffer& bufferPosition = model.buffers[bufferViewPosition.buffer];
-                const float* positions = reinterpret_cast<const float*>(&bufferPosition.data[bufferViewPosition.byteOffset + accessorPosition.byteOffset]);
-
-                tinygltf::BufferView& bufferViewTexCoord = model.bufferViews[accessorTexCoord.bufferView];
-                tinygltf::Buffer& bufferTexCoord = model.buffers[bufferViewTexCoord.buffer];
-                const float* texcoords = reinterpret_cast<const float*>(&bufferTexCoord.data[bufferViewTexCoord.byteOffset + accessorTexCoord.byteOffset]);
-
-                if (prim.indices >= 0) {
-                    int indexOffset = resVertices.size();
-                    tinygltf::Accessor accessorIndices = model.accessors[prim.indices];
-                    tinygltf::BufferView& bufferViewIndices = model.bufferViews[accessorIndices.bufferView];
-                    tinygltf::Buffer& bufferIndices = model.buffers[bufferViewIndices.buffer];
-                    const uint32_t* indices = reinterpret_cast<const uint32_t*>(&bufferIndices.data[bufferViewIndices.byteOffset + accessorIndices.byteOffset]);
-                    for (size_t i = 0; i < accessorIndices.count; i++) {
-                        uint32_t index = indices[i];
-                        resIndices.push_back(index + indexOffset);
-                    }
-                    for (size_t vertexId = 0; vertexId < accessorPosition.count; vertexId++) {
-                        Vertex v;
-                        v.pos = glm::vec3(positions[vertexId*3 + 0], positions[vertexId*3 + 1], positions[vertexId*3 + 2]);
-                        v.texCoord = glm::vec2(texcoords[vertexId*2 + 0], texcoords[vertexId*2 + 1]);
-                        if (solid_color) {
-                            v.color = glm::vec3(1, 0, 0);
-                        }
-                        resVertices.push_back(v);
-                    }
-                }
-                else {
-                    for (size_t i = 0; i < accessorPosition.count; i++) {
-                        Vertex v;
-                        v.pos = glm::vec3(positions[i*3 + 0], positions[i*3 + 1], positions[i*3 + 2]);
-                        v.texCoord = glm::vec2(texcoords[i*2 + 0], texcoords[i*2 + 1]);
-                        if (solid_color) {
-                            v.color = glm::vec3(1, 0, 0);
-                        }
-                        resIndices.push_back(resVertices.size());
-                        resVertices.push_back(v);
-                    }
-                }
-            }
-        }
-        GLTFModel obj(renderer, resVertices, resIndices);
-        obj.textureIndex = textureMapping[0];
+    GLTFModel GLTFModel::fromFileAsync(Renderer& renderer, std::filesystem::path modelPath) {
+        GLTFModel obj(renderer, {});
+        obj.geometry = renderer.placeholderGeometry();
+        // without the job system, so a frame waiting on its own jobs never picks up a slow decode
+        obj.pendingModel = renderer.assetLoader.load<LoadedModel>([renderer = &renderer, modelPath] {
+            return renderer->uploadModel(importGLTFModel(modelPath));
+        });
         return obj;
     }
 
@@ -432,7 +653,7 @@ namespace volchara {
         DirectionalLight light(renderer);
         light.brightness = initData.brightness;
         light.color = color;
-        light.transform.translation = position;
+        light.transform.setTranslation(position);
         return light;
     }
-}
\ No newline at end of file
+}
\ No newline at end of file
@@ -1,14 +1,19 @@
 #include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <string>
 #include <utility>
+#include <vector>
 
 #include <vulkan/vulkan_raii.hpp>
 #include <vk_mem_alloc.hpp>
 
 #include <raii_wrappers.hpp>
 #include <device_buffer_copy_handler.hpp>
+#include <memory_stats.hpp>
 
 namespace volchara {
-    RAIIvmaBuffer::RAIIvmaBuffer(vk::raii::Device& dev, vma::Allocator& fromAllocator, vk::BufferCreateInfo bufferInfo, vma::AllocationCreateInfo allocInfo, DeviceBufferCopyHandler& handler) {
+    RAIIvmaBuffer::RAIIvmaBuffer(vk::raii::Device& dev, vma::Allocator& fromAllocator, vk::BufferCreateInfo bufferInfo, vma::AllocationCreateInfo allocInfo, DeviceBufferCopyHandler& handler, MemoryAccounting* accounting, MemoryCategory category) {
         this->dev = &dev;
         allocator = &fromAllocator;
         std::pair<vk::Buffer, vma::Allocation> p = allocator->createBuffer(bufferInfo, allocInfo);
@@ -16,10 +21,19 @@ namespace volchara {
         alloc = p.second;
         if (allocInfo.flags & vma::AllocationCreateFlagBits::eHostAccessSequentialWrite) mappable = true;
         copyHandler = &handler;
+        this->bufferInfo = bufferInfo;
+        if (accounting) {
+            this->accounting = accounting;
+            this->category = category;
+            allocationSize = allocator->getAllocationInfo(alloc).size;
+            accounting->add(category, allocationSize);
+        }
     }
     RAIIvmaBuffer::~RAIIvmaBuffer() {
-        if (buf)
+        if (buf) {
             allocator->destroyBuffer(buf, alloc);
+            if (accounting) accounting->remove(category, allocationSize);
+        }
         buf = nullptr;
         alloc = nullptr;
     }
@@ -37,9 +51,9 @@ namespace volchara {
     RAIIvmaBuffer::operator vma::Allocation() const {
         return alloc;
     }
-    void RAIIvmaBuffer::copyFrom(void* buffer, uint32_t size) {
+    void RAIIvmaBuffer::copyFrom(const void* buffer, uint32_t size, vk::DeviceSize offset) {
         if (mappable) {
-            allocator->copyMemoryToAllocation(buffer, alloc, 0, size);
+            allocator->copyMemoryToAllocation(buffer, alloc, offset, size);
         }
         else {
             vk::BufferCreateInfo bufInfo{
@@ -53,13 +67,34 @@ namespace volchara {
             };
             std::pair<vk::Buffer, vma::Allocation> p = allocator->createBuffer(bufInfo, allocInfo);
             allocator->copyMemoryToAllocation(buffer, p.second, 0, size);
-            copyHandler->submit(p.first, buf, size);
+            copyHandler->submit(p.first, buf, size, offset);
             allocator->destroyBuffer(p.first, p.second);
         }
     }
+    void RAIIvmaBuffer::flush(vk::DeviceSize offset, vk::DeviceSize size) {
+        allocator->flushAllocation(alloc, offset, size);
+    }
     vma::AllocationInfo RAIIvmaBuffer::allocInfo() {
         return allocator->getAllocationInfo(alloc);
     }
+    vk::DeviceSize RAIIvmaBuffer::size() const {
+        return bufferInfo.size;
+    }
+    vk::Buffer RAIIvmaBuffer::beginMove(vma::Allocation destination) {
+        VkBuffer moved = VK_NULL_HANDLE;
+        VkResult result = vmaCreateAliasingBuffer(static_cast<VmaAllocator>(*allocator), static_cast<VmaAllocation>(destination), reinterpret_cast<const VkBufferCreateInfo*>(&bufferInfo), &moved);
+        if (result != VK_SUCCESS) {
+            throw std::runtime_error("failed to create a moved buffer!");
+        }
+        movedBuf = vk::Buffer(moved);
+        return movedBuf;
+    }
+    void RAIIvmaBuffer::finishMove() {
+        // the allocation itself now refers to the new place, only the old handle goes
+        dev->getDispatcher()->vkDestroyBuffer(static_cast<VkDevice>(**dev), static_cast<VkBuffer>(buf), nullptr);
+        buf = movedBuf;
+        movedBuf = nullptr;
+    }
     void RAIIvmaBuffer::swap(RAIIvmaBuffer& lhs, RAIIvmaBuffer& rhs) {
         std::swap(lhs.dev, rhs.dev);
         std::swap(lhs.allocator, rhs.allocator);
@@ -67,9 +102,14 @@ namespace volchara {
         std::swap(lhs.alloc, rhs.alloc);
         std::swap(lhs.mappable, rhs.mappable);
         std::swap(lhs.copyHandler, rhs.copyHandler);
+        std::swap(lhs.accounting, rhs.accounting);
+        std::swap(lhs.category, rhs.category);
+        std::swap(lhs.allocationSize, rhs.allocationSize);
+        std::swap(lhs.bufferInfo, rhs.bufferInfo);
+        std::swap(lhs.movedBuf, rhs.movedBuf);
     }
 
-    RAIIvmaImage::RAIIvmaImage(vk::raii::Device& dev, vma::Allocator& fromAllocator, vk::ImageCreateInfo imageInfo, vma::AllocationCreateInfo allocInfo, DeviceBufferCopyHandler& handler, vk::ImageAspectFlags aspectFlags) {
+    RAIIvmaImage::RAIIvmaImage(vk::raii::Device& dev, vma::Allocator& fromAllocator, vk::ImageCreateInfo imageInfo, vma::AllocationCreateInfo allocInfo, DeviceBufferCopyHandler& handler, vk::ImageAspectFlags aspectFlags, MemoryAccounting* accounting, MemoryCategory category) {
         this->dev = &dev;
         allocator = &fromAllocator;
         std::pair<vk::Image, vma::Allocation> p = allocator->createImage(imageInfo, allocInfo);
@@ -91,10 +131,20 @@ namespace volchara {
         imgView = this->dev->createImageView(viewInfo);
         copyHandler = &handler;
         imageExtent = imageInfo.extent;
+        this->imageInfo = imageInfo;
+        this->aspectFlags = aspectFlags;
+        if (accounting) {
+            this->accounting = accounting;
+            this->category = category;
+            allocationSize = allocator->getAllocationInfo(alloc).size;
+            accounting->add(category, allocationSize);
+        }
     }
     RAIIvmaImage::~RAIIvmaImage() {
-        if (img)
+        if (img) {
             allocator->destroyImage(img, alloc);
+            if (accounting) accounting->remove(category, allocationSize);
+        }
         img = nullptr;
         alloc = nullptr;
     }
@@ -112,7 +162,7 @@ namespace volchara {
     RAIIvmaImage::operator vma::Allocation() const {
         return alloc;
     }
-    void RAIIvmaImage::copyFrom(void* buffer, uint32_t size) {
+    void RAIIvmaImage::copyFrom(const void* buffer, uint32_t size) {
         if (mappable) {
             allocator->copyMemoryToAllocation(buffer, alloc, 0, size);
         }
@@ -135,6 +185,37 @@ namespace volchara {
     const vk::ImageView RAIIvmaImage::imageView() {
         return *imgView;
     }
+    vk::Extent3D RAIIvmaImage::extent() const {
+        return imageExtent;
+    }
+    vk::Image RAIIvmaImage::beginMove(vma::Allocation destination) {
+        VkImage moved = VK_NULL_HANDLE;
+        VkResult result = vmaCreateAliasingImage(static_cast<VmaAllocator>(*allocator), static_cast<VmaAllocation>(destination), reinterpret_cast<const VkImageCreateInfo*>(&imageInfo), &moved);
+        if (result != VK_SUCCESS) {
+            throw std::runtime_error("failed to create a moved image!");
+        }
+        movedImg = vk::Image(moved);
+        return movedImg;
+    }
+    void RAIIvmaImage::finishMove() {
+        imgView = nullptr;
+        dev->getDispatcher()->vkDestroyImage(static_cast<VkDevice>(**dev), static_cast<VkImage>(img), nullptr);
+        img = movedImg;
+        movedImg = nullptr;
+        vk::ImageViewCreateInfo viewInfo{
+            .image = img,
+            .viewType = vk::ImageViewType::e2D,
+            .format = imageInfo.format,
+            .subresourceRange = {
+                .aspectMask = aspectFlags,
+                .baseMipLevel = 0,
+                .levelCount = 1,
+                .baseArrayLayer = 0,
+                .layerCount = 1,
+            },
+        };
+        imgView = dev->createImageView(viewInfo);
+    }
     void RAIIvmaImage::swap(RAIIvmaImage& lhs, RAIIvmaImage& rhs) {
         std::swap(lhs.dev, rhs.dev);
         std::swap(lhs.allocator, rhs.allocator);
@@ -143,11 +224,19 @@ namespace volchara {
         std::swap(lhs.alloc, rhs.alloc);
         std::swap(lhs.mappable, rhs.mappable);
         std::swap(lhs.copyHandler, rhs.copyHandler);
+        std::swap(lhs.imageExtent, rhs.imageExtent);
+        std::swap(lhs.accounting, rhs.accounting);
+        std::swap(lhs.category, rhs.category);
+        std::swap(lhs.allocationSize, rhs.allocationSize);
+        std::swap(lhs.imageInfo, rhs.imageInfo);
+        std::swap(lhs.aspectFlags, rhs.aspectFlags);
+        std::swap(lhs.movedImg, rhs.movedImg);
     }
 
-    RAIIAllocator::RAIIAllocator(vk::raii::Instance& inst, vk::raii::PhysicalDevice& physDev, vk::raii::Device& device, DeviceBufferCopyHandler& handler) {
+    RAIIAllocator::RAIIAllocator(vk::raii::Instance& inst, vk::raii::PhysicalDevice& physDev, vk::raii::Device& device, DeviceBufferCopyHandler& handler, bool memoryBudget) {
         dev = &device;
         vma::AllocatorCreateInfo allocInfo{
+            .flags = memoryBudget ? vma::AllocatorCreateFlags(vma::AllocatorCreateFlagBits::eExtMemoryBudget) : vma::AllocatorCreateFlags{},
             .physicalDevice = physDev,
             .device = *dev,
             .instance = inst,
@@ -155,6 +244,8 @@ namespace volchara {
         };
         vmaAlloc = vma::createAllocator(allocInfo);
         copyHandler = &handler;
+        accounting = std::make_unique<MemoryAccounting>();
+        driverBudget = memoryBudget;
     }
     RAIIAllocator::~RAIIAllocator() {
         vmaAlloc.destroy();
@@ -163,19 +254,67 @@ namespace volchara {
         std::swap(vmaAlloc, other.vmaAlloc);
         std::swap(dev, other.dev);
         std::swap(copyHandler, other.copyHandler);
+        std::swap(accounting, other.accounting);
+        std::swap(driverBudget, other.driverBudget);
     }
     const RAIIAllocator& RAIIAllocator::operator=(RAIIAllocator&& other) {
         RAIIAllocator t(std::move(other));
         std::swap(vmaAlloc, t.vmaAlloc);
         std::swap(dev, t.dev);
         std::swap(copyHandler, t.copyHandler);
+        std::swap(accounting, t.accounting);
+        std::swap(driverBudget, t.driverBudget);
         return *this;
     }
 
-    RAIIvmaBuffer RAIIAllocator::createBuffer(vk::BufferCreateInfo bufferInfo, vma::AllocationCreateInfo allocInfo) {
-        return RAIIvmaBuffer(*dev, vmaAlloc, bufferInfo, allocInfo, *copyHandler);
+    RAIIAllocator::operator vma::Allocator() const {
+        return vmaAlloc;
+    }
+
+    RAIIvmaBuffer RAIIAllocator::createBuffer(vk::BufferCreateInfo bufferInfo, vma::AllocationCreateInfo allocInfo, MemoryCategory category) {
+        return RAIIvmaBuffer(*dev, vmaAlloc, bufferInfo, allocInfo, *copyHandler, accounting.get(), category);
+    }
+    RAIIvmaImage RAIIAllocator::createImage(vk::ImageCreateInfo imageInfo, vma::AllocationCreateInfo allocInfo, vk::ImageAspectFlags aspectFlags, MemoryCategory category) {
+        return RAIIvmaImage(*dev, vmaAlloc, imageInfo, allocInfo, *copyHandler, aspectFlags, accounting.get(), category);
+    }
+
+    void RAIIAllocator::setFrameIndex(uint32_t frameIndex) {
+        vmaAlloc.setCurrentFrameIndex(frameIndex);
+    }
+    MemoryReport RAIIAllocator::report() const {
+        VmaAllocator allocator = static_cast<VmaAllocator>(vmaAlloc);
+        const VkPhysicalDeviceMemoryProperties* properties = nullptr;
+        vmaGetMemoryProperties(allocator, &properties);
+        std::vector<VmaBudget> budgets(properties->memoryHeapCount);
+        vmaGetHeapBudgets(allocator, budgets.data());
+
+        MemoryReport report{.driverBudget = driverBudget};
+        for (uint32_t heap = 0; heap < properties->memoryHeapCount; heap++) {
+            report.heaps.push_back({
+                .deviceLocal = (properties->memoryHeaps[heap].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0,
+                .size = properties->memoryHeaps[heap].size,
+                .usage = budgets[heap].usage,
+                .budget = budgets[heap].budget,
+                .blockBytes = budgets[heap].statistics.blockBytes,
+                .allocationBytes = budgets[heap].statistics.allocationBytes,
+                .allocationCount = budgets[heap].statistics.allocationCount,
+            });
+        }
+        report.categories = accounting->usage();
+        // walks every block, so it isn't something to call each frame
+        VmaTotalStatistics total;
+        vmaCalculateStatistics(allocator, &total);
+        report.fragmentation.unusedBytes = total.total.statistics.blockBytes - total.total.statistics.allocationBytes;
+        report.fragmentation.largestUnusedRange = total.total.unusedRangeCount > 0 ? total.total.unusedRangeSizeMax : 0;
+        report.fragmentation.unusedRangeCount = total.total.unusedRangeCount;
+        return report;
     }
-    RAIIvmaImage RAIIAllocator::createImage(vk::ImageCreateInfo imageInfo, vma::AllocationCreateInfo allocInfo, vk::ImageAspectFlags aspectFlags) {
-        return RAIIvmaImage(*dev, vmaAlloc, imageInfo, allocInfo, *copyHandler, aspectFlags);
+    std::string RAIIAllocator::statsJson(bool detailed) const {
+        VmaAllocator allocator = static_cast<VmaAllocator>(vmaAlloc);
+        char* stats = nullptr;
+        vmaBuildStatsString(allocator, &stats, detailed ? VK_TRUE : VK_FALSE);
+        std::string json(stats);
+        vmaFreeStatsString(allocator, stats);
+        return json;
     }
 }
\ No newline at end of file
@@ -0,0 +1,65 @@
+#include <algorithm>
+#include <iterator>
+#include <optional>
+#include <vector>
+
+#include <range_allocator.hpp>
+
+namespace volchara {
+    RangeAllocator::RangeAllocator(uint32_t capacity) : totalSize(capacity) {
+        if (capacity > 0) freeRanges.push_back({.offset = 0, .size = capacity});
+    }
+
+    std::optional<uint32_t> RangeAllocator::allocate(uint32_t size) {
+        if (size == 0) return 0;
+        for (auto it = freeRanges.begin(); it != freeRanges.end(); it++) {
+            if (it->size < size) continue;
+            uint32_t offset = it->offset;
+            it->offset += size;
+            it->size -= size;
+            if (it->size == 0) freeRanges.erase(it);
+            return offset;
+        }
+        return std::nullopt;
+    }
+
+    void RangeAllocator::release(uint32_t offset, uint32_t size) {
+        if (size == 0) return;
+        auto next = std::lower_bound(freeRanges.begin(), freeRanges.end(), offset, [](const Range& range, uint32_t offset) { return range.offset < offset; });
+        bool mergesPrev = next != freeRanges.begin() && std::prev(next)->offset + std::prev(next)->size == offset;
+        bool mergesNext = next != freeRanges.end() && offset + size == next->offset;
+        if (mergesPrev && mergesNext) {
+            std::prev(next)->size += size + next->size;
+            freeRanges.erase(next);
+        }
+        else if (mergesPrev) {
+            std::prev(next)->size += size;
+        }
+        else if (mergesNext) {
+            next->offset = offset;
+            next->size += size;
+        }
+        else {
+            freeRanges.insert(next, {.offset = offset, .size = size});
+        }
+    }
+
+    uint32_t RangeAllocator::capacity() const {
+        return totalSize;
+    }
+
+    uint32_t RangeAllocator::end() const {
+        if (!freeRanges.empty() && freeRanges.back().offset + freeRanges.back().size == totalSize) {
+            return freeRanges.back().offset;
+        }
+        return totalSize;
+    }
+
+    void RangeAllocator::grow(uint32_t newCapacity) {
+        if (newCapacity <= totalSize) return;
+        uint32_t added = newCapacity - totalSize;
+        uint32_t offset = totalSize;
+        totalSize = newCapacity;
+        release(offset, added);
+    }
+}
@@ -8,25 +8,38 @@
 #include <glm/glm.hpp>
 #include <glm/gtx/transform.hpp>
 
-#include <stb_image.h>
-
 #include <algorithm>
 #include <array>
 #include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
 #include <filesystem>
+#include <initializer_list>
 #include <iostream>
 #include <iterator>
 #include <limits>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
 #include <ratio>
 #include <set>
+#include <span>
 #include <stdexcept>
 #include <string>
+#include <system_error>
 #include <thread>
 #include <utility>
 #include <vector>
 
 #include <renderer.hpp>
+#include <asset_archive.hpp>
+#include <defragmenter.hpp>
 #include <device_buffer_copy_handler.hpp>
+#include <growable_buffer.hpp>
+#include <memory_stats.hpp>
+#include <mesh_cache.hpp>
+#include <model_import.hpp>
 #include <objects.hpp>
 #include <raii_wrappers.hpp>
 #include <resource_path.hpp>
@@ -39,32 +52,149 @@ namespace volchara {
         return p;
     }
 
+    const AssetSource& Renderer::getAssets() {
+        return *assets;
+    }
+
+    JobSystem& Renderer::jobs() {
+        return jobSystem;
+    }
+
     Renderer::Renderer() : camera(*this), ambientLight(*this) {
         init();
     }
 
     void Renderer::init() {
+        createAssetSource();
         initWindow();
         initVulkan();
     }
 
+    void Renderer::createAssetSource() {
+        #ifdef VOLCHARA_RESOURCE_PACK
+        std::filesystem::path archivePath{resourceArchivePath};
+        std::error_code error;
+        // resources outside the pack, e.g. a sample's, are still read from their loose copies
+        if (std::filesystem::exists(archivePath, error)) {
+            assets = std::make_unique<AssetArchive>(archivePath, std::make_unique<LooseFileSource>(getResourceDir()));
+            return;
+        }
+        #endif
+        assets = std::make_unique<LooseFileSource>(getResourceDir());
+    }
+
     void Renderer::run() {
-        mainLoop();
+        startSimulation();
+        try {
+            mainLoop();
+        } catch (...) {
+            stopSimulation();
+            throw;
+        }
+        stopSimulation();
+        if (simulationError) {
+            std::rethrow_exception(simulationError);
+        }
         cleanup();
     }
 
     void Renderer::addObject(volchara::Object* obj) {
         objects.push_back(obj);
-        putObjectsToBuffer();
+        scene.add(obj->entity, COMPONENT_ACTIVE);
+        createInstances(obj);
     }
 
     void Renderer::delObject(volchara::Object* obj) {
         objects.erase(std::find(objects.begin(), objects.end(), obj));
-        putObjectsToBuffer();
+        removeInstances(obj);
+        scene.remove(obj->entity, COMPONENT_ACTIVE);
+        markSceneDirty();
+    }
+
+    void Renderer::createInstances(volchara::Object* obj) {
+        // an object is drawn through its own entity, or through one entity per submesh
+        if (obj->submeshes.empty()) {
+            scene.add(obj->entity, COMPONENT_MESH | COMPONENT_MATERIAL);
+            obj->instances = {obj->entity};
+        }
+        for (const Submesh& submesh : obj->submeshes) {
+            Entity instance = scene.create(DRAWABLE_COMPONENTS);
+            scene.transform(instance) = obj->nodes[submesh.node].slotIndex();
+            obj->instances.push_back(instance);
+        }
+        for (size_t i = 0; i < obj->instances.size(); i++) {
+            Entity instance = obj->instances[i];
+            uint32_t material = obj->submeshes.empty() ? 0 : obj->submeshes[i].material;
+            if (material < obj->materials.size()) {
+                scene.material(instance) = obj->materials[material];
+            }
+            else {
+                scene.material(instance) = {.textureIndex = obj->textureIndex, .color = obj->color};
+            }
+            if (!obj->lods.empty()) scene.add(instance, COMPONENT_LOD);
+        }
+        if (!obj->geometry && obj->meshCache) {
+            const MeshCacheData& cached = obj->meshCache->data;
+            obj->geometry = uploadGeometry(cached.positions, cached.attributes, cached.indices, cached.meshlets);
+            if (!obj->keepGeometry) obj->meshCache.reset();
+        }
+        else if (!obj->geometry && !obj->positions.empty()) {
+            obj->geometry = uploadGeometry(obj->positions, obj->attributes, obj->indices, obj->meshlets);
+            if (!obj->keepGeometry) {
+                std::vector<PositionStream>().swap(obj->positions);
+                std::vector<AttributeStream>().swap(obj->attributes);
+                std::vector<uint32_t>().swap(obj->indices);
+                std::vector<Meshlet>().swap(obj->meshlets);
+            }
+        }
+        updateMeshes(obj);
+        markSceneDirty();
+    }
+
+    void Renderer::removeInstances(volchara::Object* obj) {
+        for (Entity instance : obj->instances) {
+            if (instance != obj->entity) scene.destroy(instance);
+        }
+        obj->instances.clear();
+        // the geometry stays uploaded until the object and its copies are gone, so it can be added again
+        scene.remove(obj->entity, COMPONENT_MESH | COMPONENT_MATERIAL | COMPONENT_LOD);
+    }
+
+    void Renderer::completeAssetLoads() {
+        for (Object* obj : objects) {
+            if (obj->pendingModel && obj->pendingModel->ready()) {
+                auto load = std::exchange(obj->pendingModel, nullptr);
+                try {
+                    // copies of the object share the load, and the last one holding it takes the result
+                    LoadedModel model = load.use_count() == 1 ? std::move(load->result()) : load->result();
+                    removeInstances(obj);
+                    // the loader uploaded it already, so only the allocation and texture indices are swapped in
+                    obj->adoptModel(std::move(model));
+                    createInstances(obj);
+                } catch (const std::exception& e) {
+                    std::cerr << "couldn't load model: " << e.what() << std::endl;
+                }
+                return;
+            }
+            if (obj->pendingTexture && obj->pendingTexture->ready()) {
+                auto load = std::exchange(obj->pendingTexture, nullptr);
+                try {
+                    obj->textureIndex = load->result();
+                    for (Entity instance : obj->instances) {
+                        scene.material(instance).textureIndex = obj->textureIndex;
+                    }
+                    markSceneDirty();
+                } catch (const std::exception& e) {
+                    std::cerr << "couldn't load texture: " << e.what() << std::endl;
+                }
+                return;
+            }
+        }
     }
 
     void Renderer::addLight(volchara::DirectionalLight* l) {
         lights.push_back(l);
+        markSceneDirty();
     }
 
     Plane Renderer::objPlaneFromWorldCoordinates(InitDataPlane vertices) {
@@ -75,6 +205,10 @@ namespace volchara {
         return GLTFModel::fromFile(*this, modelPath);
     }
 
+    GLTFModel Renderer::objGLTFModelFromFileAsync(std::filesystem::path modelPath) {
+        return GLTFModel::fromFileAsync(*this, modelPath);
+    }
+
     Box Renderer::objBoxFromWorldCoordinates(InitDataBox vertices) {
         return Box::fromWorldCoordinates(*this, vertices);
     }
@@ -86,27 +220,265 @@ namespace volchara {
             .brightness = ambientLight.brightness
         };
         ambientLightBuffer.copyFrom(&ubo, sizeof(ubo));
+        markSceneDirty();
     }
 
     DirectionalLight Renderer::objDirectionalLightFromWorldCoordinates(InitDataLight data) {
         return DirectionalLight::fromWorldCoordinates(*this, data);
     }
 
-    void Renderer::putObjectsToBuffer() {
-        std::vector<volchara::Vertex> vertices;
+    void Renderer::setLodPixelError(float pixels) {
+        lodPixelError = pixels;
+    }
+
+    MemoryReport Renderer::memoryReport() {
+        MemoryReport report = allocator.report();
+        FragmentationStats moved = defragmenter.stats();
+        report.fragmentation.passes = moved.passes;
+        report.fragmentation.allocationsMoved = moved.allocationsMoved;
+        report.fragmentation.bytesMoved = moved.bytesMoved;
+        return report;
+    }
+
+    std::string Renderer::memoryStatsJson() {
+        return allocator.statsJson();
+    }
+
+    void Renderer::markSceneDirty() {
+        sceneGeneration++;
+        drawGeneration++;
+    }
+
+    void Renderer::markDrawsDirty() {
+        drawGeneration++;
+    }
+
+    std::shared_ptr<GeometryAllocation> Renderer::uploadGeometry(std::span<const PositionStream> positions, std::span<const AttributeStream> attributes,
+            std::span<const uint32_t> indices, std::span<const Meshlet> meshlets) {
+        std::shared_ptr<GeometryAllocation> geometry = newGeometry(positions, attributes, indices, meshlets);
+        std::lock_guard<std::mutex> uploadLock(uploadMutex);
+        while (true) {
+            {
+                std::lock_guard<std::mutex> queueLock(queueMutex);
+                if (allocateGeometryRanges(*geometry)) break;
+            }
+            growGeometryBuffers(*geometry);
+        }
+        streamGeometry(*geometry, positions, attributes, indices, meshlets);
+        return geometry;
+    }
+
+    std::shared_ptr<GeometryAllocation> Renderer::uploadLoadedGeometry(std::span<const PositionStream> positions, std::span<const AttributeStream> attributes,
+            std::span<const uint32_t> indices, std::span<const Meshlet> meshlets) {
+        std::shared_ptr<GeometryAllocation> geometry = newGeometry(positions, attributes, indices, meshlets);
+        while (true) {
+            {
+                std::lock_guard<std::mutex> queueLock(queueMutex);
+                if (allocateGeometryRanges(*geometry)) break;
+            }
+            // the render thread records with the buffers growing replaces
+            std::lock_guard<std::mutex> sceneLock(sceneMutex);
+            std::lock_guard<std::mutex> uploadLock(uploadMutex);
+            growGeometryBuffers(*geometry);
+        }
+        std::lock_guard<std::mutex> uploadLock(uploadMutex);
+        streamGeometry(*geometry, positions, attributes, indices, meshlets);
+        return geometry;
+    }
+
+    std::shared_ptr<GeometryAllocation> Renderer::newGeometry(std::span<const PositionStream> positions, std::span<const AttributeStream> attributes,
+            std::span<const uint32_t> indices, std::span<const Meshlet> meshlets) {
+        if (positions.size() != attributes.size()) {
+            throw std::runtime_error("vertex streams differ in length!");
+        }
+        auto geometry = std::make_shared<GeometryAllocation>();
+        geometry->vertexCount = static_cast<uint32_t>(positions.size());
+        geometry->indexCount = static_cast<uint32_t>(indices.size());
+        geometry->meshletCount = static_cast<uint32_t>(meshlets.size());
+        return geometry;
+    }
+
+    bool Renderer::allocateGeometryRanges(GeometryAllocation& geometry) {
+        std::optional<uint32_t> firstVertex = vertexRanges.allocate(geometry.vertexCount);
+        std::optional<uint32_t> firstIndex = indexRanges.allocate(geometry.indexCount);
+        std::optional<uint32_t> firstMeshlet = meshletRanges.allocate(geometry.meshletCount);
+        if (!firstVertex || !firstIndex || !firstMeshlet) {
+            if (firstVertex) vertexRanges.release(*firstVertex, geometry.vertexCount);
+            if (firstIndex) indexRanges.release(*firstIndex, geometry.indexCount);
+            if (firstMeshlet) meshletRanges.release(*firstMeshlet, geometry.meshletCount);
+            return false;
+        }
+        // from here on the ranges are released with the allocation
+        geometry.renderer = this;
+        geometry.firstVertex = *firstVertex;
+        geometry.firstIndex = *firstIndex;
+        geometry.firstMeshlet = *firstMeshlet;
+        return true;
+    }
+
+    void Renderer::growGeometryBuffers(const GeometryAllocation& geometry) {
+        // vertexOffset is signed, and the storage buffers can't be bound past maxStorageBufferRange
+        uint64_t maxStorageRange = physicalDeviceProperties.limits.maxStorageBufferRange;
+        if (!growGeometryBuffer(vertexRanges, {&positionBuffer, &attributeBuffer}, geometry.vertexCount, std::numeric_limits<int32_t>::max())
+                || !growGeometryBuffer(indexRanges, {&indexBuffer}, geometry.indexCount, maxStorageRange / sizeof(uint32_t))
+                || !growGeometryBuffer(meshletRanges, {&meshletBuffer}, geometry.meshletCount, maxStorageRange / sizeof(Meshlet))) {
+            throw std::runtime_error("geometry buffers are full!");
+        }
+        // the grown buffers are drawn from as soon as the scene lock is released
+        stagingRing.finish();
+    }
+
+    bool Renderer::growGeometryBuffer(RangeAllocator& ranges, std::initializer_list<GrowableBuffer*> buffers, uint32_t count, uint64_t maxCapacity) {
+        uint32_t used;
+        uint64_t capacity;
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            // whatever is free past the last allocated range fits the geometry
+            uint64_t needed = static_cast<uint64_t>(ranges.end()) + count;
+            if (needed <= ranges.capacity()) return true;
+            capacity = std::max<uint64_t>(ranges.capacity(), 1) * 2;
+            while (capacity < needed) capacity *= 2;
+            capacity = std::min(capacity, maxCapacity);
+            if (capacity < needed) return false;
+            used = ranges.end();
+        }
+        // the queue lock is free while the ring copies, as it may submit to the graphics queue; ranges allocated meanwhile
+        // past `used` are only written once the upload lock is released
+        std::vector<RAIIvmaBuffer> replaced;
+        for (GrowableBuffer* buffer : buffers) {
+            // only the allocated prefix is copied
+            replaced.push_back(buffer->grow(static_cast<uint32_t>(capacity), used, stagingRing));
+        }
+        std::lock_guard<std::mutex> lock(queueMutex);
+        for (RAIIvmaBuffer& buffer : replaced) {
+            retiredBuffers.push_back({
+                .buffer = std::move(buffer),
+                .frame = submittedFrames,
+            });
+        }
+        ranges.grow(static_cast<uint32_t>(capacity));
+        // recorded command buffers and the culling descriptors still point at the old buffers
+        geometryBufferGeneration++;
+        markSceneDirty();
+        return true;
+    }
+
+    void Renderer::streamGeometry(const GeometryAllocation& geometry, std::span<const PositionStream> positions, std::span<const AttributeStream> attributes,
+            std::span<const uint32_t> indices, std::span<const Meshlet> meshlets) {
+        uint32_t firstIndex = geometry.firstIndex;
+        // streamed a slot at a time, so a mapped mesh cache is read in while the previous chunk copies
+        stagingRing.upload(positionBuffer, geometry.firstVertex * sizeof(PositionStream), positions);
+        stagingRing.upload(attributeBuffer, geometry.firstVertex * sizeof(AttributeStream), attributes);
+        // indices stay relative to the mesh and are offset by the draw's vertexOffset
+        stagingRing.upload(indexBuffer, firstIndex * sizeof(uint32_t), indices);
+        // the culling pass reads the indices straight from the shared index buffer
+        stagingRing.upload(meshletBuffer, geometry.firstMeshlet * sizeof(Meshlet), sizeof(Meshlet), meshlets.size(), [&](std::byte* out, size_t first, size_t count) {
+            std::memcpy(out, meshlets.data() + first, count * sizeof(Meshlet));
+            Meshlet* placed = reinterpret_cast<Meshlet*>(out);
+            for (size_t i = 0; i < count; i++) {
+                placed[i].firstIndex += firstIndex;
+            }
+        });
+        // the ring's fences, so nothing else waits for the copies
+        stagingRing.finish();
+    }
+
+    void Renderer::createPlaceholderGeometry() {
+        std::vector<PositionStream> positions;
+        std::vector<AttributeStream> attributes;
         std::vector<uint32_t> indices;
-        uint32_t indexOffset = 0;
-        for (volchara::Object* obj : objects) {
-            if (!obj->vertices.empty()) {
-                vertices.insert(vertices.end(), obj->vertices.begin(), obj->vertices.end());
-                std::transform(obj->indices.begin(), obj->indices.end(), std::back_inserter(indices), [indexOffset](uint32_t index){return index + indexOffset;});
-                indexOffset += obj->maxVertexIndex + 1;
+        // each face gets its own corners, so it has its own normal and the whole texture
+        for (int axis = 0; axis < 3; axis++) {
+            for (float side : {-1.0f, 1.0f}) {
+                glm::vec3 normal(0.0f), u(0.0f), v(0.0f);
+                normal[axis] = side;
+                u[(axis + 1) % 3] = 0.5f;
+                v[(axis + 2) % 3] = 0.5f;
+                uint32_t first = static_cast<uint32_t>(positions.size());
+                for (glm::vec2 corner : {glm::vec2(0, 0), glm::vec2(1, 0), glm::vec2(1, 1), glm::vec2(0, 1)}) {
+                    positions.push_back(packPosition(normal * 0.5f + u * (corner.x * 2 - 1) + v * (corner.y * 2 - 1)));
+                    attributes.push_back(packAttributes(normal, corner));
+                }
+                // counter-clockwise seen from outside
+                if (side > 0) indices.insert(indices.end(), {first, first + 1, first + 2, first, first + 2, first + 3});
+                else indices.insert(indices.end(), {first, first + 2, first + 1, first, first + 3, first + 2});
             }
         }
-        stagingBuffer.copyFrom(vertices.data(), (size_t)(vertices.size() * sizeof(volchara::Vertex)));
-        vertexBuffer.copyFrom(stagingBuffer.allocInfo().pMappedData, 8388608);
-        stagingBuffer.copyFrom(indices.data(), (size_t)(indices.size() * sizeof(uint32_t)));
-        indexBuffer.copyFrom(stagingBuffer.allocInfo().pMappedData, 8388608);
+        placeholder = uploadGeometry(positions, attributes, indices, {});
+    }
+
+    std::shared_ptr<GeometryAllocation> Renderer::placeholderGeometry() const {
+        return placeholder;
+    }
+
+    void Renderer::releaseRetiredBuffers() {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        // a buffer replaced during frame N may be read by N itself, which has retired once its fence was waited for
+        while (!retiredBuffers.empty() && retiredBuffers.front().frame + MAX_FRAMES_IN_FLIGHT <= submittedFrames) {
+            retiredBuffers.pop_front();
+        }
+        // the same goes for a freed range
+        while (!retiredRanges.empty() && retiredRanges.front().frame + MAX_FRAMES_IN_FLIGHT <= submittedFrames) {
+            const RetiredRanges& ranges = retiredRanges.front();
+            vertexRanges.release(ranges.firstVertex, ranges.vertexCount);
+            indexRanges.release(ranges.firstIndex, ranges.indexCount);
+            meshletRanges.release(ranges.firstMeshlet, ranges.meshletCount);
+            retiredRanges.pop_front();
+        }
+    }
+
+    void Renderer::releaseGeometry(const GeometryAllocation& geometry) {
+        // frames in flight may still draw from the ranges, so they are only reused once those have retired
+        std::lock_guard<std::mutex> lock(queueMutex);
+        retiredRanges.push_back({
+            .firstVertex = geometry.firstVertex,
+            .vertexCount = geometry.vertexCount,
+            .firstIndex = geometry.firstIndex,
+            .indexCount = geometry.indexCount,
+            .firstMeshlet = geometry.firstMeshlet,
+            .meshletCount = geometry.meshletCount,
+            .frame = submittedFrames,
+        });
+    }
+
+    void Renderer::updateMeshes(Object* obj) {
+        GeometryAllocation* geometry = obj->geometry.get();
+        uint32_t firstIndex = geometry ? geometry->firstIndex : 0;
+        int32_t vertexOffset = geometry ? static_cast<int32_t>(geometry->firstVertex) : 0;
+        uint32_t firstMeshlet = geometry ? geometry->firstMeshlet : 0;
+        if (obj->submeshes.empty()) {
+            scene.mesh(obj->entity) = {
+                .firstIndex = firstIndex,
+                .indexCount = geometry ? geometry->indexCount : 0,
+                .vertexOffset = vertexOffset,
+                .firstMeshlet = firstMeshlet,
+                .meshletCount = geometry ? geometry->meshletCount : 0,
+            };
+        }
+        for (size_t s = 0; s < obj->submeshes.size(); s++) {
+            scene.mesh(obj->instances[s]) = {
+                .firstIndex = firstIndex + obj->submeshes[s].firstIndex,
+                .indexCount = obj->submeshes[s].indexCount,
+                .vertexOffset = vertexOffset,
+                .firstMeshlet = firstMeshlet + obj->submeshes[s].firstMeshlet,
+                .meshletCount = geometry && geometry->meshletCount > 0 ? obj->submeshes[s].meshletCount : 0,
+            };
+        }
+        // LOD ranges follow the full mesh's indices in the same allocation
+        for (size_t i = 0; i < obj->lods.size() && i < obj->instances.size(); i++) {
+            LodChain& chain = scene.lod(obj->instances[i]);
+            chain = obj->lods[i];
+            for (uint32_t level = 0; level < chain.levelCount; level++) {
+                chain.levels[level].firstIndex += firstIndex;
+            }
+            MeshRef& mesh = scene.mesh(obj->instances[i]);
+            chain.levels[0].firstMeshlet = mesh.firstMeshlet;
+            chain.levels[0].meshletCount = mesh.meshletCount;
+            mesh.firstIndex = chain.levels[chain.current].firstIndex;
+            mesh.indexCount = chain.levels[chain.current].indexCount;
+            mesh.firstMeshlet = chain.levels[chain.current].firstMeshlet;
+            mesh.meshletCount = chain.levels[chain.current].meshletCount;
+        }
     }
 
     void Renderer::putLightToBuffer() {
@@ -146,21 +518,24 @@ namespace volchara {
         createRenderPass();
         createDescriptorSetLayout();
         createGraphicsPipeline();
+        createMeshletCullPipeline();
         createCommandPool();
-        createStagingBuffer();
         createVertexBuffer();
         createIndexBuffer();
         createUniformBuffers();
-        createSSBOBuffer();
+        createObjectDataBuffers();
+        createMeshletBuffers();
+        createPlaceholderGeometry();
         createDepthResources();
         createNormalResources();
         createIntermediateColorResources();
         createFramebuffers();
-        uint32_t lisa = createTextureImage(getResourceDir() / "textures/uv.png");
+        uint32_t lisa = createTextureImage(assets->open("textures/uv.png").span());
         createDescriptorPool();
         createDescriptorSets();
         loadTextureToDescriptors(lisa);
         createCommandBuffers();
+        createSecondaryCommandBuffers();
         createSyncObjects();
     }
 
@@ -169,7 +544,107 @@ namespace volchara {
             glfwPollEvents();
             drawFrame();
         }
+        std::lock_guard<std::mutex> lock(queueMutex);
         device.waitIdle();
+        #ifdef VOLCHARA_MEMORY_STATS
+        std::clog << describeMemoryReport(memoryReport());
+        #endif
+    }
+
+    void Renderer::startSimulation() {
+        auto now = std::chrono::steady_clock::now();
+        publishSnapshot(now);
+        publishSnapshot(now);
+        simulationRunning = true;
+        simulationThread = std::thread(&Renderer::simulationLoop, this);
+    }
+
+    void Renderer::stopSimulation() {
+        simulationRunning = false;
+        if (simulationThread.joinable()) {
+            simulationThread.join();
+        }
+    }
+
+    void Renderer::simulationLoop() {
+        const float tickSeconds = 1.0f / SIMULATION_TICK_RATE;
+        const auto tick = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<float>(tickSeconds));
+        auto nextTick = std::chrono::steady_clock::now() + tick;
+        try {
+            while (simulationRunning) {
+                std::this_thread::sleep_until(nextTick);
+                processInputEvents();
+                runParallelFrameCallbacks(tickSeconds);
+                updateCameraPosition(tickSeconds);
+                {
+                    // serial callbacks and swapped-in loads change the scene, which the render thread only reads
+                    // with its matching snapshot
+                    std::lock_guard<std::mutex> lock(sceneMutex);
+                    runSerialFrameCallbacks(tickSeconds);
+                    completeAssetLoads();
+                    publishSnapshot(nextTick);
+                }
+                if (input.isDown(GLFW_KEY_ESCAPE)) shouldExit = true;
+
+                nextTick += tick;
+                auto now = std::chrono::steady_clock::now();
+                if (now - nextTick > tick * MAX_SIMULATION_CATCHUP_TICKS) {
+                    nextTick = now;
+                }
+            }
+        } catch (...) {
+            simulationError = std::current_exception();
+            shouldExit = true;
+        }
+    }
+
+    void Renderer::processInputEvents() {
+        input.beginTick();
+        InputEvent event;
+        while (inputEvents.pop(event)) {
+            switch (event.type) {
+                case InputEvent::Type::Key:
+                    if (event.action == GLFW_PRESS) {
+                        input.press(event.key);
+                    }
+                    else {
+                        input.release(event.key);
+                    }
+                    break;
+                case InputEvent::Type::CursorMove:
+                    input.moveCursor(event.cursorDelta);
+                    break;
+            }
+        }
+    }
+
+    void Renderer::publishSnapshot(std::chrono::steady_clock::time_point time) {
+        nextSnapshot.tick = ++simulationTick;
+        nextSnapshot.time = time;
+        nextSnapshot.camera = camera.transform.state();
+        nextSnapshot.transforms.resize(transforms.size());
+        nextSnapshot.moved.resize(transforms.size());
+        for (uint32_t slot = 0; slot < transforms.size(); slot++) {
+            nextSnapshot.transforms[slot] = transforms.get(slot);
+            nextSnapshot.moved[slot] = transforms.isDirty(slot);
+            transforms.clearDirty(slot);
+        }
+        if (nextSnapshot.hierarchyGeneration != transforms.hierarchyGeneration()) {
+            nextSnapshot.parents = transforms.parentSlots();
+            nextSnapshot.hierarchyGeneration = transforms.hierarchyGeneration();
+        }
+        size_t drawnCount = scene.count(DRAWABLE_COMPONENTS);
+        nextSnapshot.instanceSlots.resize(drawnCount + lights.size());
+        scene.forEach(DRAWABLE_COMPONENTS, [&](Archetype& archetype, size_t first) {
+            std::copy(archetype.transforms.begin(), archetype.transforms.end(), nextSnapshot.instanceSlots.begin() + first);
+        });
+        for (size_t i = 0; i < lights.size(); i++) {
+            nextSnapshot.instanceSlots[drawnCount + i] = lights[i]->transform.slotIndex();
+        }
+        // previous <- current <- next, the oldest buffer is refilled next tick
+        std::lock_guard<std::mutex> lock(snapshotMutex);
+        std::swap(previousSnapshot, currentSnapshot);
+        std::swap(currentSnapshot, nextSnapshot);
     }
 
     void Renderer::cleanup() {
@@ -268,21 +743,31 @@ namespace volchara {
             uint32_t ind = static_cast<uint32_t>(std::distance(q.begin(), bothIter));
             indices.graphicsFamily = ind;
             indices.presentFamily = ind;
-            return indices;
         }
-
-        auto graphicsIter = std::find_if(q.begin(), q.end(), [&device, &surface = surface](vk::QueueFamilyProperties const &qfp) { return qfp.queueFlags & vk::QueueFlagBits::eGraphics; });
-        if (graphicsIter != q.end()) {
-            uint32_t ind = static_cast<uint32_t>(std::distance(q.begin(), graphicsIter));
-            indices.graphicsFamily = ind;
-        }
-        auto presentIter = std::find_if(q.begin(), q.end(), [&device, &surface = surface](vk::QueueFamilyProperties const &qfp) { return device.getSurfaceSupportKHR(0, surface); });
-        if (presentIter != q.end()) {
-            uint32_t ind = static_cast<uint32_t>(std::distance(q.begin(), presentIter));
-            indices.presentFamily = ind;
+        else {
+            auto graphicsIter = std::find_if(q.begin(), q.end(), [&device, &surface = surface](vk::QueueFamilyProperties const &qfp) { return qfp.queueFlags & vk::QueueFlagBits::eGraphics; });
+            if (graphicsIter != q.end()) {
+                uint32_t ind = static_cast<uint32_t>(std::distance(q.begin(), graphicsIter));
+                indices.graphicsFamily = ind;
+            }
+            auto presentIter = std::find_if(q.begin(), q.end(), [&device, &surface = surface](vk::QueueFamilyProperties const &qfp) { return device.getSurfaceSupportKHR(0, surface); });
+            if (presentIter != q.end()) {
+                uint32_t ind = static_cast<uint32_t>(std::distance(q.begin(), presentIter));
+                indices.presentFamily = ind;
+            }
         }
 
         if (!indices.isComplete()) throw std::runtime_error("Suitable queues not found");
+
+        // a transfer-only family is usually a copy engine, which uploads without holding up rendering
+        auto transferIter = std::find_if(q.begin(), q.end(), [](vk::QueueFamilyProperties const &qfp) { return qfp.queueFlags & vk::QueueFlagBits::eTransfer && !(qfp.queueFlags & (vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute)); });
+        if (transferIter != q.end()) {
+            indices.transferFamily = static_cast<uint32_t>(std::distance(q.begin(), transferIter));
+        }
+        else {
+            indices.transferFamily = indices.graphicsFamily;
+            indices.transferQueueIndex = q[indices.graphicsFamily.value()].queueCount > 1 ? 1 : 0;
+        }
         return indices;
     }
 
@@ -342,21 +827,32 @@ namespace volchara {
         QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
 
         std::vector<vk::DeviceQueueCreateInfo> queueCreateInfos;
-        std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily.value(), indices.presentFamily.value()};
-        const std::vector<float_t> queuePriorities { 1.0f };
+        std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily.value(), indices.presentFamily.value(), indices.transferFamily.value()};
+        const std::vector<float_t> queuePriorities { 1.0f, 1.0f };
 
-        float queuePriority = 1.0f;
         for (uint32_t queueFamily : uniqueQueueFamilies) {
+            uint32_t queueCount = queueFamily == indices.transferFamily.value() ? indices.transferQueueIndex + 1 : 1;
             vk::DeviceQueueCreateInfo queueCreateInfo{
                 .queueFamilyIndex = queueFamily,
-                .queueCount = static_cast<uint32_t>(queuePriorities.size()),
+                .queueCount = queueCount,
                 .pQueuePriorities = queuePriorities.data(),
             };
             queueCreateInfos.push_back(queueCreateInfo);
         }
 
+        std::vector<const char*> extensions = deviceExtensions;
+        std::vector<vk::ExtensionProperties> availableExtensions = physicalDevice.enumerateDeviceExtensionProperties();
+        memoryBudgetSupported = std::any_of(availableExtensions.begin(), availableExtensions.end(), [](const vk::ExtensionProperties& extension) {
+            return strcmp(extension.extensionName, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == 0;
+        });
+        if (memoryBudgetSupported) {
+            extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+        }
+
         const std::vector<const char *> empty;
         vk::PhysicalDeviceFeatures reqDevFeatures{
+            .multiDrawIndirect = true,
+            .drawIndirectFirstInstance = true,
             .samplerAnisotropy = true,
         };
         vk::PhysicalDeviceDescriptorIndexingFeaturesEXT reqDevDescrFeatures{
@@ -371,14 +867,17 @@ namespace volchara {
             .pQueueCreateInfos = queueCreateInfos.data(),
             .enabledLayerCount = static_cast<uint32_t>((enableValidationLayers) ? 1 : 0),
             .ppEnabledLayerNames = (enableValidationLayers) ? validationLayers.data() : nullptr,
-            .enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size()),
-            .ppEnabledExtensionNames = deviceExtensions.data(),
+            .enabledExtensionCount = static_cast<uint32_t>(extensions.size()),
+            .ppEnabledExtensionNames = extensions.data(),
             .pEnabledFeatures = &reqDevFeatures,
         };
 
         device = physicalDevice.createDevice(createInfo);
         graphicsQueue = device.getQueue(indices.graphicsFamily.value(), 0);
         presentQueue = device.getQueue(indices.presentFamily.value(), 0);
+        if (indices.transferFamily != indices.graphicsFamily) {
+            uploadQueueFamilies = {indices.graphicsFamily.value(), indices.transferFamily.value()};
+        }
     }
 
     void Renderer::createBufferCopyHandler() {
@@ -387,7 +886,62 @@ namespace volchara {
     }
 
     void Renderer::createMemoryAllocator() {
-        allocator = RAIIAllocator(instance, physicalDevice, device, deviceBufferCopyHandler);
+        allocator = RAIIAllocator(instance, physicalDevice, device, deviceBufferCopyHandler, memoryBudgetSupported);
+        QueueFamilyIndices queueFamilyIndices = findQueueFamilies(physicalDevice);
+        // the graphics queue itself when it is the only one, which frames are submitted to under queueMutex
+        bool sharedQueue = queueFamilyIndices.transferFamily == queueFamilyIndices.graphicsFamily && queueFamilyIndices.transferQueueIndex == 0;
+        stagingRing = StagingRing(device, allocator, queueFamilyIndices.transferFamily.value(), stagingSlotSize, stagingSlotCount,
+            queueFamilyIndices.transferQueueIndex, sharedQueue ? &queueMutex : nullptr);
+        defragmenter = Defragmenter(device, allocator, queueFamilyIndices.graphicsFamily.value(), DEFRAGMENTATION_MAX_MOVES_PER_PASS, DEFRAGMENTATION_MAX_BYTES_PER_PASS);
+        lastMemoryBudgetCheck = std::chrono::steady_clock::now();
+    }
+
+    void Renderer::checkMemoryBudget() {
+        MemoryReport report = allocator.report();
+        heapsNearBudget.resize(report.heaps.size(), false);
+        for (size_t heap = 0; heap < report.heaps.size(); heap++) {
+            const HeapUsage& usage = report.heaps[heap];
+            if (usage.budget == 0) continue;
+            float used = static_cast<float>(usage.usage) / static_cast<float>(usage.budget);
+            if (!heapsNearBudget[heap] && used > MEMORY_BUDGET_WARNING) {
+                heapsNearBudget[heap] = true;
+                std::cerr << "memory heap " << heap << " is near its budget: "
+                    << usage.usage / (1024 * 1024) << " of " << usage.budget / (1024 * 1024) << " MB used" << std::endl;
+            }
+            else if (heapsNearBudget[heap] && used < MEMORY_BUDGET_WARNING_RESET) {
+                heapsNearBudget[heap] = false;
+            }
+        }
+        const FragmentationStats& fragmentation = report.fragmentation;
+        if (!defragmenter.active() && fragmentation.unusedBytes > DEFRAGMENTATION_MIN_UNUSED_BYTES && fragmentation.fragmentation() > DEFRAGMENTATION_THRESHOLD) {
+            // geometry and textures are only allocated and freed under the queue lock
+            std::lock_guard<std::mutex> lock(queueMutex);
+            defragmenter.begin();
+        }
+    }
+
+    bool Renderer::defragmentStep() {
+        if (!defragmenter.active()) return false;
+        std::lock_guard<std::mutex> sceneLock(sceneMutex);
+        // an upload streaming into a geometry buffer would be lost by the moved copy; the pass runs at the next chance
+        std::unique_lock<std::mutex> uploadLock(uploadMutex, std::try_to_lock);
+        if (!uploadLock.owns_lock()) return false;
+        std::lock_guard<std::mutex> queueLock(queueMutex);
+        // the moved resources' old copies are destroyed within the pass, once the frames on the graphics queue that may
+        // read them have finished; the defragmenter submits to that queue, so its fence covers them
+        defragmentationPassesThisFrame++;
+        std::array<RAIIvmaBuffer*, 4> buffers{&positionBuffer.deviceBuffer(), &attributeBuffer.deviceBuffer(), &indexBuffer.deviceBuffer(), &meshletBuffer.deviceBuffer()};
+        bool buffersMoved = false;
+        bool more = defragmenter.step(buffers, textures, buffersMoved, movedTextures);
+        for (uint32_t texture : movedTextures) {
+            loadTextureToDescriptors(texture);
+        }
+        if (buffersMoved) {
+            // recorded like after the buffers grew
+            geometryBufferGeneration++;
+            markSceneDirty();
+        }
+        return more;
     }
 
     void Renderer::createTextureSampler() {
@@ -634,7 +1188,7 @@ namespace volchara {
             .binding = 0,
             .descriptorType = vk::DescriptorType::eUniformBuffer,
             .descriptorCount = 1,
-            .stageFlags = vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment,
+            .stageFlags = vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment | vk::ShaderStageFlagBits::eCompute,
         };
         std::vector<vk::DescriptorSetLayoutBinding> uboBindings{uboLayoutBinding};
         vk::DescriptorSetLayoutCreateInfo ubolayoutInfo{
@@ -675,7 +1229,13 @@ namespace volchara {
             .descriptorCount = 1,
             .stageFlags = vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment,
         };
-        std::vector<vk::DescriptorSetLayoutBinding> ssboBindings{ssboLayoutBinding};
+        vk::DescriptorSetLayoutBinding modelMatrixLayoutBinding{
+            .binding = 1,
+            .descriptorType = vk::DescriptorType::eStorageBuffer,
+            .descriptorCount = 1,
+            .stageFlags = vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment | vk::ShaderStageFlagBits::eCompute,
+        };
+        std::vector<vk::DescriptorSetLayoutBinding> ssboBindings{ssboLayoutBinding, modelMatrixLayoutBinding};
         vk::DescriptorSetLayoutCreateInfo ssbolayoutInfo{
             .bindingCount = static_cast<uint32_t>(ssboBindings.size()),
             .pBindings = ssboBindings.data(),
@@ -732,9 +1292,25 @@ namespace volchara {
             .pBindings = lightSubpassLayoutBindings.data(),
         };
         descriptorSetLayoutLightSubpass = device.createDescriptorSetLayout(lightSubpassLayoutInfo);
+
+        // meshlets, cull jobs, source indices, draw commands, culled indices, dispatch
+        std::vector<vk::DescriptorSetLayoutBinding> meshletCullBindings;
+        for (uint32_t binding = 0; binding < 6; binding++) {
+            meshletCullBindings.push_back({
+                .binding = binding,
+                .descriptorType = vk::DescriptorType::eStorageBuffer,
+                .descriptorCount = 1,
+                .stageFlags = vk::ShaderStageFlagBits::eCompute,
+            });
+        }
+        vk::DescriptorSetLayoutCreateInfo meshletCullLayoutInfo{
+            .bindingCount = static_cast<uint32_t>(meshletCullBindings.size()),
+            .pBindings = meshletCullBindings.data(),
+        };
+        descriptorSetLayoutMeshletCull = device.createDescriptorSetLayout(meshletCullLayoutInfo);
     }
 
-    vk::raii::ShaderModule Renderer::createShaderModule(const std::vector<char *>& code) {
+    vk::raii::ShaderModule Renderer::createShaderModule(std::span<const std::byte> code) {
         vk::ShaderModuleCreateInfo createInfo{
             .codeSize = code.size(),
             .pCode = reinterpret_cast<const uint32_t *>(code.data()),
@@ -744,11 +1320,11 @@ namespace volchara {
     }
 
     void Renderer::createGraphicsPipeline() {
-        auto vertShaderCode = readFile(getResourceDir() / "shaders/base.vert.spv");
-        auto fragShaderCode = readFile(getResourceDir() / "shaders/base.frag.spv");
+        Asset vertShaderCode = assets->open("shaders/base.vert.spv");
+        Asset fragShaderCode = assets->open("shaders/base.frag.spv");
 
-        vk::raii::ShaderModule vertShaderModule = createShaderModule(vertShaderCode);
-        vk::raii::ShaderModule fragShaderModule = createShaderModule(fragShaderCode);
+        vk::raii::ShaderModule vertShaderModule = createShaderModule(vertShaderCode.span());
+        vk::raii::ShaderModule fragShaderModule = createShaderModule(fragShaderCode.span());
 
         vk::PipelineShaderStageCreateInfo vertShaderStageInfo{
             .stage = vk::ShaderStageFlagBits::eVertex,
@@ -764,7 +1340,7 @@ namespace volchara {
 
         std::vector<vk::PipelineShaderStageCreateInfo> shaderStages = {vertShaderStageInfo, fragShaderStageInfo};
 
-        std::vector<vk::VertexInputBindingDescription> inputBindings = std::vector{Vertex::getBindingDescription()};
+        std::vector<vk::VertexInputBindingDescription> inputBindings = Vertex::getBindingDescriptions();
         std::vector<vk::VertexInputAttributeDescription> inputAttributes = Vertex::getAttributeDescriptions();
         vk::PipelineVertexInputStateCreateInfo vertexInputInfo{
             .vertexBindingDescriptionCount = static_cast<uint32_t>(inputBindings.size()),
@@ -852,10 +1428,10 @@ namespace volchara {
 
         colorGraphicsPipeline = device.createGraphicsPipeline(nullptr, colorPipelineInfo);
 
-        auto lightVertShaderCode = readFile(getResourceDir() / "shaders/light.vert.spv");
-        auto lightFragShaderCode = readFile(getResourceDir() / "shaders/light.frag.spv");
-        vk::raii::ShaderModule lightVertShaderModule = createShaderModule(lightVertShaderCode);
-        vk::raii::ShaderModule lightFragShaderModule = createShaderModule(lightFragShaderCode);
+        Asset lightVertShaderCode = assets->open("shaders/light.vert.spv");
+        Asset lightFragShaderCode = assets->open("shaders/light.frag.spv");
+        vk::raii::ShaderModule lightVertShaderModule = createShaderModule(lightVertShaderCode.span());
+        vk::raii::ShaderModule lightFragShaderModule = createShaderModule(lightFragShaderCode.span());
         vk::PipelineShaderStageCreateInfo lightVertShaderStageInfo{
             .stage = vk::ShaderStageFlagBits::eVertex,
             .module = lightVertShaderModule,
@@ -889,7 +1465,7 @@ namespace volchara {
             .pAttachments = lightColorBlendAttachments.data(),
         };
 
-        std::vector<vk::DescriptorSetLayout> lightDescriptorSets = {*descriptorSetLayoutLightSubpass, *descriptorSetLayoutUBO};
+        std::vector<vk::DescriptorSetLayout> lightDescriptorSets = {*descriptorSetLayoutLightSubpass, *descriptorSetLayoutUBO, *descriptorSetLayoutSSBO};
         vk::PipelineLayoutCreateInfo lightPipelineLayoutInfo{
             .setLayoutCount = static_cast<uint32_t>(lightDescriptorSets.size()),
             .pSetLayouts = lightDescriptorSets.data(),
@@ -918,6 +1494,28 @@ namespace volchara {
         lightGraphicsPipeline = device.createGraphicsPipeline(nullptr, lightPipelineInfo);
     }
 
+    void Renderer::createMeshletCullPipeline() {
+        Asset compShaderCode = assets->open("shaders/cull_meshlets.comp.spv");
+        vk::raii::ShaderModule compShaderModule = createShaderModule(compShaderCode.span());
+
+        std::vector<vk::DescriptorSetLayout> descriptorSets = {*descriptorSetLayoutUBO, *descriptorSetLayoutSSBO, *descriptorSetLayoutMeshletCull};
+        vk::PipelineLayoutCreateInfo pipelineLayoutInfo{
+            .setLayoutCount = static_cast<uint32_t>(descriptorSets.size()),
+            .pSetLayouts = descriptorSets.data(),
+        };
+        meshletCullPipelineLayout = device.createPipelineLayout(pipelineLayoutInfo);
+
+        vk::ComputePipelineCreateInfo pipelineInfo{
+            .stage = {
+                .stage = vk::ShaderStageFlagBits::eCompute,
+                .module = compShaderModule,
+                .pName = "main",
+            },
+            .layout = meshletCullPipelineLayout,
+        };
+        meshletCullPipeline = device.createComputePipeline(nullptr, pipelineInfo);
+    }
+
     void Renderer::createCommandPool() {
         QueueFamilyIndices queueFamilyIndices = findQueueFamilies(physicalDevice);
 
@@ -929,42 +1527,15 @@ namespace volchara {
         commandPool = device.createCommandPool(poolInfo);
     }
 
-    void Renderer::createStagingBuffer() {
-        vk::BufferCreateInfo bufferInfo{
-            .size = 8388608, // 8MB //vertices.size() * sizeof(Vertex) //indices.size() * sizeof(uint32_t),
-            .usage = vk::BufferUsageFlagBits::eTransferSrc,
-            .sharingMode = vk::SharingMode::eExclusive,
-        };
-        vma::AllocationCreateInfo allocInfo{
-            .flags = vma::AllocationCreateFlagBits::eHostAccessSequentialWrite | vma::AllocationCreateFlagBits::eMapped,
-            .usage = vma::MemoryUsage::eAuto,
-        };
-        stagingBuffer = allocator.createBuffer(bufferInfo, allocInfo);
-    }
-
     void Renderer::createVertexBuffer() {
-        vk::BufferCreateInfo bufferInfo{
-            .size = 8388608, // 8MB //vertices.size() * sizeof(Vertex)
-            .usage = vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferDst,
-            .sharingMode = vk::SharingMode::eExclusive,
-        };
-        // vertexBuffer = device.createBuffer(bufferInfo);
-        vma::AllocationCreateInfo allocInfo{
-            .usage = vma::MemoryUsage::eAuto,
-        };
-        vertexBuffer = allocator.createBuffer(bufferInfo, allocInfo);
+        positionBuffer = GrowableBuffer(allocator, sizeof(PositionStream), INITIAL_GEOMETRY_VERTEX_CAPACITY, vk::BufferUsageFlagBits::eVertexBuffer, MemoryCategory::Geometry, uploadQueueFamilies);
+        attributeBuffer = GrowableBuffer(allocator, sizeof(AttributeStream), INITIAL_GEOMETRY_VERTEX_CAPACITY, vk::BufferUsageFlagBits::eVertexBuffer, MemoryCategory::Geometry, uploadQueueFamilies);
+        vertexRanges = RangeAllocator(INITIAL_GEOMETRY_VERTEX_CAPACITY);
     }
 
     void Renderer::createIndexBuffer() {
-        vk::BufferCreateInfo bufferInfo{
-            .size = 8388608, // 8MB //indices.size() * sizeof(uint32_t),
-            .usage = vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eTransferDst,
-            .sharingMode = vk::SharingMode::eExclusive,
-        };
-        vma::AllocationCreateInfo allocInfo{
-            .usage = vma::MemoryUsage::eAuto,
-        };
-        indexBuffer = allocator.createBuffer(bufferInfo, allocInfo);
+        indexBuffer = GrowableBuffer(allocator, sizeof(uint32_t), INITIAL_GEOMETRY_INDEX_CAPACITY, vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eStorageBuffer, MemoryCategory::Geometry, uploadQueueFamilies);
+        indexRanges = RangeAllocator(INITIAL_GEOMETRY_INDEX_CAPACITY);
     }
 
     void Renderer::createUniformBuffers() {
@@ -978,7 +1549,7 @@ namespace volchara {
                 .flags = vma::AllocationCreateFlagBits::eHostAccessSequentialWrite | vma::AllocationCreateFlagBits::eMapped,
                 .usage = vma::MemoryUsage::eAuto,
             };
-            uniformBuffers.push_back(allocator.createBuffer(bufferInfo, allocInfo));
+            uniformBuffers.push_back(allocator.createBuffer(bufferInfo, allocInfo, MemoryCategory::Uniforms));
         }
 
         vk::BufferCreateInfo ambientBufferInfo{
@@ -990,7 +1561,7 @@ namespace volchara {
             .flags = vma::AllocationCreateFlagBits::eHostAccessSequentialWrite | vma::AllocationCreateFlagBits::eMapped,
             .usage = vma::MemoryUsage::eAuto,
         };
-        ambientLightBuffer = allocator.createBuffer(ambientBufferInfo, ambientAllocInfo);
+        ambientLightBuffer = allocator.createBuffer(ambientBufferInfo, ambientAllocInfo, MemoryCategory::Uniforms);
 
         vk::BufferCreateInfo directionalBufferInfo{
             .size = sizeof(DirectionalLightUniformBufferObject),
@@ -1001,22 +1572,98 @@ namespace volchara {
             .flags = vma::AllocationCreateFlagBits::eHostAccessSequentialWrite | vma::AllocationCreateFlagBits::eMapped,
             .usage = vma::MemoryUsage::eAuto,
         };
-        directionalLightBuffer = allocator.createBuffer(directionalBufferInfo, directionalAllocInfo);
+        directionalLightBuffer = allocator.createBuffer(directionalBufferInfo, directionalAllocInfo, MemoryCategory::Uniforms);
     }
 
-    void Renderer::createSSBOBuffer() {
-        vk::BufferCreateInfo bufferInfo{
-            .size = 8388608 * maxTextures, // 8MB * x
-            .usage = vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
-            .sharingMode = vk::SharingMode::eExclusive,
-        };
+    void Renderer::createObjectDataBuffers() {
         vma::AllocationCreateInfo allocInfo{
+            .flags = vma::AllocationCreateFlagBits::eHostAccessSequentialWrite | vma::AllocationCreateFlagBits::eMapped,
             .usage = vma::MemoryUsage::eAuto,
         };
-        ssboBuffer = allocator.createBuffer(bufferInfo, allocInfo);
+        for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+            vk::BufferCreateInfo bufferInfo{
+                .size = sizeof(ObjectData) * maxObjectData,
+                .usage = vk::BufferUsageFlagBits::eStorageBuffer,
+                .sharingMode = vk::SharingMode::eExclusive,
+            };
+            objectDataBuffers.push_back(allocator.createBuffer(bufferInfo, allocInfo, MemoryCategory::Uniforms));
+
+            vk::BufferCreateInfo matrixBufferInfo{
+                .size = sizeof(glm::mat4) * maxObjectData,
+                .usage = vk::BufferUsageFlagBits::eStorageBuffer,
+                .sharingMode = vk::SharingMode::eExclusive,
+            };
+            modelMatrixBuffers.push_back(allocator.createBuffer(matrixBufferInfo, allocInfo, MemoryCategory::Uniforms));
+
+            vk::BufferCreateInfo drawCommandBufferInfo{
+                .size = sizeof(vk::DrawIndexedIndirectCommand) * maxObjectData,
+                .usage = vk::BufferUsageFlagBits::eIndirectBuffer,
+                .sharingMode = vk::SharingMode::eExclusive,
+            };
+            drawCommandBuffers.push_back(allocator.createBuffer(drawCommandBufferInfo, allocInfo, MemoryCategory::Uniforms));
+        }
+        objectDataGenerations = std::vector<uint64_t>(MAX_FRAMES_IN_FLIGHT, 0);
+        drawCommandGenerations = std::vector<uint64_t>(MAX_FRAMES_IN_FLIGHT, 0);
     }
 
-    RAIIvmaImage Renderer::createImage(uint32_t width, uint32_t height, vk::Format format, vk::ImageTiling tiling, vk::ImageUsageFlags usage, vk::MemoryPropertyFlags properties, vk::ImageAspectFlags aspectFlags) {
+    void Renderer::createMeshletBuffers() {
+        meshletBuffer = GrowableBuffer(allocator, sizeof(Meshlet), INITIAL_GEOMETRY_MESHLET_CAPACITY, vk::BufferUsageFlagBits::eStorageBuffer, MemoryCategory::Geometry, uploadQueueFamilies);
+        meshletRanges = RangeAllocator(INITIAL_GEOMETRY_MESHLET_CAPACITY);
+
+        vma::AllocationCreateInfo deviceAllocInfo{
+            .usage = vma::MemoryUsage::eAuto,
+        };
+
+        vma::AllocationCreateInfo hostAllocInfo{
+            .flags = vma::AllocationCreateFlagBits::eHostAccessSequentialWrite | vma::AllocationCreateFlagBits::eMapped,
+            .usage = vma::MemoryUsage::eAuto,
+        };
+        for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+            vk::BufferCreateInfo jobBufferInfo{
+                .size = MESHLET_CULL_JOB_CAPACITY * sizeof(MeshletCullJob),
+                .usage = vk::BufferUsageFlagBits::eStorageBuffer,
+                .sharingMode = vk::SharingMode::eExclusive,
+            };
+            meshletCullJobBuffers.push_back(allocator.createBuffer(jobBufferInfo, hostAllocInfo, MemoryCategory::Uniforms));
+
+            // the job count lives here rather than in the recorded commands, so a LOD switch doesn't re-record them
+            vk::BufferCreateInfo dispatchBufferInfo{
+                .size = sizeof(MeshletCullDispatch),
+                .usage = vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eStorageBuffer,
+                .sharingMode = vk::SharingMode::eExclusive,
+            };
+            meshletCullDispatchBuffers.push_back(allocator.createBuffer(dispatchBufferInfo, hostAllocInfo, MemoryCategory::Uniforms));
+
+            // every draw has at least one job, so there are never more draws than jobs
+            vk::BufferCreateInfo templateBufferInfo{
+                .size = MESHLET_CULL_JOB_CAPACITY * sizeof(vk::DrawIndexedIndirectCommand),
+                .usage = vk::BufferUsageFlagBits::eTransferSrc,
+                .sharingMode = vk::SharingMode::eExclusive,
+            };
+            meshletDrawTemplateBuffers.push_back(allocator.createBuffer(templateBufferInfo, hostAllocInfo, MemoryCategory::Uniforms));
+
+            vk::BufferCreateInfo drawBufferInfo{
+                .size = MESHLET_CULL_JOB_CAPACITY * sizeof(vk::DrawIndexedIndirectCommand),
+                .usage = vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+                .sharingMode = vk::SharingMode::eExclusive,
+            };
+            meshletDrawBuffers.push_back(allocator.createBuffer(drawBufferInfo, deviceAllocInfo, MemoryCategory::Uniforms));
+
+            vk::BufferCreateInfo culledIndexBufferInfo{
+                .size = CULLED_INDEX_CAPACITY * sizeof(uint32_t),
+                .usage = vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eStorageBuffer,
+                .sharingMode = vk::SharingMode::eExclusive,
+            };
+            culledIndexBuffers.push_back(allocator.createBuffer(culledIndexBufferInfo, deviceAllocInfo, MemoryCategory::Geometry));
+        }
+        meshletCullGenerations = std::vector<uint64_t>(MAX_FRAMES_IN_FLIGHT, 0);
+        meshletDrawCounts = std::vector<uint32_t>(MAX_FRAMES_IN_FLIGHT, 0);
+        meshletDrawSlots = std::vector<std::vector<uint32_t>>(MAX_FRAMES_IN_FLIGHT);
+    }
+
+    RAIIvmaImage Renderer::createImage(uint32_t width, uint32_t height, vk::Format format, vk::ImageTiling tiling, vk::ImageUsageFlags usage, vk::MemoryPropertyFlags properties, MemoryCategory category, vk::ImageAspectFlags aspectFlags,
+            std::span<const uint32_t> queueFamilies) {
+        bool shared = queueFamilies.size() > 1;
         vk::ImageCreateInfo imageInfo{
             .imageType = vk::ImageType::e2D,
             .format = format,
@@ -1025,12 +1672,14 @@ namespace volchara {
             .arrayLayers = 1,
             .tiling = tiling,
             .usage = usage,
-            .sharingMode = vk::SharingMode::eExclusive,
+            .sharingMode = shared ? vk::SharingMode::eConcurrent : vk::SharingMode::eExclusive,
+            .queueFamilyIndexCount = shared ? static_cast<uint32_t>(queueFamilies.size()) : 0,
+            .pQueueFamilyIndices = shared ? queueFamilies.data() : nullptr,
         };
         vma::AllocationCreateInfo allocInfo{
             .usage = vma::MemoryUsage::eAuto,
         };
-        RAIIvmaImage image = allocator.createImage(imageInfo, allocInfo, aspectFlags);
+        RAIIvmaImage image = allocator.createImage(imageInfo, allocInfo, aspectFlags, category);
         return image;
     }
 
@@ -1112,7 +1761,7 @@ namespace volchara {
     void Renderer::createDepthResources() {
         vk::Format depthFormat = findDepthFormat();
         for (size_t i = 0; i < swapChainImageViews.size(); i++) {
-            depthBuffers.push_back(createImage(swapChainExtent.width, swapChainExtent.height, depthFormat, vk::ImageTiling::eOptimal, vk::ImageUsageFlagBits::eDepthStencilAttachment | vk::ImageUsageFlagBits::eInputAttachment, vk::MemoryPropertyFlagBits::eDeviceLocal, vk::ImageAspectFlagBits::eDepth));
+            depthBuffers.push_back(createImage(swapChainExtent.width, swapChainExtent.height, depthFormat, vk::ImageTiling::eOptimal, vk::ImageUsageFlagBits::eDepthStencilAttachment | vk::ImageUsageFlagBits::eInputAttachment, vk::MemoryPropertyFlagBits::eDeviceLocal, MemoryCategory::Attachments, vk::ImageAspectFlagBits::eDepth));
             transitionImageLayout(depthBuffers[i], depthFormat, vk::ImageLayout::eUndefined, vk::ImageLayout::eDepthStencilAttachmentOptimal);
         }
     }
@@ -1120,7 +1769,7 @@ namespace volchara {
     void Renderer::createNormalResources() {
         vk::Format normalFormat = vk::Format::eR16G16B16A16Sfloat;
         for (size_t i = 0; i < swapChainImageViews.size(); i++) {
-            normalBuffers.push_back(createImage(swapChainExtent.width, swapChainExtent.height, normalFormat, vk::ImageTiling::eOptimal, vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eInputAttachment, vk::MemoryPropertyFlagBits::eDeviceLocal));
+            normalBuffers.push_back(createImage(swapChainExtent.width, swapChainExtent.height, normalFormat, vk::ImageTiling::eOptimal, vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eInputAttachment, vk::MemoryPropertyFlagBits::eDeviceLocal, MemoryCategory::Attachments));
             transitionImageLayout(normalBuffers[i], normalFormat, vk::ImageLayout::eUndefined, vk::ImageLayout::eColorAttachmentOptimal);
         }
     }
@@ -1128,7 +1777,7 @@ namespace volchara {
     void Renderer::createIntermediateColorResources() {
         vk::Format interFormat = vk::Format::eR8G8B8A8Unorm;
         for (size_t i = 0; i < swapChainImageViews.size(); i++) {
-            intermediateColorBuffers.push_back(createImage(swapChainExtent.width, swapChainExtent.height, interFormat, vk::ImageTiling::eOptimal, vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eInputAttachment, vk::MemoryPropertyFlagBits::eDeviceLocal));
+            intermediateColorBuffers.push_back(createImage(swapChainExtent.width, swapChainExtent.height, interFormat, vk::ImageTiling::eOptimal, vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eInputAttachment, vk::MemoryPropertyFlagBits::eDeviceLocal, MemoryCategory::Attachments));
             transitionImageLayout(intermediateColorBuffers[i], interFormat, vk::ImageLayout::eUndefined, vk::ImageLayout::eColorAttachmentOptimal);
         }
     }
@@ -1149,41 +1798,56 @@ namespace volchara {
         }
     }
 
-    uint32_t Renderer::createTextureImage(const std::filesystem::path path) {
-        // TODO: deduplication
-        int width, height, channels;
-        std::vector<char *> texture = readFile(path);
-        stbi_uc* pixels = stbi_load_from_memory(reinterpret_cast<unsigned char*>(texture.data()), texture.size(), &width, &height, &channels, STBI_rgb_alpha);
-        vk::DeviceSize imageSize = width * height * STBI_rgb_alpha;
-
-        if (!pixels) {
-            throw std::runtime_error("couldn't load texture image");
-        };
-
-        vk::BufferCreateInfo createInfo{
-            .size = imageSize,
-            .usage = vk::BufferUsageFlagBits::eTransferSrc,
-            .sharingMode = vk::SharingMode::eExclusive,
-        };
-        vk::raii::Buffer stagingBuffer = device.createBuffer(createInfo);
-        vma::AllocationCreateInfo allocInfo{
-            .flags = vma::AllocationCreateFlagBits::eHostAccessSequentialWrite | vma::AllocationCreateFlagBits::eMapped,
-            .usage = vma::MemoryUsage::eAuto,
-        };
-        RAIIvmaBuffer textureBuffer = allocator.createBuffer(createInfo, allocInfo);
-        
-        textureBuffer.copyFrom(pixels, imageSize);
-        stbi_image_free(pixels);
-
-        RAIIvmaImage image = createImage(width, height, vk::Format::eR8G8B8A8Srgb, vk::ImageTiling::eOptimal, vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled, vk::MemoryPropertyFlagBits::eDeviceLocal);
+    uint32_t Renderer::createTextureImage(std::span<const std::byte> encoded) {
+        DecodedImage image = decodeImage(encoded);
+        return createTextureImage(image.pixels.get(), image.width, image.height);
+    }
 
-        transitionImageLayout(image, vk::Format::eR8G8B8A8Srgb, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal);
-        image.copyFrom(textureBuffer.allocInfo().pMappedData, imageSize);
-        transitionImageLayout(image, vk::Format::eR8G8B8A8Srgb, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal);
+    uint32_t Renderer::createTextureImage(const void* pixels, uint32_t width, uint32_t height) {
+        // TODO: deduplication
+        RAIIvmaImage image = nullptr;
+        {
+            // textures are only allocated under the queue lock, like geometry
+            std::lock_guard<std::mutex> lock(queueMutex);
+            image = createImage(width, height, vk::Format::eR8G8B8A8Srgb, vk::ImageTiling::eOptimal, vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled, vk::MemoryPropertyFlagBits::eDeviceLocal, MemoryCategory::Textures,
+                vk::ImageAspectFlagBits::eColor, uploadQueueFamilies);
+        }
+        {
+            // waits on the ring's fences only; defragmentation can't move the image before it is in `textures`
+            std::lock_guard<std::mutex> lock(uploadMutex);
+            stagingRing.uploadImage(image, width, height, 4, pixels);
+            stagingRing.finish();
+        }
+        std::lock_guard<std::mutex> lock(queueMutex);
         textures.push_back(std::move(image));
         return textures.size() - 1;
     }
 
+    uint32_t Renderer::uploadTexture(const DecodedImage& image) {
+        uint32_t texture = createTextureImage(image.pixels.get(), image.width, image.height);
+        // defragmentation rewrites the set's descriptors under the same lock
+        std::lock_guard<std::mutex> lock(queueMutex);
+        return loadTextureToDescriptors(texture);
+    }
+
+    LoadedModel Renderer::uploadModel(ImportedModel&& model) {
+        LoadedModel loaded;
+        if (model.meshCache) {
+            const MeshCacheData& cached = model.meshCache->data;
+            loaded.geometry = uploadLoadedGeometry(cached.positions, cached.attributes, cached.indices, cached.meshlets);
+        }
+        else if (!model.positions.empty()) {
+            loaded.geometry = uploadLoadedGeometry(model.positions, model.attributes, model.indices, model.meshlets);
+        }
+        for (const auto& [image, decoded] : model.images) {
+            loaded.textures[image] = uploadTexture(decoded);
+        }
+        // the pixels aren't needed once they are on the GPU
+        model.images.clear();
+        loaded.model = std::move(model);
+        return loaded;
+    }
+
     void Renderer::createDescriptorPool() {
         vk::DescriptorPoolSize uboSize{
             .type = vk::DescriptorType::eUniformBuffer,
@@ -1191,7 +1855,7 @@ namespace volchara {
         };
         vk::DescriptorPoolSize ssboSize{
             .type = vk::DescriptorType::eStorageBuffer,
-            .descriptorCount = 1,
+            .descriptorCount = static_cast<uint32_t>(8 * MAX_FRAMES_IN_FLIGHT),  // object data + model matrices + meshlet culling
         };
         vk::DescriptorPoolSize imageSize{
             .type = vk::DescriptorType::eSampledImage,
@@ -1321,24 +1985,38 @@ namespace volchara {
         };
         device.updateDescriptorSets(samplerdescriptorWrite, nullptr);
         
+        std::vector<vk::DescriptorSetLayout> ssboLayouts(MAX_FRAMES_IN_FLIGHT, descriptorSetLayoutSSBO);
         vk::DescriptorSetAllocateInfo ssboallocInfo{
             .descriptorPool = descriptorPool,
-            .descriptorSetCount = 1,
-            .pSetLayouts = &*descriptorSetLayoutSSBO,
+            .descriptorSetCount = static_cast<uint32_t>(ssboLayouts.size()),
+            .pSetLayouts = ssboLayouts.data(),
         };
         descriptorSetsSSBO = device.allocateDescriptorSets(ssboallocInfo);
-        vk::DescriptorBufferInfo ssbobufferInfo{
-            .buffer = ssboBuffer,
-            .range = vk::WholeSize,
-        };
-        vk::WriteDescriptorSet ssbodescriptorWrite{
-            .dstSet = descriptorSetsSSBO[0],
-            .dstBinding = 0,
-            .descriptorCount = 1,
-            .descriptorType = vk::DescriptorType::eStorageBuffer,
-            .pBufferInfo = &ssbobufferInfo,
-        };
-        device.updateDescriptorSets(ssbodescriptorWrite, nullptr);
+        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+            vk::DescriptorBufferInfo ssbobufferInfo{
+                .buffer = objectDataBuffers[i],
+                .range = vk::WholeSize,
+            };
+            vk::WriteDescriptorSet ssbodescriptorWrite{
+                .dstSet = descriptorSetsSSBO[i],
+                .dstBinding = 0,
+                .descriptorCount = 1,
+                .descriptorType = vk::DescriptorType::eStorageBuffer,
+                .pBufferInfo = &ssbobufferInfo,
+            };
+            vk::DescriptorBufferInfo modelMatrixBufferInfo{
+                .buffer = modelMatrixBuffers[i],
+                .range = vk::WholeSize,
+            };
+            vk::WriteDescriptorSet modelMatrixDescriptorWrite{
+                .dstSet = descriptorSetsSSBO[i],
+                .dstBinding = 1,
+                .descriptorCount = 1,
+                .descriptorType = vk::DescriptorType::eStorageBuffer,
+                .pBufferInfo = &modelMatrixBufferInfo,
+            };
+            device.updateDescriptorSets({ssbodescriptorWrite, modelMatrixDescriptorWrite}, nullptr);
+        }
 
         vk::DescriptorSetAllocateInfo ambientLightUboallocInfo{
             .descriptorPool = descriptorPool,
@@ -1377,6 +2055,41 @@ namespace volchara {
             .pBufferInfo = &directionalLightUbobufferInfo,
         };
         device.updateDescriptorSets(directionalLightUbodescriptorWrite, nullptr);
+
+        std::vector<vk::DescriptorSetLayout> meshletCullLayouts(MAX_FRAMES_IN_FLIGHT, descriptorSetLayoutMeshletCull);
+        vk::DescriptorSetAllocateInfo meshletCullAllocInfo{
+            .descriptorPool = descriptorPool,
+            .descriptorSetCount = static_cast<uint32_t>(meshletCullLayouts.size()),
+            .pSetLayouts = meshletCullLayouts.data(),
+        };
+        descriptorSetsMeshletCull = device.allocateDescriptorSets(meshletCullAllocInfo);
+        meshletCullDescriptorGenerations = std::vector<uint64_t>(MAX_FRAMES_IN_FLIGHT, 0);
+        for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+            writeMeshletCullDescriptors(i);
+        }
+    }
+
+    void Renderer::writeMeshletCullDescriptors(uint32_t bufferIndex) {
+        std::array<vk::DescriptorBufferInfo, 6> bufferInfos{{
+            {.buffer = meshletBuffer, .range = vk::WholeSize},
+            {.buffer = meshletCullJobBuffers[bufferIndex], .range = vk::WholeSize},
+            {.buffer = indexBuffer, .range = vk::WholeSize},
+            {.buffer = meshletDrawBuffers[bufferIndex], .range = vk::WholeSize},
+            {.buffer = culledIndexBuffers[bufferIndex], .range = vk::WholeSize},
+            {.buffer = meshletCullDispatchBuffers[bufferIndex], .range = vk::WholeSize},
+        }};
+        std::array<vk::WriteDescriptorSet, 6> writes;
+        for (uint32_t binding = 0; binding < bufferInfos.size(); binding++) {
+            writes[binding] = {
+                .dstSet = descriptorSetsMeshletCull[bufferIndex],
+                .dstBinding = binding,
+                .descriptorCount = 1,
+                .descriptorType = vk::DescriptorType::eStorageBuffer,
+                .pBufferInfo = &bufferInfos[binding],
+            };
+        }
+        device.updateDescriptorSets(writes, nullptr);
+        meshletCullDescriptorGenerations[bufferIndex] = geometryBufferGeneration;
     }
 
     uint32_t Renderer::loadTextureToDescriptors(uint32_t textureIndex) {
@@ -1401,10 +2114,39 @@ namespace volchara {
         vk::CommandBufferAllocateInfo allocInfo{
             .commandPool = commandPool,
             .level = vk::CommandBufferLevel::ePrimary,
-            .commandBufferCount = MAX_FRAMES_IN_FLIGHT,
+            .commandBufferCount = static_cast<uint32_t>(swapChainImages.size()),
         };
 
-        commandBuffers = device.allocateCommandBuffers(allocInfo);
+        commandBuffers.clear();
+        commandBufferGenerations.clear();
+        for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+            commandBuffers.push_back(device.allocateCommandBuffers(allocInfo));
+            commandBufferGenerations.push_back(std::vector<uint64_t>(swapChainImages.size(), 0));
+        }
+    }
+
+    void Renderer::createSecondaryCommandBuffers() {
+        QueueFamilyIndices queueFamilyIndices = findQueueFamilies(physicalDevice);
+
+        vk::CommandPoolCreateInfo poolInfo{
+            .flags = vk::CommandPoolCreateFlagBits::eTransient,
+            .queueFamilyIndex = queueFamilyIndices.graphicsFamily.value(),
+        };
+        secondaryCommandPools.resize(MAX_FRAMES_IN_FLIGHT);
+        secondaryCommandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+        for (int frame = 0; frame < MAX_FRAMES_IN_FLIGHT; frame++) {
+            for (size_t worker = 0; worker < jobSystem.concurrency(); worker++) {
+                secondaryCommandPools[frame].push_back(device.createCommandPool(poolInfo));
+                vk::CommandBufferAllocateInfo allocInfo{
+                    .commandPool = secondaryCommandPools[frame][worker],
+                    .level = vk::CommandBufferLevel::eSecondary,
+                    .commandBufferCount = 1,
+                };
+                secondaryCommandBuffers[frame].push_back(std::move(device.allocateCommandBuffers(allocInfo).front()));
+            }
+        }
+        secondaryCommandBufferGenerations = std::vector<uint64_t>(MAX_FRAMES_IN_FLIGHT, 0);
+        secondaryCommandBufferCounts = std::vector<size_t>(MAX_FRAMES_IN_FLIGHT, 0);
     }
 
     void Renderer::createSyncObjects() {
@@ -1419,28 +2161,27 @@ namespace volchara {
     }
 
     void Renderer::updateCameraPosition(float passedSeconds) {
-        if (pressedKeys.contains(GLFW_KEY_W)) {
+        if (input.isDown(GLFW_KEY_W)) {
             camera.transform.position.forward(passedSeconds * cameraSpeed);
         }
-        if (pressedKeys.contains(GLFW_KEY_S)) {
+        if (input.isDown(GLFW_KEY_S)) {
             camera.transform.position.backward(passedSeconds * cameraSpeed);
         }
-        if (pressedKeys.contains(GLFW_KEY_A)) {
+        if (input.isDown(GLFW_KEY_A)) {
             camera.transform.position.left(passedSeconds * cameraSpeed);
         }
-        if (pressedKeys.contains(GLFW_KEY_D)) {
+        if (input.isDown(GLFW_KEY_D)) {
             camera.transform.position.right(passedSeconds * cameraSpeed);
         }
-        if (pressedKeys.contains(GLFW_KEY_Q)) {
+        if (input.isDown(GLFW_KEY_Q)) {
             camera.transform.position.down(passedSeconds * cameraSpeed, true);
         }
-        if (pressedKeys.contains(GLFW_KEY_E)) {
+        if (input.isDown(GLFW_KEY_E)) {
             camera.transform.position.up(passedSeconds * cameraSpeed, true);
         }
+        glm::vec2 cursorOffset = input.cursorDelta();
         camera.transform.rotation.up(-cursorOffset.y * mouseSensitivity * 0.0001f);
         camera.transform.rotation.right(cursorOffset.x * mouseSensitivity * 0.0001f, true);
-        cursorOffset.x = 0;
-        cursorOffset.y = 0;
     }
 
     void Renderer::recreateSwapChain() {
@@ -1451,20 +2192,109 @@ namespace volchara {
             glfwWaitEvents();
         }
 
+        std::lock_guard<std::mutex> sceneLock(sceneMutex);
+        std::lock_guard<std::mutex> queueLock(queueMutex);
         device.waitIdle();
 
         createSwapChain();
         createImageViews();
         createDepthResources();
         createFramebuffers();
+        createCommandBuffers();
+        markSceneDirty();
+    }
+
+    void Renderer::recordSceneCommandBuffer(vk::raii::CommandBuffer& buffer, uint32_t bufferIndex, size_t firstInstance, size_t lastInstance) {
+        // no framebuffer: the same secondary is executed for every swapchain image
+        vk::CommandBufferInheritanceInfo inheritanceInfo{
+            .renderPass = renderPass,
+            .subpass = 0,
+        };
+        vk::CommandBufferBeginInfo beginInfo{
+            .flags = vk::CommandBufferUsageFlagBits::eRenderPassContinue | vk::CommandBufferUsageFlagBits::eSimultaneousUse,
+            .pInheritanceInfo = &inheritanceInfo,
+        };
+        buffer.begin(beginInfo);
+
+        buffer.bindPipeline(vk::PipelineBindPoint::eGraphics, colorGraphicsPipeline);
+        buffer.bindVertexBuffers(
+            0,
+            {positionBuffer, attributeBuffer},
+            {0, 0}
+        );
+        buffer.bindIndexBuffer(indexBuffer, 0, vk::IndexType::eUint32);
+        vk::Viewport viewport{
+            .x = 0,
+            .y = static_cast<float>(swapChainExtent.height),
+            .width = static_cast<float>(swapChainExtent.width),
+            .height = -static_cast<float>(swapChainExtent.height),
+            .maxDepth = 1,
+        };
+        buffer.setViewport(0, viewport);
+        vk::Rect2D scissor{
+            .extent = swapChainExtent,
+        };
+        buffer.setScissor(0, scissor);
+        buffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, colorPipelineLayout, 0, *descriptorSetsUBO[bufferIndex], nullptr);
+        buffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, colorPipelineLayout, 1, *descriptorSetsTextures[0], nullptr);
+        buffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, colorPipelineLayout, 2, *descriptorSetsSSBO[bufferIndex], nullptr);
+        buffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, colorPipelineLayout, 3, *descriptorSetsAmbientLightUBO[0], nullptr);
+        buffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, colorPipelineLayout, 4, *descriptorSetsDirectionalLightUBO[0], nullptr);
+        // every instance has its command, empty when the culling pass draws it instead; materials are bindless,
+        // so the whole range is one batch however many materials it has
+        drawIndexedIndirect(buffer, drawCommandBuffers[bufferIndex], static_cast<uint32_t>(firstInstance), static_cast<uint32_t>(lastInstance - firstInstance));
+        // culled instances get consecutive slots in instance order
+        const std::vector<uint32_t>& drawSlots = meshletDrawSlots[bufferIndex];
+        uint32_t firstSlot = NO_MESHLET_DRAW;
+        uint32_t slotCount = 0;
+        for (size_t instance = firstInstance; instance < lastInstance; instance++) {
+            if (drawSlots[instance] == NO_MESHLET_DRAW) continue;
+            if (slotCount++ == 0) firstSlot = drawSlots[instance];
+        }
+        if (slotCount > 0) {
+            buffer.bindIndexBuffer(culledIndexBuffers[bufferIndex], 0, vk::IndexType::eUint32);
+            drawIndexedIndirect(buffer, meshletDrawBuffers[bufferIndex], firstSlot, slotCount);
+        }
+
+        buffer.end();
+    }
+
+    void Renderer::drawIndexedIndirect(vk::raii::CommandBuffer& buffer, vk::Buffer commands, uint32_t firstDraw, uint32_t drawCount) {
+        uint32_t maxDraws = physicalDeviceProperties.limits.maxDrawIndirectCount;
+        for (uint32_t draw = firstDraw; draw < firstDraw + drawCount; draw += maxDraws) {
+            uint32_t count = std::min(maxDraws, firstDraw + drawCount - draw);
+            buffer.drawIndexedIndirect(commands, draw * sizeof(vk::DrawIndexedIndirectCommand), count, sizeof(vk::DrawIndexedIndirectCommand));
+        }
+    }
+
+    void Renderer::recordSceneCommandBuffers(uint32_t bufferIndex) {
+        // scene draws are split into contiguous instance ranges, one secondary buffer per worker
+        size_t instanceCount = scene.count(DRAWABLE_COMPONENTS);
+        size_t jobCount = std::min(jobSystem.concurrency(), (instanceCount + MIN_OBJECTS_PER_RECORDING_JOB - 1) / MIN_OBJECTS_PER_RECORDING_JOB);
+
+        jobSystem.parallelFor(jobCount, [&](size_t job) {
+            secondaryCommandPools[bufferIndex][job].reset();
+            recordSceneCommandBuffer(secondaryCommandBuffers[bufferIndex][job], bufferIndex, instanceCount * job / jobCount, instanceCount * (job + 1) / jobCount);
+        });
+        secondaryCommandBufferCounts[bufferIndex] = jobCount;
+        secondaryCommandBufferGenerations[bufferIndex] = sceneGeneration;
     }
 
     void Renderer::recordCommandBuffer(uint32_t imageIndex, uint32_t bufferIndex) {
-        commandBuffers[bufferIndex].reset();
+        if (secondaryCommandBufferGenerations[bufferIndex] != sceneGeneration) {
+            recordSceneCommandBuffers(bufferIndex);
+        }
+
+        vk::raii::CommandBuffer& commandBuffer = commandBuffers[bufferIndex][imageIndex];
+        commandBuffer.reset();
 
         vk::CommandBufferBeginInfo beginInfo{};
 
-        commandBuffers[bufferIndex].begin(beginInfo);
+        commandBuffer.begin(beginInfo);
+
+        if (meshletDrawCounts[bufferIndex] > 0) {
+            recordMeshletCulling(commandBuffer, bufferIndex);
+        }
 
         vk::Rect2D renderArea{
             .extent = swapChainExtent,
@@ -1472,7 +2302,7 @@ namespace volchara {
         vk::ClearValue clearValueColor({0.0f, 0.0f, 0.0f, 1.0f});
         vk::ClearValue clearValueNormal({0.0f, 0.0f, 0.0f, 1.0f});
         vk::ClearValue clearValueDepth({0.0f, 0});
-        std::vector<vk::ClearValue> clearValues{clearValueColor, clearValueNormal, clearValueDepth, clearValueColor};
+        std::array<vk::ClearValue, 4> clearValues{clearValueColor, clearValueNormal, clearValueDepth, clearValueColor};
         vk::RenderPassBeginInfo renderPassInfo{
             .renderPass = renderPass,
             .framebuffer = swapChainFramebuffers[imageIndex],
@@ -1481,13 +2311,16 @@ namespace volchara {
             .pClearValues = clearValues.data(),
         };
 
-        commandBuffers[bufferIndex].beginRenderPass(renderPassInfo, vk::SubpassContents::eInline);
-        commandBuffers[bufferIndex].bindPipeline(vk::PipelineBindPoint::eGraphics, colorGraphicsPipeline);
-        commandBuffers[bufferIndex].bindVertexBuffers(
-            0,
-            {vertexBuffer},
-            {0}
-        );
+        std::pmr::vector<vk::CommandBuffer> sceneBuffers = gatherCommandBuffers(
+            std::span(secondaryCommandBuffers[bufferIndex]).first(secondaryCommandBufferCounts[bufferIndex]), &frameArenas[bufferIndex]);
+
+        commandBuffer.beginRenderPass(renderPassInfo, vk::SubpassContents::eSecondaryCommandBuffers);
+        if (!sceneBuffers.empty()) {
+            commandBuffer.executeCommands(sceneBuffers);
+        }
+
+        commandBuffer.nextSubpass(vk::SubpassContents::eInline);
+        commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, lightGraphicsPipeline);
         vk::Viewport viewport{
             .x = 0,
             .y = static_cast<float>(swapChainExtent.height),
@@ -1495,54 +2328,63 @@ namespace volchara {
             .height = -static_cast<float>(swapChainExtent.height),
             .maxDepth = 1,
         };
-        commandBuffers[bufferIndex].bindIndexBuffer(indexBuffer, 0, vk::IndexType::eUint32);
-        commandBuffers[bufferIndex].setViewport(0, viewport);
+        commandBuffer.setViewport(0, viewport);
         vk::Rect2D scissor{
             .extent = swapChainExtent,
         };
-        commandBuffers[bufferIndex].setScissor(0, scissor);
-        commandBuffers[bufferIndex].bindDescriptorSets(vk::PipelineBindPoint::eGraphics, colorPipelineLayout, 0, *descriptorSetsUBO[bufferIndex], nullptr);
-        commandBuffers[bufferIndex].bindDescriptorSets(vk::PipelineBindPoint::eGraphics, colorPipelineLayout, 1, *descriptorSetsTextures[0], nullptr);
-        commandBuffers[bufferIndex].bindDescriptorSets(vk::PipelineBindPoint::eGraphics, colorPipelineLayout, 2, *descriptorSetsSSBO[0], nullptr);
-        commandBuffers[bufferIndex].bindDescriptorSets(vk::PipelineBindPoint::eGraphics, colorPipelineLayout, 3, *descriptorSetsAmbientLightUBO[0], nullptr);
-        commandBuffers[bufferIndex].bindDescriptorSets(vk::PipelineBindPoint::eGraphics, colorPipelineLayout, 4, *descriptorSetsDirectionalLightUBO[0], nullptr);
-        uint32_t alreadyDrawn = 0;
-        for (int i = 0; i < objects.size(); i++) {
-            PushConstants cnst;
-            cnst.model = objects[i]->transform.modelMatrix();
-            cnst.textureIndex = objects[i]->textureIndex;
-            commandBuffers[bufferIndex].pushConstants<PushConstants>(colorPipelineLayout, vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment, 0, {cnst});
-            commandBuffers[bufferIndex].drawIndexed(objects[i]->indices.size(), 1, alreadyDrawn, 0, 0);
-            alreadyDrawn += objects[i]->indices.size();
-        }
-
-        commandBuffers[bufferIndex].nextSubpass(vk::SubpassContents::eInline);
-        commandBuffers[bufferIndex].bindPipeline(vk::PipelineBindPoint::eGraphics, lightGraphicsPipeline);
-        commandBuffers[bufferIndex].bindDescriptorSets(vk::PipelineBindPoint::eGraphics, lightPipelineLayout, 0, *descriptorSetsLightSubpass[imageIndex], nullptr);
-        commandBuffers[bufferIndex].bindDescriptorSets(vk::PipelineBindPoint::eGraphics, lightPipelineLayout, 1, *descriptorSetsUBO[bufferIndex], nullptr);
-        for (int i = 0; i < lights.size(); i++) {
-            PushConstants cnst;
-            cnst.color = glm::vec4(lights[i]->color, 0.0f);
-            cnst.model = lights[i]->transform.modelMatrix();
-            cnst.brightness = lights[i]->brightness;
-            commandBuffers[bufferIndex].pushConstants<PushConstants>(lightPipelineLayout, vk::ShaderStageFlagBits::eFragment, 0, {cnst});
-            commandBuffers[bufferIndex].draw(3, 1, 0, 0);
-        }
+        commandBuffer.setScissor(0, scissor);
+        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, lightPipelineLayout, 0, *descriptorSetsLightSubpass[imageIndex], nullptr);
+        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, lightPipelineLayout, 1, *descriptorSetsUBO[bufferIndex], nullptr);
+        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, lightPipelineLayout, 2, *descriptorSetsSSBO[bufferIndex], nullptr);
         PushConstants cnst;
+        cnst.color = glm::vec4(0.0f, 0.0f, 0.0f, 0.0f);
+        commandBuffer.pushConstants<PushConstants>(lightPipelineLayout, vk::ShaderStageFlagBits::eFragment, 0, {cnst});
+        size_t drawnCount = scene.count(DRAWABLE_COMPONENTS);
+        for (size_t i = 0; i < lights.size(); i++) {
+            // light records follow the drawn entities' records in ObjectData
+            commandBuffer.draw(3, 1, 0, static_cast<uint32_t>(drawnCount + i));
+        }
         cnst.color = glm::vec4(ambientLight.color, 1.0f);  // w == isAmbient
         cnst.brightness = ambientLight.brightness;
-        commandBuffers[bufferIndex].pushConstants<PushConstants>(lightPipelineLayout, vk::ShaderStageFlagBits::eFragment, 0, {cnst});
-        commandBuffers[bufferIndex].draw(3, 1, 0, 0);
+        commandBuffer.pushConstants<PushConstants>(lightPipelineLayout, vk::ShaderStageFlagBits::eFragment, 0, {cnst});
+        commandBuffer.draw(3, 1, 0, 0);
+
+        commandBuffer.endRenderPass();
+
+        commandBuffer.end();
+        commandBufferGenerations[bufferIndex][imageIndex] = sceneGeneration;
+    }
 
-        commandBuffers[bufferIndex].endRenderPass();
+    void Renderer::recordMeshletCulling(vk::raii::CommandBuffer& commandBuffer, uint32_t bufferIndex) {
+        // the culling pass counts into the draws, so they start over from the templates every frame
+        vk::BufferCopy templateCopy{
+            .size = meshletDrawCounts[bufferIndex] * sizeof(vk::DrawIndexedIndirectCommand),
+        };
+        commandBuffer.copyBuffer(meshletDrawTemplateBuffers[bufferIndex], meshletDrawBuffers[bufferIndex], templateCopy);
+        vk::MemoryBarrier resetBarrier{
+            .srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+            .dstAccessMask = vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite,
+        };
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eComputeShader, {}, resetBarrier, nullptr, nullptr);
+
+        commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, meshletCullPipeline);
+        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, meshletCullPipelineLayout, 0, *descriptorSetsUBO[bufferIndex], nullptr);
+        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, meshletCullPipelineLayout, 1, *descriptorSetsSSBO[bufferIndex], nullptr);
+        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, meshletCullPipelineLayout, 2, *descriptorSetsMeshletCull[bufferIndex], nullptr);
+        // sized by updateMeshletCulling, which may change the job count without re-recording
+        commandBuffer.dispatchIndirect(meshletCullDispatchBuffers[bufferIndex], 0);
 
-        commandBuffers[bufferIndex].end();
+        vk::MemoryBarrier cullBarrier{
+            .srcAccessMask = vk::AccessFlagBits::eShaderWrite,
+            .dstAccessMask = vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eIndexRead,
+        };
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eVertexInput, {}, cullBarrier, nullptr, nullptr);
     }
 
-    void Renderer::updateUniformBuffer(uint32_t imageIndex) {
+    void Renderer::updateUniformBuffer(uint32_t imageIndex, const TransformState& cameraState) {
         UniformBufferObject ubo{};
-        ubo.view = glm::inverse(camera.transform.modelMatrix());
-        float const fovMult = 1.0f / tan(glm::radians(45.0f) / 2.0f);
+        ubo.view = glm::inverse(cameraState.modelMatrix());
+        float const fovMult = 1.0f / tan(glm::radians(VERTICAL_FOV_DEGREES) / 2.0f);
         float const aspect = swapChainExtent.width / (float)swapChainExtent.height;
         ubo.proj = glm::mat4(
             fovMult / aspect,    0.0f,  0.0f,  0.0f,
@@ -1553,27 +2395,107 @@ namespace volchara {
         uniformBuffers[imageIndex].copyFrom(&ubo, sizeof(ubo));
     }
 
+    void Renderer::updateObjectData(uint32_t bufferIndex, const SimulationSnapshot& from, const SimulationSnapshot& to, float alpha) {
+        size_t drawnCount = scene.count(DRAWABLE_COMPONENTS);
+        size_t instanceCount = drawnCount + lights.size();
+        if (instanceCount > maxObjectData) {
+            throw std::runtime_error("too many objects for object data buffer");
+        }
+        if (to.instanceSlots.size() != instanceCount) {
+            throw std::runtime_error("simulation snapshot doesn't match the scene!");
+        }
+        renderTransforms.interpolate(from, to, alpha, jobSystem);
+        writeModelMatrices(static_cast<glm::mat4*>(modelMatrixBuffers[bufferIndex].allocInfo().pMappedData), renderTransforms.store,
+            to.instanceSlots, jobSystem);
+        modelMatrixBuffers[bufferIndex].flush(0, sizeof(glm::mat4) * instanceCount);
+
+        if (objectDataGenerations[bufferIndex] == sceneGeneration) return;
+        ObjectData* data = static_cast<ObjectData*>(objectDataBuffers[bufferIndex].allocInfo().pMappedData);
+        writeObjectData(data, scene);
+        for (size_t i = 0; i < lights.size(); i++) {
+            data[drawnCount + i] = {
+                .color = glm::vec4(lights[i]->color, 0.0f),
+                .brightness = lights[i]->brightness,
+            };
+        }
+        objectDataBuffers[bufferIndex].flush(0, sizeof(ObjectData) * instanceCount);
+        objectDataGenerations[bufferIndex] = sceneGeneration;
+    }
+
+    void Renderer::selectLods(const TransformState& cameraState) {
+        // pixels covered by one unit at unit distance
+        float pixelsPerUnit = swapChainExtent.height / (2.0f * std::tan(glm::radians(VERTICAL_FOV_DEGREES) / 2.0f));
+        bool changed = selectLodLevels(scene, renderTransforms.store, cameraState.translation, pixelsPerUnit, lodPixelError, jobSystem);
+        // the draw commands and cull jobs hold the index ranges; the recorded buffers only read them
+        if (changed) markDrawsDirty();
+    }
+
+    void Renderer::updateMeshletCulling(uint32_t bufferIndex) {
+        if (meshletCullGenerations[bufferIndex] == drawGeneration) return;
+        MeshletCullJob* jobs = static_cast<MeshletCullJob*>(meshletCullJobBuffers[bufferIndex].allocInfo().pMappedData);
+        vk::DrawIndexedIndirectCommand* draws = static_cast<vk::DrawIndexedIndirectCommand*>(meshletDrawTemplateBuffers[bufferIndex].allocInfo().pMappedData);
+        MeshletCullLayout layout = writeMeshletCullJobs(scene, jobs, draws, meshletDrawSlots[bufferIndex]);
+        meshletCullJobBuffers[bufferIndex].flush(0, sizeof(MeshletCullJob) * layout.jobCount);
+        meshletDrawTemplateBuffers[bufferIndex].flush(0, sizeof(vk::DrawIndexedIndirectCommand) * layout.drawCount);
+        *static_cast<MeshletCullDispatch*>(meshletCullDispatchBuffers[bufferIndex].allocInfo().pMappedData) = meshletCullDispatch(layout.jobCount);
+        meshletCullDispatchBuffers[bufferIndex].flush(0, sizeof(MeshletCullDispatch));
+        // the recorded buffers hold the slot ranges and the template count, which only change
+        // when an instance moves between the culled and the whole draws
+        if (layout.slotsChanged) {
+            secondaryCommandBufferGenerations[bufferIndex] = 0;
+            std::fill(commandBufferGenerations[bufferIndex].begin(), commandBufferGenerations[bufferIndex].end(), 0);
+        }
+        meshletDrawCounts[bufferIndex] = layout.drawCount;
+        meshletCullGenerations[bufferIndex] = drawGeneration;
+    }
+
+    void Renderer::updateDrawCommands(uint32_t bufferIndex) {
+        if (drawCommandGenerations[bufferIndex] == drawGeneration) return;
+        vk::DrawIndexedIndirectCommand* commands = static_cast<vk::DrawIndexedIndirectCommand*>(drawCommandBuffers[bufferIndex].allocInfo().pMappedData);
+        size_t instanceCount = scene.count(DRAWABLE_COMPONENTS);
+        if (instanceCount > maxObjectData) {
+            throw std::runtime_error("too many objects for draw command buffer");
+        }
+        writeDrawCommands(commands, scene, meshletDrawSlots[bufferIndex]);
+        drawCommandBuffers[bufferIndex].flush(0, sizeof(vk::DrawIndexedIndirectCommand) * instanceCount);
+        drawCommandGenerations[bufferIndex] = drawGeneration;
+    }
+
+    void Renderer::runParallelFrameCallbacks(float passedSeconds) {
+        scene.forEach(COMPONENT_CALLBACKS | COMPONENT_ACTIVE, [&](Archetype& archetype, size_t) {
+            jobSystem.parallelForRange(archetype.size(), MIN_OBJECTS_PER_CALLBACK_JOB, [&](size_t begin, size_t end) {
+                for (size_t row = begin; row < end; row++) {
+                    FrameCallbacks& entry = archetype.callbacks[row];
+                    for (auto& callback : entry.parallelCallbacks) {
+                        callback(entry.owner, passedSeconds, input);
+                    }
+                }
+            });
+        });
+    }
+
+    void Renderer::runSerialFrameCallbacks(float passedSeconds) {
+        // by index, as a callback may add or remove objects, moving the scene's rows and this list
+        for (size_t i = 0; i < objects.size(); i++) {
+            Object* obj = objects[i];
+            if (!(scene.components(obj->entity) & COMPONENT_CALLBACKS)) continue;
+            for (size_t j = 0; j < scene.callbacks(obj->entity).callbacks.size(); j++) {
+                scene.callbacks(obj->entity).callbacks[j](obj, passedSeconds, input);
+            }
+        }
+    }
+
     void Renderer::drawFrame() {
         device.waitForFences({inFlightFences[currentFrame]}, true, UINT64_MAX);
 
         std::chrono::duration<float, std::ratio<1, MAX_FRAMERATE>> sinceLastFrame{std::chrono::steady_clock::now() - lastFrameTime};
         if (sinceLastFrame.count() < 1.0f) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            // time to spare goes to defragmentation first, a bounded number of passes a frame
+            if (defragmentationPassesThisFrame >= DEFRAGMENTATION_MAX_PASSES_PER_FRAME || !defragmentStep()) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
             return;
         }
-
-        float passedSeconds = std::chrono::duration_cast<std::chrono::microseconds>(sinceLastFrame).count() / 1000000.0f;
-
-        //for (fw::Object* obj : objects) {  // breaks 'cause reallocation
-        for (int i = 0; i < objects.size(); i++) {
-            volchara::Object* obj = objects[i];
-            obj->runFrameCallbacks(
-                passedSeconds,
-                pressedKeys
-            );
-        }
-
-        updateCameraPosition(passedSeconds);
         
         std::pair<vk::Result, uint32_t> nextImagePair = swapChain.acquireNextImage(UINT64_MAX, imageAvailableSemaphores[currentFrame], nullptr);
         if (nextImagePair.first == vk::Result::eErrorOutOfDateKHR || nextImagePair.first == vk::Result::eSuboptimalKHR || framebufferResized) {
@@ -1583,14 +2505,44 @@ namespace volchara {
         }
 
         lastFrameTime = std::chrono::steady_clock::now();
+        defragmentationPassesThisFrame = 0;
+        frameArenas[currentFrame].reset();
+        allocator.setFrameIndex(++allocatorFrameIndex);
+        if (lastFrameTime - lastMemoryBudgetCheck > std::chrono::seconds(1)) {
+            lastMemoryBudgetCheck = lastFrameTime;
+            checkMemoryBudget();
+        }
 
         uint32_t imageIndex = nextImagePair.second;
 
         device.resetFences({inFlightFences[currentFrame]});
-        
-        recordCommandBuffer(imageIndex, currentFrame);
 
-        updateUniformBuffer(currentFrame);
+        // loads are swapped in between frames, never while the scene is read or recorded
+        std::unique_lock<std::mutex> sceneLock(sceneMutex);
+        releaseRetiredBuffers();
+        // this frame's last submission has retired, so its descriptors can follow replaced geometry buffers
+        if (meshletCullDescriptorGenerations[currentFrame] != geometryBufferGeneration) {
+            writeMeshletCullDescriptors(currentFrame);
+        }
+        TransformState cameraState;
+        {
+            // the simulation can't publish while the pair is read
+            std::lock_guard<std::mutex> lock(snapshotMutex);
+            std::chrono::duration<float, std::ratio<1, SIMULATION_TICK_RATE>> sinceLastTick{std::chrono::steady_clock::now() - currentSnapshot.time};
+            float alpha = std::clamp(sinceLastTick.count(), 0.0f, 1.0f);
+            cameraState = TransformState::interpolate(previousSnapshot.camera, currentSnapshot.camera, alpha);
+            updateUniformBuffer(currentFrame, cameraState);
+            updateObjectData(currentFrame, previousSnapshot, currentSnapshot, alpha);
+        }
+        // may change drawn ranges, so it runs before the command buffers are checked
+        selectLods(cameraState);
+        updateMeshletCulling(currentFrame);
+        updateDrawCommands(currentFrame);
+
+        if (commandBufferGenerations[currentFrame][imageIndex] != sceneGeneration) {
+            recordCommandBuffer(imageIndex, currentFrame);
+        }
+        sceneLock.unlock();
 
         vk::PipelineStageFlags waitStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput);
         vk::SubmitInfo submitInfo{
@@ -1598,11 +2550,13 @@ namespace volchara {
             .pWaitSemaphores = &*imageAvailableSemaphores[currentFrame],
             .pWaitDstStageMask = &waitStageMask,
             .commandBufferCount = 1,
-            .pCommandBuffers = &*commandBuffers[currentFrame],
+            .pCommandBuffers = &*commandBuffers[currentFrame][imageIndex],
             .signalSemaphoreCount = 1,
             .pSignalSemaphores = &*renderFinishedSemaphores[currentFrame],
         };
+        std::lock_guard<std::mutex> queueLock(queueMutex);
         graphicsQueue.submit(submitInfo, inFlightFences[currentFrame]);
+        submittedFrames++;
 
         vk::PresentInfoKHR presentInfo{
             .waitSemaphoreCount = 1,
@@ -1615,7 +2569,5 @@ namespace volchara {
         presentQueue.presentKHR(presentInfo);
 
         currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
-
-        if (pressedKeys.contains(GLFW_KEY_ESCAPE)) shouldExit = true;
     }
 };
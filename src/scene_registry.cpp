@@ -0,0 +1,185 @@
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <scene_registry.hpp>
+
+namespace volchara {
+    namespace {
+        // moves a row of one column between archetypes; components only in `to` start default-constructed
+        template<class T>
+        void migrateColumn(std::vector<T> Archetype::* column, Archetype& from, Archetype& to, uint32_t row, uint32_t component) {
+            bool inFrom = from.components & component;
+            if (to.components & component) {
+                if (inFrom) {
+                    (to.*column).push_back(std::move((from.*column)[row]));
+                }
+                else {
+                    (to.*column).emplace_back();
+                }
+            }
+            if (inFrom) {
+                std::vector<T>& source = from.*column;
+                if (row + 1 != source.size()) source[row] = std::move(source.back());
+                source.pop_back();
+            }
+        }
+
+        void migrateRow(Archetype& from, Archetype& to, uint32_t row) {
+            migrateColumn(&Archetype::transforms, from, to, row, COMPONENT_TRANSFORM);
+            migrateColumn(&Archetype::meshes, from, to, row, COMPONENT_MESH);
+            migrateColumn(&Archetype::materials, from, to, row, COMPONENT_MATERIAL);
+            migrateColumn(&Archetype::callbacks, from, to, row, COMPONENT_CALLBACKS);
+            migrateColumn(&Archetype::lods, from, to, row, COMPONENT_LOD);
+        }
+    }
+
+    uint32_t SceneRegistry::findArchetype(uint32_t components) {
+        for (uint32_t i = 0; i < archetypes.size(); i++) {
+            if (archetypes[i].components == components) return i;
+        }
+        archetypes.push_back({.components = components});
+        return static_cast<uint32_t>(archetypes.size() - 1);
+    }
+
+    const SceneRegistry::Location& SceneRegistry::locate(Entity entity) const {
+        if (!alive(entity)) {
+            throw std::runtime_error("entity doesn't exist!");
+        }
+        return locations[entity.index];
+    }
+
+    void SceneRegistry::removeRow(uint32_t archetypeIndex, uint32_t row) {
+        // an archetype without components takes the row's components and drops them
+        Archetype& archetype = archetypes[archetypeIndex];
+        Archetype sink;
+        migrateRow(archetype, sink, row);
+        if (row + 1 != archetype.entities.size()) {
+            archetype.entities[row] = archetype.entities.back();
+            locations[archetype.entities[row].index].row = row;
+        }
+        archetype.entities.pop_back();
+    }
+
+    Entity SceneRegistry::create(uint32_t components) {
+        uint32_t index;
+        if (!freeEntities.empty()) {
+            index = freeEntities.back();
+            freeEntities.pop_back();
+        }
+        else {
+            index = static_cast<uint32_t>(locations.size());
+            locations.emplace_back();
+        }
+        uint32_t archetypeIndex = findArchetype(components);
+        Archetype& archetype = archetypes[archetypeIndex];
+        Entity entity{.index = index, .generation = locations[index].generation};
+        // migrating from an archetype without components default-constructs every column
+        Archetype empty;
+        migrateRow(empty, archetype, 0);
+        archetype.entities.push_back(entity);
+        locations[index] = {
+            .archetype = archetypeIndex,
+            .row = static_cast<uint32_t>(archetype.entities.size() - 1),
+            .generation = entity.generation,
+            .alive = true,
+        };
+        return entity;
+    }
+
+    void SceneRegistry::destroy(Entity entity) {
+        const Location& location = locate(entity);
+        removeRow(location.archetype, location.row);
+        Location& released = locations[entity.index];
+        released.alive = false;
+        released.generation++;
+        freeEntities.push_back(entity.index);
+    }
+
+    bool SceneRegistry::alive(Entity entity) const {
+        return entity.index < locations.size() && locations[entity.index].alive && locations[entity.index].generation == entity.generation;
+    }
+
+    uint32_t SceneRegistry::components(Entity entity) const {
+        return archetypes[locate(entity).archetype].components;
+    }
+
+    void SceneRegistry::setComponents(Entity entity, uint32_t components) {
+        Location location = locate(entity);
+        if (archetypes[location.archetype].components == components) return;
+        // may grow the archetype list, so references are taken after it
+        uint32_t targetIndex = findArchetype(components);
+        Archetype& from = archetypes[location.archetype];
+        Archetype& to = archetypes[targetIndex];
+        migrateRow(from, to, location.row);
+        to.entities.push_back(entity);
+        if (location.row + 1 != from.entities.size()) {
+            from.entities[location.row] = from.entities.back();
+            locations[from.entities[location.row].index].row = location.row;
+        }
+        from.entities.pop_back();
+        locations[entity.index].archetype = targetIndex;
+        locations[entity.index].row = static_cast<uint32_t>(to.entities.size() - 1);
+    }
+
+    void SceneRegistry::add(Entity entity, uint32_t components) {
+        setComponents(entity, this->components(entity) | components);
+    }
+
+    void SceneRegistry::remove(Entity entity, uint32_t components) {
+        setComponents(entity, this->components(entity) & ~components);
+    }
+
+    uint32_t& SceneRegistry::transform(Entity entity) {
+        const Location& location = locate(entity);
+        Archetype& archetype = archetypes[location.archetype];
+        if (!(archetype.components & COMPONENT_TRANSFORM)) {
+            throw std::runtime_error("entity has no transform component!");
+        }
+        return archetype.transforms[location.row];
+    }
+
+    MeshRef& SceneRegistry::mesh(Entity entity) {
+        const Location& location = locate(entity);
+        Archetype& archetype = archetypes[location.archetype];
+        if (!(archetype.components & COMPONENT_MESH)) {
+            throw std::runtime_error("entity has no mesh component!");
+        }
+        return archetype.meshes[location.row];
+    }
+
+    Material& SceneRegistry::material(Entity entity) {
+        const Location& location = locate(entity);
+        Archetype& archetype = archetypes[location.archetype];
+        if (!(archetype.components & COMPONENT_MATERIAL)) {
+            throw std::runtime_error("entity has no material component!");
+        }
+        return archetype.materials[location.row];
+    }
+
+    FrameCallbacks& SceneRegistry::callbacks(Entity entity) {
+        const Location& location = locate(entity);
+        Archetype& archetype = archetypes[location.archetype];
+        if (!(archetype.components & COMPONENT_CALLBACKS)) {
+            throw std::runtime_error("entity has no callbacks component!");
+        }
+        return archetype.callbacks[location.row];
+    }
+
+    LodChain& SceneRegistry::lod(Entity entity) {
+        const Location& location = locate(entity);
+        Archetype& archetype = archetypes[location.archetype];
+        if (!(archetype.components & COMPONENT_LOD)) {
+            throw std::runtime_error("entity has no lod component!");
+        }
+        return archetype.lods[location.row];
+    }
+
+    size_t SceneRegistry::count(uint32_t components) const {
+        size_t total = 0;
+        for (const Archetype& archetype : archetypes) {
+            if ((archetype.components & components) == components) total += archetype.size();
+        }
+        return total;
+    }
+}
@@ -0,0 +1,180 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+
+#include <vulkan/vulkan_raii.hpp>
+#include <vk_mem_alloc.hpp>
+
+#include <memory_stats.hpp>
+#include <staging_ring.hpp>
+
+namespace volchara {
+    StagingRing::StagingRing(vk::raii::Device& dev, RAIIAllocator& allocator, uint32_t queueFamilyIndex, vk::DeviceSize slotSize, uint32_t slotCount,
+            uint32_t queueIndex, std::mutex* queueMutex) {
+        device = &dev;
+        this->slotSize = slotSize;
+        this->queueMutex = queueMutex;
+        queue = device->getQueue(queueFamilyIndex, queueIndex);
+        vk::CommandPoolCreateInfo poolInfo{
+            .flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+            .queueFamilyIndex = queueFamilyIndex,
+        };
+        commandPool = device->createCommandPool(poolInfo);
+        vk::CommandBufferAllocateInfo commandInfo{
+            .commandPool = commandPool,
+            .level = vk::CommandBufferLevel::ePrimary,
+            .commandBufferCount = slotCount,
+        };
+        std::vector<vk::raii::CommandBuffer> commands = device->allocateCommandBuffers(commandInfo);
+        vk::BufferCreateInfo bufferInfo{
+            .size = slotSize,
+            .usage = vk::BufferUsageFlagBits::eTransferSrc,
+            .sharingMode = vk::SharingMode::eExclusive,
+        };
+        vma::AllocationCreateInfo allocInfo{
+            .flags = vma::AllocationCreateFlagBits::eHostAccessSequentialWrite | vma::AllocationCreateFlagBits::eMapped,
+            .usage = vma::MemoryUsage::eAuto,
+        };
+        slots.reserve(slotCount);
+        for (uint32_t i = 0; i < slotCount; i++) {
+            Slot slot;
+            slot.buffer = allocator.createBuffer(bufferInfo, allocInfo, MemoryCategory::Staging);
+            slot.mapped = static_cast<std::byte*>(slot.buffer.allocInfo().pMappedData);
+            slot.commands = std::move(commands[i]);
+            slot.fence = device->createFence({});
+            slots.push_back(std::move(slot));
+        }
+    }
+
+    StagingRing::~StagingRing() {
+        // the slots' copies may still read their buffers
+        finish();
+    }
+
+    StagingRing::Slot& StagingRing::acquire() {
+        Slot& slot = slots[nextSlot];
+        nextSlot = (nextSlot + 1) % slots.size();
+        if (slot.pending) {
+            device->waitForFences({slot.fence}, true, std::numeric_limits<uint64_t>::max());
+            device->resetFences({slot.fence});
+            slot.pending = false;
+        }
+        return slot;
+    }
+
+    void StagingRing::submit(Slot& slot) {
+        vk::SubmitInfo submitInfo{
+            .commandBufferCount = 1,
+            .pCommandBuffers = &*slot.commands,
+        };
+        std::unique_lock<std::mutex> lock;
+        if (queueMutex) lock = std::unique_lock<std::mutex>(*queueMutex);
+        queue.submit(submitInfo, slot.fence);
+        slot.pending = true;
+    }
+
+    void StagingRing::upload(vk::Buffer to, vk::DeviceSize dstOffset, size_t elementSize, size_t elementCount, const Fill& fill) {
+        size_t slotElements = static_cast<size_t>(slotSize / elementSize);
+        if (slotElements == 0) {
+            throw std::runtime_error("element is larger than a staging slot!");
+        }
+        for (size_t first = 0; first < elementCount; first += slotElements) {
+            size_t count = std::min(slotElements, elementCount - first);
+            vk::DeviceSize size = count * elementSize;
+            Slot& slot = acquire();
+            fill(slot.mapped, first, count);
+            slot.buffer.flush(0, size);
+
+            slot.commands.reset();
+            slot.commands.begin({.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+            vk::BufferCopy region{
+                .dstOffset = dstOffset + first * elementSize,
+                .size = size,
+            };
+            slot.commands.copyBuffer(slot.buffer, to, region);
+            slot.commands.end();
+            submit(slot);
+        }
+    }
+
+    void StagingRing::uploadImage(vk::Image to, uint32_t width, uint32_t height, size_t texelSize, const void* texels) {
+        vk::DeviceSize rowSize = width * texelSize;
+        uint32_t slotRows = static_cast<uint32_t>(std::min<vk::DeviceSize>(slotSize / rowSize, height));
+        if (slotRows == 0) {
+            throw std::runtime_error("image row is larger than a staging slot!");
+        }
+        vk::ImageSubresourceRange wholeImage{.aspectMask = vk::ImageAspectFlagBits::eColor, .baseMipLevel = 0, .levelCount = 1, .baseArrayLayer = 0, .layerCount = 1};
+        for (uint32_t firstRow = 0; firstRow < height; firstRow += slotRows) {
+            uint32_t rows = std::min(slotRows, height - firstRow);
+            vk::DeviceSize size = rows * rowSize;
+            Slot& slot = acquire();
+            std::memcpy(slot.mapped, static_cast<const std::byte*>(texels) + firstRow * rowSize, size);
+            slot.buffer.flush(0, size);
+
+            slot.commands.reset();
+            slot.commands.begin({.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+            // the slots are submitted in order to one queue, so the first slot's barrier covers the later copies too
+            if (firstRow == 0) {
+                vk::ImageMemoryBarrier toTransfer{
+                    .srcAccessMask = vk::AccessFlagBits::eNone,
+                    .dstAccessMask = vk::AccessFlagBits::eTransferWrite,
+                    .oldLayout = vk::ImageLayout::eUndefined,
+                    .newLayout = vk::ImageLayout::eTransferDstOptimal,
+                    .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+                    .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+                    .image = to,
+                    .subresourceRange = wholeImage,
+                };
+                slot.commands.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer, {}, nullptr, nullptr, toTransfer);
+            }
+            vk::BufferImageCopy region{
+                .imageSubresource = {.aspectMask = vk::ImageAspectFlagBits::eColor, .mipLevel = 0, .baseArrayLayer = 0, .layerCount = 1},
+                .imageOffset = {0, static_cast<int32_t>(firstRow), 0},
+                .imageExtent = {width, rows, 1},
+            };
+            slot.commands.copyBufferToImage(slot.buffer, to, vk::ImageLayout::eTransferDstOptimal, region);
+            if (firstRow + rows == height) {
+                // a transfer queue has no shader stages to name; the image is sampled only after the fence
+                vk::ImageMemoryBarrier toShader{
+                    .srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+                    .dstAccessMask = vk::AccessFlagBits::eNone,
+                    .oldLayout = vk::ImageLayout::eTransferDstOptimal,
+                    .newLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
+                    .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+                    .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+                    .image = to,
+                    .subresourceRange = wholeImage,
+                };
+                slot.commands.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eBottomOfPipe, {}, nullptr, nullptr, toShader);
+            }
+            slot.commands.end();
+            submit(slot);
+        }
+    }
+
+    void StagingRing::copy(vk::Buffer from, vk::Buffer to, vk::DeviceSize size) {
+        if (size == 0) return;
+        Slot& slot = acquire();
+        slot.commands.reset();
+        slot.commands.begin({.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+        vk::BufferCopy region{
+            .size = size,
+        };
+        slot.commands.copyBuffer(from, to, region);
+        slot.commands.end();
+        submit(slot);
+    }
+
+    void StagingRing::finish() {
+        for (Slot& slot : slots) {
+            if (!slot.pending) continue;
+            device->waitForFences({slot.fence}, true, std::numeric_limits<uint64_t>::max());
+            device->resetFences({slot.fence});
+            slot.pending = false;
+        }
+    }
+}
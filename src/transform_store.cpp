@@ -0,0 +1,340 @@
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <glm/gtx/transform.hpp>
+#include <glm/gtx/quaternion.hpp>
+
+#if defined(VOLCHARA_SCALAR_TRANSFORMS)
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <xmmintrin.h>
+#define VOLCHARA_TRANSFORMS_SSE
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define VOLCHARA_TRANSFORMS_NEON
+#endif
+
+#include <transform_store.hpp>
+
+namespace volchara {
+    namespace {
+        #if defined(VOLCHARA_TRANSFORMS_SSE)
+        using Lanes = __m128;
+        inline Lanes load(const float* p) { return _mm_loadu_ps(p); }
+        inline Lanes splat(float v) { return _mm_set1_ps(v); }
+        inline Lanes add(Lanes a, Lanes b) { return _mm_add_ps(a, b); }
+        inline Lanes sub(Lanes a, Lanes b) { return _mm_sub_ps(a, b); }
+        inline Lanes mul(Lanes a, Lanes b) { return _mm_mul_ps(a, b); }
+        // lane i of a, b, c, d becomes the four floats at out + 16 * i
+        inline void storeTransposed(float* out, Lanes a, Lanes b, Lanes c, Lanes d) {
+            _MM_TRANSPOSE4_PS(a, b, c, d);
+            _mm_storeu_ps(out, a);
+            _mm_storeu_ps(out + 16, b);
+            _mm_storeu_ps(out + 32, c);
+            _mm_storeu_ps(out + 48, d);
+        }
+        #elif defined(VOLCHARA_TRANSFORMS_NEON)
+        using Lanes = float32x4_t;
+        inline Lanes load(const float* p) { return vld1q_f32(p); }
+        inline Lanes splat(float v) { return vdupq_n_f32(v); }
+        inline Lanes add(Lanes a, Lanes b) { return vaddq_f32(a, b); }
+        inline Lanes sub(Lanes a, Lanes b) { return vsubq_f32(a, b); }
+        inline Lanes mul(Lanes a, Lanes b) { return vmulq_f32(a, b); }
+        inline void storeTransposed(float* out, Lanes a, Lanes b, Lanes c, Lanes d) {
+            float32x4x2_t ab = vtrnq_f32(a, b);  // a0 b0 a2 b2, a1 b1 a3 b3
+            float32x4x2_t cd = vtrnq_f32(c, d);
+            vst1q_f32(out, vcombine_f32(vget_low_f32(ab.val[0]), vget_low_f32(cd.val[0])));
+            vst1q_f32(out + 16, vcombine_f32(vget_low_f32(ab.val[1]), vget_low_f32(cd.val[1])));
+            vst1q_f32(out + 32, vcombine_f32(vget_high_f32(ab.val[0]), vget_high_f32(cd.val[0])));
+            vst1q_f32(out + 48, vcombine_f32(vget_high_f32(ab.val[1]), vget_high_f32(cd.val[1])));
+        }
+        #endif
+    }
+
+    static_assert(sizeof(glm::mat4) == 16 * sizeof(float), "matrices are written as packed floats");
+
+    TransformState TransformState::interpolate(const TransformState& from, const TransformState& to, float alpha) {
+        return {
+            .translation = glm::mix(from.translation, to.translation, alpha),
+            .scaling = glm::mix(from.scaling, to.scaling, alpha),
+            .rotationQuat = glm::slerp(from.rotationQuat, to.rotationQuat, alpha),
+        };
+    }
+
+    glm::mat4 TransformState::modelMatrix() const {
+        return glm::translate(translation) * glm::toMat4(rotationQuat) * glm::scale(scaling);
+    }
+
+    void TransformStore::grow(size_t count) {
+        size_t capacity = (count + BATCH_SIZE - 1) / BATCH_SIZE * BATCH_SIZE;
+        if (capacity <= dirty.size()) return;
+        translationX.resize(capacity, 0.0f);
+        translationY.resize(capacity, 0.0f);
+        translationZ.resize(capacity, 0.0f);
+        rotationX.resize(capacity, 0.0f);
+        rotationY.resize(capacity, 0.0f);
+        rotationZ.resize(capacity, 0.0f);
+        rotationW.resize(capacity, 1.0f);
+        scaleX.resize(capacity, 1.0f);
+        scaleY.resize(capacity, 1.0f);
+        scaleZ.resize(capacity, 1.0f);
+        dirty.resize(capacity, 0);
+        worldChanged.resize(capacity, 0);
+        localMatrices.resize(capacity, glm::mat4(1.0f));
+        worldMatrices.resize(capacity, glm::mat4(1.0f));
+        parents.resize(capacity, NO_PARENT);
+        childCounts.resize(capacity, 0);
+        orderValid = false;
+    }
+
+    uint32_t TransformStore::allocate(const TransformState& state) {
+        uint32_t slot;
+        if (!freeSlots.empty()) {
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+        }
+        else {
+            slot = static_cast<uint32_t>(slotCount++);
+            grow(slotCount);
+        }
+        set(slot, state);
+        return slot;
+    }
+
+    void TransformStore::release(uint32_t slot) {
+        setParent(slot, NO_PARENT);
+        if (childCounts[slot] > 0) {
+            // orphans become roots rather than following a reused slot
+            for (size_t child = 0; child < slotCount; child++) {
+                if (parents[child] == slot) setParent(static_cast<uint32_t>(child), NO_PARENT);
+            }
+        }
+        dirty[slot] = 0;
+        freeSlots.push_back(slot);
+    }
+
+    void TransformStore::resize(size_t count) {
+        grow(count);
+        if (count != slotCount) orderValid = false;
+        slotCount = count;
+        freeSlots.clear();
+    }
+
+    size_t TransformStore::size() const {
+        return slotCount;
+    }
+
+    TransformState TransformStore::get(uint32_t slot) const {
+        return {
+            .translation = translation(slot),
+            .scaling = scaling(slot),
+            .rotationQuat = rotation(slot),
+        };
+    }
+
+    void TransformStore::set(uint32_t slot, const TransformState& state) {
+        setTranslation(slot, state.translation);
+        setScaling(slot, state.scaling);
+        setRotation(slot, state.rotationQuat);
+    }
+
+    glm::vec3 TransformStore::translation(uint32_t slot) const {
+        return {translationX[slot], translationY[slot], translationZ[slot]};
+    }
+
+    void TransformStore::setTranslation(uint32_t slot, glm::vec3 translation) {
+        translationX[slot] = translation.x;
+        translationY[slot] = translation.y;
+        translationZ[slot] = translation.z;
+        dirty[slot] = 1;
+    }
+
+    glm::vec3 TransformStore::scaling(uint32_t slot) const {
+        return {scaleX[slot], scaleY[slot], scaleZ[slot]};
+    }
+
+    void TransformStore::setScaling(uint32_t slot, glm::vec3 scaling) {
+        scaleX[slot] = scaling.x;
+        scaleY[slot] = scaling.y;
+        scaleZ[slot] = scaling.z;
+        dirty[slot] = 1;
+    }
+
+    glm::quat TransformStore::rotation(uint32_t slot) const {
+        return glm::quat(rotationW[slot], rotationX[slot], rotationY[slot], rotationZ[slot]);
+    }
+
+    void TransformStore::setRotation(uint32_t slot, glm::quat rotation) {
+        rotationX[slot] = rotation.x;
+        rotationY[slot] = rotation.y;
+        rotationZ[slot] = rotation.z;
+        rotationW[slot] = rotation.w;
+        dirty[slot] = 1;
+    }
+
+    uint32_t TransformStore::parent(uint32_t slot) const {
+        return parents[slot];
+    }
+
+    void TransformStore::setParent(uint32_t slot, uint32_t parentSlot) {
+        if (parents[slot] == parentSlot) return;
+        for (uint32_t ancestor = parentSlot; ancestor != NO_PARENT; ancestor = parents[ancestor]) {
+            if (ancestor == slot) {
+                throw std::runtime_error("transform can't be its own ancestor!");
+            }
+        }
+        if (parents[slot] != NO_PARENT) childCounts[parents[slot]]--;
+        if (parentSlot != NO_PARENT) childCounts[parentSlot]++;
+        parents[slot] = parentSlot;
+        dirty[slot] = 1;
+        orderValid = false;
+        parentsGeneration++;
+    }
+
+    uint64_t TransformStore::hierarchyGeneration() const {
+        return parentsGeneration;
+    }
+
+    const std::vector<uint32_t>& TransformStore::parentSlots() const {
+        return parents;
+    }
+
+    void TransformStore::setParentSlots(const std::vector<uint32_t>& parentSlots) {
+        std::fill(parents.begin(), parents.end(), NO_PARENT);
+        std::copy_n(parentSlots.begin(), std::min(parentSlots.size(), parents.size()), parents.begin());
+        std::fill(childCounts.begin(), childCounts.end(), 0);
+        for (uint32_t parentSlot : parents) {
+            if (parentSlot != NO_PARENT) childCounts[parentSlot]++;
+        }
+        orderValid = false;
+        parentsGeneration++;
+    }
+
+    void TransformStore::rebuildOrder() {
+        const uint32_t unknown = NO_PARENT;
+        std::vector<uint32_t> depths(slotCount, unknown);
+        std::vector<uint32_t> chain;
+        uint32_t maxDepth = 0;
+        for (size_t slot = 0; slot < slotCount; slot++) {
+            // walk up to the first slot with a known depth, then assign depths back down
+            uint32_t current = static_cast<uint32_t>(slot);
+            while (current != NO_PARENT && depths[current] == unknown) {
+                chain.push_back(current);
+                current = parents[current];
+            }
+            uint32_t depth = current == NO_PARENT ? 0 : depths[current] + 1;
+            for (auto it = chain.rbegin(); it != chain.rend(); it++) {
+                depths[*it] = depth++;
+            }
+            chain.clear();
+            maxDepth = std::max(maxDepth, depths[slot]);
+        }
+
+        levelOffsets.assign(slotCount > 0 ? maxDepth + 2 : 1, 0);
+        for (uint32_t depth : depths) {
+            levelOffsets[depth + 1]++;
+        }
+        for (size_t level = 1; level < levelOffsets.size(); level++) {
+            levelOffsets[level] += levelOffsets[level - 1];
+        }
+        order.resize(slotCount);
+        std::vector<size_t> next(levelOffsets.begin(), levelOffsets.end() - 1);
+        for (size_t slot = 0; slot < slotCount; slot++) {
+            order[next[depths[slot]]++] = static_cast<uint32_t>(slot);
+        }
+        orderValid = true;
+    }
+
+    bool TransformStore::isDirty(uint32_t slot) const {
+        return dirty[slot] != 0;
+    }
+
+    void TransformStore::markDirty(uint32_t slot) {
+        dirty[slot] = 1;
+    }
+
+    void TransformStore::clearDirty(uint32_t slot) {
+        dirty[slot] = 0;
+    }
+
+    void TransformStore::updateMatrices(JobSystem& jobs, size_t grainSize) {
+        // local matrix jobs must not share a batch
+        grainSize = std::max<size_t>((grainSize + BATCH_SIZE - 1) / BATCH_SIZE * BATCH_SIZE, BATCH_SIZE);
+        bool all = !orderValid;
+        if (!orderValid) rebuildOrder();
+        jobs.parallelForRange(slotCount, grainSize, [&](size_t begin, size_t end) {
+            updateLocalMatrices(begin, end);
+        });
+        for (size_t level = 0; level + 1 < levelOffsets.size(); level++) {
+            size_t levelBegin = levelOffsets[level];
+            jobs.parallelForRange(levelOffsets[level + 1] - levelBegin, grainSize, [&](size_t begin, size_t end) {
+                updateWorldMatrices(levelBegin + begin, levelBegin + end, all);
+            });
+        }
+    }
+
+    void TransformStore::updateWorldMatrices(size_t firstOrder, size_t lastOrder, bool all) {
+        for (size_t i = firstOrder; i < lastOrder; i++) {
+            uint32_t slot = order[i];
+            uint32_t parentSlot = parents[slot];
+            bool changed = all || dirty[slot] || (parentSlot != NO_PARENT && worldChanged[parentSlot]);
+            if (changed) {
+                worldMatrices[slot] = parentSlot == NO_PARENT ? localMatrices[slot] : worldMatrices[parentSlot] * localMatrices[slot];
+            }
+            worldChanged[slot] = changed;
+            dirty[slot] = 0;
+        }
+    }
+
+    void TransformStore::updateLocalMatrices(size_t firstSlot, size_t lastSlot) {
+        for (size_t batch = firstSlot; batch < lastSlot; batch += BATCH_SIZE) {
+            uint8_t* batchDirty = &dirty[batch];
+            if (std::none_of(batchDirty, batchDirty + BATCH_SIZE, [](uint8_t d){ return d != 0; })) continue;
+
+            #if defined(VOLCHARA_TRANSFORMS_SSE) || defined(VOLCHARA_TRANSFORMS_NEON)
+            // T * R * S for four slots at once, the same terms as glm::toMat4
+            Lanes one = splat(1.0f);
+            Lanes two = splat(2.0f);
+            Lanes zero = splat(0.0f);
+            Lanes qx = load(&rotationX[batch]);
+            Lanes qy = load(&rotationY[batch]);
+            Lanes qz = load(&rotationZ[batch]);
+            Lanes qw = load(&rotationW[batch]);
+            Lanes sx = load(&scaleX[batch]);
+            Lanes sy = load(&scaleY[batch]);
+            Lanes sz = load(&scaleZ[batch]);
+            Lanes xx = mul(qx, qx), yy = mul(qy, qy), zz = mul(qz, qz);
+            Lanes xy = mul(qx, qy), xz = mul(qx, qz), yz = mul(qy, qz);
+            Lanes wx = mul(qw, qx), wy = mul(qw, qy), wz = mul(qw, qz);
+
+            float* out = glm::value_ptr(localMatrices[batch]);
+            storeTransposed(out,
+                mul(sub(one, mul(two, add(yy, zz))), sx),
+                mul(mul(two, add(xy, wz)), sx),
+                mul(mul(two, sub(xz, wy)), sx),
+                zero);
+            storeTransposed(out + 4,
+                mul(mul(two, sub(xy, wz)), sy),
+                mul(sub(one, mul(two, add(xx, zz))), sy),
+                mul(mul(two, add(yz, wx)), sy),
+                zero);
+            storeTransposed(out + 8,
+                mul(mul(two, add(xz, wy)), sz),
+                mul(mul(two, sub(yz, wx)), sz),
+                mul(sub(one, mul(two, add(xx, yy))), sz),
+                zero);
+            storeTransposed(out + 12, load(&translationX[batch]), load(&translationY[batch]), load(&translationZ[batch]), one);
+            #else
+            for (size_t slot = batch; slot < batch + BATCH_SIZE; slot++) {
+                localMatrices[slot] = get(static_cast<uint32_t>(slot)).modelMatrix();
+            }
+            #endif
+        }
+    }
+
+    const glm::mat4& TransformStore::worldMatrix(uint32_t slot) const {
+        return worldMatrices[slot];
+    }
+}
@@ -0,0 +1,63 @@
+#include <cmath>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/packing.hpp>
+
+#include <vertex_layout.hpp>
+
+namespace volchara {
+    namespace {
+        // folds the unit sphere onto the [-1, 1] square; decoded in base.vert
+        glm::vec2 encodeOctahedral(glm::vec3 n) {
+            float length = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+            if (length == 0.0f) return glm::vec2(0.0f);
+            n /= length;
+            glm::vec2 encoded(n.x, n.y);
+            if (n.z < 0.0f) {
+                encoded = (1.0f - glm::abs(glm::vec2(n.y, n.x))) * glm::vec2(n.x >= 0.0f ? 1.0f : -1.0f, n.y >= 0.0f ? 1.0f : -1.0f);
+            }
+            return encoded;
+        }
+    }
+
+    bool Vertex::operator==(const Vertex& other) const {
+        return ((pos == other.pos) && (normal == other.normal) && (texCoord == other.texCoord));
+    }
+
+    std::vector<vk::VertexInputBindingDescription> Vertex::getBindingDescriptions() {
+        std::vector<vk::VertexInputBindingDescription> bindingDescriptions{};
+        for (const VertexStreamDescriptor& stream : VERTEX_STREAMS) {
+            bindingDescriptions.push_back({
+                .binding = stream.binding,
+                .stride = stream.stride,
+                .inputRate = vk::VertexInputRate::eVertex,
+            });
+        }
+        return bindingDescriptions;
+    }
+
+    std::vector<vk::VertexInputAttributeDescription> Vertex::getAttributeDescriptions() {
+        std::vector<vk::VertexInputAttributeDescription> attributeDescriptions{};
+        for (const VertexAttributeDescriptor& attribute : VERTEX_ATTRIBUTES) {
+            attributeDescriptions.push_back({
+                .location = attribute.location,
+                .binding = attribute.binding,
+                .format = attribute.format,
+                .offset = attribute.offset,
+            });
+        }
+        return attributeDescriptions;
+    }
+
+    PositionStream packPosition(glm::vec3 pos) {
+        return {.pos = {pos.x, pos.y, pos.z}};
+    }
+
+    AttributeStream packAttributes(glm::vec3 normal, glm::vec2 texCoord) {
+        return {
+            .normal = glm::packSnorm2x16(encodeOctahedral(normal)),
+            .texCoord = glm::packHalf2x16(texCoord),
+        };
+    }
+}
@@ -0,0 +1,204 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+#include <vertex_weld.hpp>
+
+namespace volchara {
+    namespace {
+        // the bits of every attribute, so comparing and hashing never touch floats; an even count fills whole hash words
+        template<size_t N>
+        using WeldKey = std::array<uint32_t, N>;
+
+        // the input number of every welded vertex, and the welded number of every input vertex
+        struct WeldMap {
+            std::vector<uint32_t> kept;
+            std::vector<uint32_t> indices;
+        };
+
+        const uint32_t EMPTY_SLOT = std::numeric_limits<uint32_t>::max();
+        const size_t MIN_VERTICES_PER_WELD_JOB = 65536;
+
+        WeldKey<8> makeKey(const Vertex& v, float inverseEpsilon) {
+            std::array<float, 8> attributes{v.pos.x, v.pos.y, v.pos.z, v.normal.x, v.normal.y, v.normal.z, v.texCoord.x, v.texCoord.y};
+            if (inverseEpsilon > 0.0f) {
+                for (float& attribute : attributes) {
+                    attribute = std::round(attribute * inverseEpsilon);
+                }
+            }
+            WeldKey<8> key;
+            for (size_t i = 0; i < key.size(); i++) {
+                // adding +0 turns -0 into +0, so they weld like operator== would
+                key[i] = std::bit_cast<uint32_t>(attributes[i] + 0.0f);
+            }
+            return key;
+        }
+
+        WeldKey<6> makeKey(const PositionStream& position, const AttributeStream& attributes) {
+            return {
+                std::bit_cast<uint32_t>(position.pos[0] + 0.0f),
+                std::bit_cast<uint32_t>(position.pos[1] + 0.0f),
+                std::bit_cast<uint32_t>(position.pos[2] + 0.0f),
+                attributes.normal,
+                attributes.texCoord,
+                0,
+            };
+        }
+
+        // independent multiplies instead of a chain over every word
+        template<size_t N>
+        uint64_t hashKey(const WeldKey<N>& key) {
+            static_assert(N % 2 == 0 && N <= 8, "weld keys hash as up to four 64-bit words");
+            const uint64_t multipliers[4] = {0x9e3779b97f4a7c15ull, 0xc2b2ae3d27d4eb4full, 0x165667b19e3779f9ull, 0xd6e8feb86659fd93ull};
+            uint64_t words[N / 2];
+            std::memcpy(words, key.data(), sizeof(words));
+            uint64_t hash = 0;
+            for (size_t i = 0; i < N / 2; i++) {
+                hash ^= words[i] * multipliers[i];
+            }
+            hash ^= hash >> 32;
+            hash *= 0xd6e8feb86659fd93ull;
+            return hash ^ (hash >> 32);
+        }
+
+        // open addressing with linear probing; every slot keeps a part of the hash to skip most key comparisons.
+        // the table grows with the unique vertices rather than the input, so it stays in cache when most vertices repeat
+        template<size_t N, typename MakeKey>
+        WeldMap weldHashed(size_t count, const MakeKey& makeKey) {
+            struct Slot {
+                uint32_t vertex = EMPTY_SLOT;
+                uint32_t tag = 0;
+            };
+            std::vector<Slot> slots(1024);
+            size_t mask = slots.size() - 1;
+            std::vector<WeldKey<N>> keys;
+            WeldMap result;
+            result.indices.reserve(count);
+            auto findSlot = [&](const WeldKey<N>& key, uint64_t hash) {
+                uint32_t tag = static_cast<uint32_t>(hash >> 32);
+                size_t slot = hash & mask;
+                while (slots[slot].vertex != EMPTY_SLOT && (slots[slot].tag != tag || keys[slots[slot].vertex] != key)) {
+                    slot = (slot + 1) & mask;
+                }
+                return slot;
+            };
+            for (size_t i = 0; i < count; i++) {
+                WeldKey<N> key = makeKey(i);
+                uint64_t hash = hashKey(key);
+                size_t slot = findSlot(key, hash);
+                if (slots[slot].vertex == EMPTY_SLOT) {
+                    slots[slot] = {.vertex = static_cast<uint32_t>(keys.size()), .tag = static_cast<uint32_t>(hash >> 32)};
+                    keys.push_back(key);
+                    result.kept.push_back(static_cast<uint32_t>(i));
+                    // kept at most half full
+                    if (keys.size() * 2 > slots.size()) {
+                        slots.assign(slots.size() * 2, Slot{});
+                        mask = slots.size() - 1;
+                        for (uint32_t vertex = 0; vertex < keys.size(); vertex++) {
+                            uint64_t rehash = hashKey(keys[vertex]);
+                            slots[findSlot(keys[vertex], rehash)] = {.vertex = vertex, .tag = static_cast<uint32_t>(rehash >> 32)};
+                        }
+                    }
+                    result.indices.push_back(static_cast<uint32_t>(keys.size() - 1));
+                }
+                else {
+                    result.indices.push_back(slots[slot].vertex);
+                }
+            }
+            return result;
+        }
+
+        // sorts vertex numbers by key in parallel chunks merged pairwise; equal keys then form runs
+        // whose first member is the vertex that appeared first
+        template<size_t N, typename MakeKey>
+        WeldMap weldSorted(size_t count, const MakeKey& makeKey, JobSystem& jobs) {
+            std::vector<WeldKey<N>> keys(count);
+            jobs.parallelForRange(count, MIN_VERTICES_PER_WELD_JOB, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++) {
+                    keys[i] = makeKey(i);
+                }
+            });
+            std::vector<uint32_t> order(count);
+            std::iota(order.begin(), order.end(), 0);
+            auto less = [&](uint32_t a, uint32_t b) {
+                return keys[a] < keys[b] || (keys[a] == keys[b] && a < b);
+            };
+            size_t chunk = std::max(MIN_VERTICES_PER_WELD_JOB, (count + jobs.concurrency() - 1) / jobs.concurrency());
+            jobs.parallelForRange(count, chunk, [&](size_t begin, size_t end) {
+                std::sort(order.begin() + begin, order.begin() + end, less);
+            });
+            for (size_t width = chunk; width < count; width *= 2) {
+                size_t pairs = (count + 2 * width - 1) / (2 * width);
+                jobs.parallelFor(pairs, [&](size_t pair) {
+                    size_t begin = pair * 2 * width;
+                    size_t middle = std::min(begin + width, count);
+                    size_t end = std::min(begin + 2 * width, count);
+                    std::inplace_merge(order.begin() + begin, order.begin() + middle, order.begin() + end, less);
+                });
+            }
+
+            std::vector<uint32_t> representatives(count);
+            for (size_t run = 0; run < count;) {
+                size_t runEnd = run + 1;
+                while (runEnd < count && keys[order[runEnd]] == keys[order[run]]) runEnd++;
+                for (size_t i = run; i < runEnd; i++) {
+                    representatives[order[i]] = order[run];
+                }
+                run = runEnd;
+            }
+            // a representative comes no later than the vertices it stands for, so its number is already known
+            WeldMap result;
+            result.indices.resize(count);
+            for (size_t i = 0; i < count; i++) {
+                if (representatives[i] == i) {
+                    result.indices[i] = static_cast<uint32_t>(result.kept.size());
+                    result.kept.push_back(static_cast<uint32_t>(i));
+                }
+                else {
+                    result.indices[i] = result.indices[representatives[i]];
+                }
+            }
+            return result;
+        }
+
+        template<size_t N, typename MakeKey>
+        WeldMap weld(size_t count, const MakeKey& makeKey, JobSystem* jobs) {
+            if (jobs && !jobs->isSingleThreaded() && count >= PARALLEL_WELD_THRESHOLD) {
+                return weldSorted<N>(count, makeKey, *jobs);
+            }
+            return weldHashed<N>(count, makeKey);
+        }
+    }
+
+    WeldedMesh weldVertices(std::span<const Vertex> vertices, float epsilon, JobSystem* jobs) {
+        float inverseEpsilon = epsilon > 0.0f ? 1.0f / epsilon : 0.0f;
+        WeldMap map = weld<8>(vertices.size(), [&](size_t i) { return makeKey(vertices[i], inverseEpsilon); }, jobs);
+        WeldedMesh result{.indices = std::move(map.indices)};
+        result.vertices.reserve(map.kept.size());
+        for (uint32_t vertex : map.kept) {
+            result.vertices.push_back(vertices[vertex]);
+        }
+        return result;
+    }
+
+    WeldedStreams weldVertices(std::span<const PositionStream> positions, std::span<const AttributeStream> attributes, JobSystem* jobs) {
+        if (positions.size() != attributes.size()) {
+            throw std::runtime_error("vertex streams differ in length!");
+        }
+        WeldMap map = weld<6>(positions.size(), [&](size_t i) { return makeKey(positions[i], attributes[i]); }, jobs);
+        WeldedStreams result{.indices = std::move(map.indices)};
+        result.positions.reserve(map.kept.size());
+        result.attributes.reserve(map.kept.size());
+        for (uint32_t vertex : map.kept) {
+            result.positions.push_back(positions[vertex]);
+            result.attributes.push_back(attributes[vertex]);
+        }
+        return result;
+    }
+}
@@ -0,0 +1,194 @@
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory_resource>
+#include <new>
+#include <span>
+#include <vector>
+
+#include <renderer.hpp>
+#include <frame_arena.hpp>
+#include <frame_data.hpp>
+#include <job_system.hpp>
+#include <scene_registry.hpp>
+#include <transform_store.hpp>
+
+// the CPU side of a steady frame must not touch the heap once warmed up. this drives drawFrame's own functions over
+// a scene, with host arrays standing in for the mapped buffers and null handles for the recorded secondary buffers:
+// interpolating transforms, writing model matrices and object data, selecting LODs, laying out the meshlet cull jobs
+// and draw commands, and gathering the secondary buffers from the frame arena. the camera sweeps back and forth, so
+// LODs switch and instances move between the culled and the whole draws while allocations are counted.
+// what drawFrame still allocates is off the steady path: checkMemoryBudget's report, once a second; and on scene
+// changes only, the draw slots growing past their capacity, RenderTransforms resizing and TransformStore::rebuildOrder
+const size_t OBJECT_COUNT = 100000;
+const size_t WARMUP_FRAMES = 10;
+const size_t FRAMES = 200;
+// pixels per unit at unit distance for a 600 pixel high, 45 degree view
+const float PIXELS_PER_UNIT = 724.0f;
+const float LOD_PIXEL_ERROR = 1.0f;
+
+namespace {
+    std::atomic<bool> counting{false};
+    std::atomic<size_t> allocations{0};
+
+    void* allocate(size_t size) {
+        if (counting.load(std::memory_order_relaxed)) allocations.fetch_add(1, std::memory_order_relaxed);
+        if (void* data = std::malloc(size ? size : 1)) return data;
+        throw std::bad_alloc();
+    }
+
+    // aligned blocks keep the malloc'd pointer right before the one handed out
+    void* allocateAligned(size_t size, size_t alignment) {
+        if (counting.load(std::memory_order_relaxed)) allocations.fetch_add(1, std::memory_order_relaxed);
+        void* raw = std::malloc(size + alignment + sizeof(void*));
+        if (!raw) throw std::bad_alloc();
+        uintptr_t aligned = (reinterpret_cast<uintptr_t>(raw) + sizeof(void*) + alignment - 1) & ~(uintptr_t(alignment) - 1);
+        reinterpret_cast<void**>(aligned)[-1] = raw;
+        return reinterpret_cast<void*>(aligned);
+    }
+
+    void deallocateAligned(void* data) {
+        if (data) std::free(reinterpret_cast<void**>(data)[-1]);
+    }
+}
+
+void* operator new(size_t size) { return allocate(size); }
+void* operator new[](size_t size) { return allocate(size); }
+void* operator new(size_t size, std::align_val_t alignment) { return allocateAligned(size, static_cast<size_t>(alignment)); }
+void* operator new[](size_t size, std::align_val_t alignment) { return allocateAligned(size, static_cast<size_t>(alignment)); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    try { return allocate(size); } catch (...) { return nullptr; }
+}
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    try { return allocate(size); } catch (...) { return nullptr; }
+}
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    try { return allocateAligned(size, static_cast<size_t>(alignment)); } catch (...) { return nullptr; }
+}
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    try { return allocateAligned(size, static_cast<size_t>(alignment)); } catch (...) { return nullptr; }
+}
+void operator delete(void* data) noexcept { std::free(data); }
+void operator delete[](void* data) noexcept { std::free(data); }
+void operator delete(void* data, size_t) noexcept { std::free(data); }
+void operator delete[](void* data, size_t) noexcept { std::free(data); }
+void operator delete(void* data, const std::nothrow_t&) noexcept { std::free(data); }
+void operator delete[](void* data, const std::nothrow_t&) noexcept { std::free(data); }
+void operator delete(void* data, std::align_val_t) noexcept { deallocateAligned(data); }
+void operator delete[](void* data, std::align_val_t) noexcept { deallocateAligned(data); }
+void operator delete(void* data, size_t, std::align_val_t) noexcept { deallocateAligned(data); }
+void operator delete[](void* data, size_t, std::align_val_t) noexcept { deallocateAligned(data); }
+void operator delete(void* data, std::align_val_t, const std::nothrow_t&) noexcept { deallocateAligned(data); }
+void operator delete[](void* data, std::align_val_t, const std::nothrow_t&) noexcept { deallocateAligned(data); }
+
+int main() {
+    using namespace volchara;
+    // three workers so the queues and wakeups are exercised even on a small runner
+    JobSystem jobs(3);
+    std::array<FrameArena, MAX_FRAMES_IN_FLIGHT> frameArenas;
+
+    // every fourth object a root with three children; most with a LOD chain whose full mesh has meshlets
+    SceneRegistry scene;
+    SimulationSnapshot previous;
+    SimulationSnapshot current;
+    current.transforms.resize(OBJECT_COUNT);
+    current.moved.resize(OBJECT_COUNT, 1);
+    current.parents.resize(OBJECT_COUNT, TransformStore::NO_PARENT);
+    current.hierarchyGeneration = 1;
+    for (uint32_t i = 0; i < OBJECT_COUNT; i++) {
+        bool hasLod = i % 10 != 0;
+        Entity entity = scene.create(DRAWABLE_COMPONENTS | (hasLod ? COMPONENT_LOD : 0u));
+        scene.transform(entity) = i;
+        scene.material(entity) = {.textureIndex = i % 4, .color = glm::vec3(0.5f)};
+        LodChain chain{
+            .levels = {{
+                {.firstIndex = 0, .indexCount = 300, .error = 0.0f, .firstMeshlet = 0, .meshletCount = 3},
+                {.firstIndex = 300, .indexCount = 120, .error = 0.01f},
+                {.firstIndex = 420, .indexCount = 30, .error = 0.05f},
+            }},
+            .levelCount = 3,
+            .radius = 1.0f,
+        };
+        const LodLevel& full = chain.levels[0];
+        scene.mesh(entity) = {.firstIndex = full.firstIndex, .indexCount = full.indexCount, .vertexOffset = 0,
+            .firstMeshlet = full.firstMeshlet, .meshletCount = full.meshletCount};
+        if (hasLod) scene.lod(entity) = chain;
+        if (i % 4 != 0) {
+            current.parents[i] = i - i % 4;
+            current.transforms[i].translation = glm::vec3(0.0f, 1.0f, 0.0f);
+        } else {
+            current.transforms[i].translation = glm::vec3(float(i % 400) - 200.0f, float(i / 400 % 50), -float(i / 20000) * 4.0f);
+        }
+    }
+    // the snapshot lists drawn entities in scene order
+    scene.forEach(DRAWABLE_COMPONENTS, [&](Archetype& archetype, size_t) {
+        current.instanceSlots.insert(current.instanceSlots.end(), archetype.transforms.begin(), archetype.transforms.end());
+    });
+    previous = current;
+
+    // stand-ins for the mapped buffers, sized like the renderer's
+    std::vector<glm::mat4> models(OBJECT_COUNT);
+    std::vector<ObjectData> objectData(OBJECT_COUNT);
+    std::vector<MeshletCullJob> cullJobs(MESHLET_CULL_JOB_CAPACITY);
+    std::vector<vk::DrawIndexedIndirectCommand> drawTemplates(OBJECT_COUNT);
+    std::vector<vk::DrawIndexedIndirectCommand> drawCommands(OBJECT_COUNT);
+    std::vector<uint32_t> drawSlots;
+    std::vector<vk::raii::CommandBuffer> secondaryBuffers;
+    for (size_t job = 0; job < jobs.concurrency(); job++) secondaryBuffers.emplace_back(nullptr);
+    RenderTransforms renderTransforms;
+    size_t lodChanges = 0;
+    size_t slotChanges = 0;
+
+    auto frame = [&](size_t frameIndex) {
+        // a simulation tick: every seventh root moves
+        std::swap(previous, current);
+        current.tick = previous.tick + 1;
+        for (size_t i = 0; i < OBJECT_COUNT; i++) {
+            current.transforms[i] = previous.transforms[i];
+            current.moved[i] = i % 28 == 0;
+            if (current.moved[i]) current.transforms[i].translation.y += 0.01f;
+        }
+        // between the full mesh up close and the coarsest level far away
+        glm::vec3 camera(0.0f, 10.0f, 115.0f + 113.0f * std::sin(float(frameIndex) * 0.2f));
+
+        FrameArena& arena = frameArenas[frameIndex % frameArenas.size()];
+        arena.reset();
+        renderTransforms.interpolate(previous, current, 0.5f, jobs);
+        writeModelMatrices(models.data(), renderTransforms.store, current.instanceSlots, jobs);
+        writeObjectData(objectData.data(), scene);
+        lodChanges += selectLodLevels(scene, renderTransforms.store, camera, PIXELS_PER_UNIT, LOD_PIXEL_ERROR, jobs);
+        MeshletCullLayout layout = writeMeshletCullJobs(scene, cullJobs.data(), drawTemplates.data(), drawSlots);
+        slotChanges += layout.slotsChanged;
+        MeshletCullDispatch dispatch = meshletCullDispatch(layout.jobCount);
+        writeDrawCommands(drawCommands.data(), scene, drawSlots);
+        std::pmr::vector<vk::CommandBuffer> gathered = gatherCommandBuffers(secondaryBuffers, &arena);
+        if (gathered.size() != secondaryBuffers.size() || dispatch.jobCount != layout.jobCount) {
+            std::printf("FAILED: frame %zu wrote an inconsistent frame\n", frameIndex);
+            std::exit(1);
+        }
+    };
+
+    for (size_t i = 0; i < WARMUP_FRAMES; i++) frame(i);
+    lodChanges = 0;
+    slotChanges = 0;
+    counting.store(true);
+    for (size_t i = 0; i < FRAMES; i++) frame(WARMUP_FRAMES + i);
+    counting.store(false);
+
+    // a camera that never switched a LOD would leave most of the frame untested
+    if (lodChanges == 0 || slotChanges == 0) {
+        std::printf("FAILED: no LOD switches over %zu frames\n", FRAMES);
+        return 1;
+    }
+    size_t counted = allocations.load();
+    if (counted != 0) {
+        std::printf("FAILED: %zu heap allocations over %zu warmed-up frames\n", counted, FRAMES);
+        return 1;
+    }
+    std::printf("no heap allocations over %zu warmed-up frames, %zu of them switching LODs\n", FRAMES, lodChanges);
+    return 0;
+}
@@ -0,0 +1,29 @@
+#include <exception>
+#include <filesystem>
+#include <iostream>
+
+#include <job_system.hpp>
+#include <mesh_cache.hpp>
+#include <model_import.hpp>
+
+// vmesh <model>...
+// writes each glTF model's .vmesh cache next to it, as its first load would, so no launch has to parse it
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "usage: vmesh <model>..." << std::endl;
+        return 2;
+    }
+    volchara::JobSystem jobs;
+    int failed = 0;
+    for (int arg = 1; arg < argc; arg++) {
+        std::filesystem::path modelPath = argv[arg];
+        try {
+            volchara::convertGLTFModel(modelPath, &jobs);
+            std::cout << modelPath.string() << " -> " << volchara::meshCachePath(modelPath).string() << std::endl;
+        } catch (const std::exception& e) {
+            std::cerr << "vmesh: " << modelPath.string() << ": " << e.what() << std::endl;
+            failed = 1;
+        }
+    }
+    return failed;
+}
@@ -0,0 +1,43 @@
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <asset_archive.hpp>
+
+// vpak [--lz4] <archive> <root> <file>...
+// packs the files under their paths relative to root, which is how the renderer asks for them
+int main(int argc, char** argv) {
+    int arg = 1;
+    volchara::AssetCompression compression = volchara::AssetCompression::None;
+    if (arg < argc && std::strcmp(argv[arg], "--lz4") == 0) {
+        compression = volchara::AssetCompression::LZ4;
+        arg++;
+    }
+    if (argc - arg < 2) {
+        std::cerr << "usage: vpak [--lz4] <archive> <root> <file>..." << std::endl;
+        return 2;
+    }
+    std::filesystem::path archivePath = argv[arg++];
+    std::filesystem::path root = argv[arg++];
+    try {
+        std::vector<volchara::ArchiveInput> inputs;
+        for (; arg < argc; arg++) {
+            std::filesystem::path file = argv[arg];
+            std::filesystem::path name = std::filesystem::relative(file, root);
+            if (name.empty() || *name.begin() == "..") {
+                std::cerr << "vpak: " << file.string() << " isn't under " << root.string() << std::endl;
+                return 1;
+            }
+            std::u8string genericName = name.generic_u8string();
+            inputs.push_back({.name = std::string(genericName.begin(), genericName.end()), .file = file});
+        }
+        volchara::writeAssetArchive(archivePath, std::move(inputs), compression);
+    } catch (const std::exception& e) {
+        std::cerr << "vpak: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}